@@ -0,0 +1,200 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief A timestamped value
+     */
+    struct SamplePoint
+    {
+        std::chrono::system_clock::time_point timestamp;
+        double value = 0.0;
+    };
+
+    /**
+     * @brief Aggregates of one closed window, one entry per tag
+     */
+    struct WindowSummary
+    {
+        std::chrono::system_clock::time_point start;
+        std::chrono::system_clock::time_point end;
+        std::span<const double> min;
+        std::span<const double> max;
+        std::span<const double> mean;
+        std::span<const double> last;
+        std::span<const uint32_t> count;
+    };
+
+    /**
+     * @brief Streaming per-tag min/max/mean/last/count over fixed time windows
+     *
+     * Windows are aligned to multiples of the window length since the clock
+     * epoch, so aggregates of different devices line up (e.g. poll at 100 Hz,
+     * emit on every full second). All storage is allocated by the constructor;
+     * add() and flush() never allocate. NaN values are ignored.
+     */
+    class WindowAggregator
+    {
+    public:
+        /**
+         * @brief Construct an aggregator
+         *
+         * @param tag_count Number of values per sample
+         * @param window Window length (must be positive)
+         */
+        WindowAggregator(size_t tag_count, std::chrono::system_clock::duration window);
+
+        /**
+         * @brief Add a sample of all tags
+         *
+         * If the sample belongs to a later window than the open one, the open
+         * window is closed first and becomes available via summary().
+         *
+         * @param values One value per tag
+         * @param timestamp Sample time
+         * @return true if a window was closed by this sample
+         * @return false otherwise (including when values is too small)
+         */
+        bool add(std::span<const double> values, std::chrono::system_clock::time_point timestamp);
+
+        /**
+         * @brief Close the open window early (e.g. on shutdown)
+         *
+         * @return true if a window with samples was closed
+         * @return false if no window was open
+         */
+        bool flush();
+
+        /**
+         * @brief Aggregates of the most recently closed window
+         */
+        WindowSummary summary() const noexcept;
+
+        /**
+         * @brief Number of tags
+         */
+        size_t tag_count() const noexcept { return tag_count_; }
+
+    private:
+        void close_window();
+        void reset_accumulators();
+
+        size_t tag_count_;
+        std::chrono::system_clock::duration window_;
+        std::chrono::system_clock::time_point open_start_;
+        bool open_ = false;
+
+        std::vector<double> min_;
+        std::vector<double> max_;
+        std::vector<double> sum_;
+        std::vector<double> last_;
+        std::vector<uint32_t> count_;
+
+        std::chrono::system_clock::time_point closed_start_;
+        std::vector<double> closed_min_;
+        std::vector<double> closed_max_;
+        std::vector<double> closed_mean_;
+        std::vector<double> closed_last_;
+        std::vector<uint32_t> closed_count_;
+    };
+
+    /**
+     * @brief Report-by-exception filter with a per-tag absolute deadband
+     */
+    class DeadbandFilter
+    {
+    public:
+        /**
+         * @brief Construct a filter
+         *
+         * @param deadbands Deadband of every tag
+         */
+        explicit DeadbandFilter(std::span<const double> deadbands);
+
+        /**
+         * @brief Check a single value and remember it if it passes
+         *
+         * @return true if the value differs from the last reported value by
+         *         more than the deadband, or is the first value of the tag
+         * @return false if the value should be suppressed
+         */
+        bool pass(size_t tag, double value);
+
+        /**
+         * @brief Filter a whole sample
+         *
+         * @param values One value per tag
+         * @return std::span<const uint32_t> Indices of the tags that passed
+         */
+        std::span<const uint32_t> apply(std::span<const double> values);
+
+    private:
+        std::vector<double> deadbands_;
+        std::vector<double> reported_;
+        std::vector<uint8_t> seen_;
+        std::vector<uint32_t> passed_;
+    };
+
+    /**
+     * @brief Swinging-door trending compression
+     *
+     * A point is archived only when no straight line from the previously
+     * archived point can represent all values seen since within the
+     * compression deviation. Each tag keeps the range of admissible slopes,
+     * so adding a value is O(1) and allocation-free.
+     */
+    class SwingingDoorFilter
+    {
+    public:
+        /**
+         * @brief Construct a filter
+         *
+         * @param deviations Compression deviation of every tag
+         */
+        explicit SwingingDoorFilter(std::span<const double> deviations);
+
+        /**
+         * @brief Add a value of one tag
+         *
+         * @param tag Tag index
+         * @param point New value
+         * @param archived Set to the point to archive when returning true
+         * @return true if a point must be archived
+         * @return false if the value is covered by the current door
+         */
+        bool add(size_t tag, const SamplePoint &point, SamplePoint &archived);
+
+        /**
+         * @brief Retrieve the last, not yet archived point of a tag
+         *
+         * @return true if there was a pending point
+         * @return false otherwise
+         */
+        bool flush(size_t tag, SamplePoint &archived);
+
+    private:
+        struct State
+        {
+            SamplePoint anchor;
+            SamplePoint last;
+            double min_slope;
+            double max_slope;
+            bool started;
+            bool pending;
+        };
+
+        std::vector<double> deviations_;
+        std::vector<State> states_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
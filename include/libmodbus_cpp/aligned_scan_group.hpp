@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    class ScanPoller;
+    struct ScanResult;
+
+    /**
+     * @brief Timing of wall-clock aligned scans
+     */
+    struct AlignmentConfig
+    {
+        /// Scans start on multiples of the period since the epoch (e.g. every full second)
+        std::chrono::system_clock::duration period{std::chrono::seconds(1)};
+        /// Offset of the sampling instant from the period boundary
+        std::chrono::system_clock::duration phase{0};
+        /// Issue requests early by half the measured round-trip time
+        bool compensate_rtt = true;
+        /// Weight of the newest round-trip sample in the smoothed estimate (0..1]
+        double rtt_smoothing = 0.2;
+        /// Final part of each wait that is busy-waited instead of slept (at most
+        /// 1 ms; no spinning if the group has more devices than CPUs)
+        std::chrono::system_clock::duration spin_margin{std::chrono::microseconds(200)};
+    };
+
+    /**
+     * @brief Alignment statistics of a device
+     */
+    struct AlignmentStats
+    {
+        uint64_t scans = 0;
+        uint64_t failures = 0;
+        uint64_t missed_boundaries = 0;          ///< Boundaries skipped because a scan overran
+        /// Estimated sampling instant minus boundary; the skew figures only
+        /// cover scans whose first block was read
+        std::chrono::nanoseconds last_skew{0};
+        std::chrono::nanoseconds max_abs_skew{0};
+        std::chrono::nanoseconds mean_abs_skew{0};
+        std::chrono::nanoseconds rtt{0};         ///< Smoothed round-trip time of the first block
+    };
+
+    /**
+     * @brief Scans a fleet of devices in lockstep with the wall clock
+     *
+     * Each device is scanned by its own thread (libmodbus requests block),
+     * but instead of free-running sleep loops every thread targets the same
+     * wall-clock boundaries. With RTT compensation the first request of a
+     * scan is issued half a round trip before the boundary, so the device
+     * samples as close to the boundary as possible. The estimated sampling
+     * instant of every scan is compared to its boundary and reported as skew.
+     *
+     * Every device needs its own ModbusConnection. Listeners are invoked from
+     * the device threads, concurrently for different devices.
+     *
+     * One thread per device suits groups up to a few dozen devices. With
+     * more devices than CPUs the threads sleep up to the boundary instead of
+     * spinning, so the skew is bounded by the timer slack and scheduling
+     * latency of the host; larger fleets are better split into several
+     * groups with staggered phases.
+     */
+    class AlignedScanGroup
+    {
+    public:
+        using Listener = std::function<void(size_t device, const ScanResult &result, bool success,
+                                            std::chrono::nanoseconds skew)>;
+
+        /// Upper bound of AlignmentConfig::spin_margin
+        static constexpr std::chrono::milliseconds max_spin_margin{1};
+
+        /**
+         * @brief Construct a group
+         *
+         * @param config Alignment timing (period must be positive)
+         */
+        explicit AlignedScanGroup(const AlignmentConfig &config);
+
+        /**
+         * @brief Stop all device threads
+         */
+        ~AlignedScanGroup();
+
+        AlignedScanGroup(const AlignedScanGroup &) = delete;
+        AlignedScanGroup &operator=(const AlignedScanGroup &) = delete;
+
+        /**
+         * @brief Add a device
+         *
+         * Throws std::invalid_argument if the group is running.
+         *
+         * @param poller Poller of the device (must outlive the group)
+         * @return size_t Device index
+         */
+        size_t add_device(ScanPoller &poller);
+
+        /**
+         * @brief Set the listener invoked after every scan (only while stopped)
+         */
+        void set_listener(Listener listener);
+
+        /**
+         * @brief Start one scan thread per device
+         *
+         * @return true if the threads were started
+         * @return false if the group is already running or has no devices
+         */
+        bool start();
+
+        /**
+         * @brief Stop and join all scan threads
+         */
+        void stop();
+
+        /**
+         * @brief Check whether the scan threads are running
+         */
+        bool running() const noexcept { return !threads_.empty(); }
+
+        /**
+         * @brief Alignment statistics of a device
+         */
+        AlignmentStats stats(size_t device) const;
+
+        /**
+         * @brief Spread of the sampling instants in the most recent boundary
+         *
+         * @return std::chrono::nanoseconds Latest minus earliest estimated
+         *         sampling instant over all devices that read their first
+         *         block on the most recent boundary
+         */
+        std::chrono::nanoseconds cycle_spread() const;
+
+    private:
+        struct DeviceState
+        {
+            ScanPoller *poller = nullptr;
+            AlignmentStats stats;
+            uint64_t skew_samples = 0; ///< Scans with a valid first block
+            std::chrono::nanoseconds abs_skew_sum{0};
+            std::chrono::system_clock::time_point boundary;
+            std::chrono::system_clock::time_point sampled;
+        };
+
+        void run_device(std::stop_token stop, size_t index);
+        std::chrono::system_clock::time_point next_boundary(std::chrono::system_clock::time_point after) const;
+        static bool wait_until(std::stop_token &stop, std::chrono::system_clock::time_point target,
+                               std::chrono::system_clock::duration spin_margin);
+
+        AlignmentConfig config_;
+        std::chrono::system_clock::duration spin_margin_{0}; ///< Spin margin in effect while running
+        Listener listener_;
+        std::vector<DeviceState> devices_;
+        std::vector<std::jthread> threads_;
+        mutable std::mutex mutex_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
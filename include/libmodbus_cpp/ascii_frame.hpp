@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /// Maximum length of a Modbus ASCII frame (':', 2 x 255 hex digits, CR LF)
+    constexpr size_t max_ascii_length = 513;
+
+    /// Maximum length of the address and PDU of an ASCII frame (the LRC takes the last byte)
+    constexpr size_t max_ascii_adu_length = (max_ascii_length - 3) / 2 - 1;
+
+    /**
+     * @brief Longitudinal redundancy check of Modbus ASCII
+     *
+     * Two's complement of the 8-bit sum of address and PDU bytes.
+     */
+    uint8_t ascii_lrc(std::span<const uint8_t> data);
+
+    /**
+     * @brief Check the LRC of a decoded ASCII frame
+     *
+     * @param frame Address, PDU and LRC
+     * @return true if the frame is at least 3 bytes long and its LRC matches
+     * @return false otherwise
+     */
+    bool ascii_check_lrc(std::span<const uint8_t> frame);
+
+    /**
+     * @brief Encode bytes as upper-case hex digits
+     *
+     * @param data Bytes to encode
+     * @param out Buffer for 2 * data.size() characters
+     * @return size_t Number of characters written
+     */
+    size_t ascii_encode(std::span<const uint8_t> data, char *out);
+
+    /**
+     * @brief Decode hex digits (either case) into bytes
+     *
+     * @param text Hex digits, an even number of them
+     * @param out Buffer for text.size() / 2 bytes
+     * @return size_t Number of bytes written, or 0 if the length is odd or a
+     *         character is not a hex digit
+     */
+    size_t ascii_decode(std::span<const char> text, uint8_t *out);
+
+    /**
+     * @brief Build a complete ASCII frame
+     *
+     * Writes ':', the hex encoded address and PDU, the LRC and CR LF.
+     *
+     * @param adu Address and PDU (at most max_ascii_adu_length bytes)
+     * @param out Buffer for 2 * adu.size() + 5 characters
+     * @return size_t Length of the frame, or 0 if the ADU is too long
+     */
+    size_t ascii_frame(std::span<const uint8_t> adu, char *out);
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "libmodbus_cpp/rtu_frame.hpp"
+#include "libmodbus_cpp/scan_plan.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Serial line assumptions of a bus time budget
+     */
+    struct BusBudgetConfig
+    {
+        SerialConfig serial;                        ///< Baud rate and character format (device is ignored)
+        SerialFraming framing = SerialFraming::rtu;
+        /// Master latency per transaction on top of the protocol gaps (e.g. the latency timer of a USB adapter)
+        std::chrono::nanoseconds master_latency{0};
+        /// Largest bus occupancy considered feasible; the rest is left for retries and timeouts
+        double max_occupancy = 0.8;
+    };
+
+    /**
+     * @brief A device scanned on the bus
+     */
+    struct BudgetDevice
+    {
+        uint8_t unit_id = 1;
+        ScanPlan plan;
+        std::chrono::nanoseconds interval{std::chrono::seconds(1)};
+        /// Time the device takes to start its response once it has recognized the request
+        std::chrono::nanoseconds response_time{std::chrono::milliseconds(5)};
+    };
+
+    /**
+     * @brief Broadcast writes sent periodically on the bus
+     */
+    struct BudgetBroadcast
+    {
+        uint16_t registers = 1; ///< Registers per broadcast (1: FC 06, more: FC 16)
+        std::chrono::nanoseconds interval{std::chrono::seconds(1)};
+        std::chrono::nanoseconds turnaround_delay{std::chrono::milliseconds(100)};
+    };
+
+    /**
+     * @brief Bus time of one transaction
+     */
+    struct TransactionCost
+    {
+        size_t request_characters = 0;
+        size_t response_characters = 0; ///< 0 for broadcasts
+        /// Characters, inter-frame gaps, device response time, master latency and turnaround delay
+        std::chrono::nanoseconds time{0};
+    };
+
+    /**
+     * @brief Budget of one device
+     */
+    struct DeviceBudget
+    {
+        std::vector<std::chrono::nanoseconds> block_time; ///< Bus time per block of the plan
+        std::chrono::nanoseconds scan_time{0};            ///< Bus time of one scan
+        double occupancy = 0.0;                           ///< scan_time / interval
+        bool fits = false;                                ///< The scan alone fits into the interval
+    };
+
+    /**
+     * @brief Blocks of a plan that are cheaper to read as one request
+     *
+     * The merged block also reads the addresses between the blocks; only
+     * apply it if the device answers them (otherwise it returns exception
+     * 0x02 for the whole request).
+     */
+    struct BlockMerge
+    {
+        size_t device = 0;
+        std::vector<size_t> blocks; ///< Plan indices of the blocks replaced by the merged one
+        ScanBlock merged;
+        std::chrono::nanoseconds saving{0}; ///< Bus time saved per scan
+    };
+
+    /**
+     * @brief Result of analyze_bus_budget()
+     */
+    struct BusBudget
+    {
+        std::vector<DeviceBudget> devices;
+        double broadcast_occupancy = 0.0;
+        double occupancy = 0.0;                ///< Share of bus time used by all scans and broadcasts
+        std::chrono::nanoseconds burst_time{0}; ///< Bus time to scan every device once (all due at the same time)
+        /// Factor all intervals have to grow by to reach max_occupancy (<= 1 if feasible)
+        double interval_scale = 0.0;
+        bool feasible = false;                 ///< Occupancy within max_occupancy and every scan fits its interval
+        std::vector<BlockMerge> merges;        ///< Suggested merges, one per group of blocks
+        double merged_occupancy = 0.0;         ///< Occupancy with all suggested merges applied
+    };
+
+    /**
+     * @brief Bus time of a read request and its response
+     *
+     * RTU: request and response characters, t3.5 after each frame, the
+     * response time of the device and the master latency. ASCII: the hex
+     * encoded frames without silent intervals. Exception responses and
+     * retries are not modelled.
+     *
+     * Throws std::invalid_argument if the baud rate is not positive.
+     *
+     * @param config Serial line assumptions
+     * @param kind Data table read
+     * @param count Number of registers or bits
+     * @param response_time Response time of the device
+     * @return TransactionCost Characters and bus time
+     */
+    TransactionCost read_cost(const BusBudgetConfig &config, BlockKind kind, uint16_t count,
+                              std::chrono::nanoseconds response_time);
+
+    /**
+     * @brief Bus time of a broadcast write and its turnaround delay
+     *
+     * Throws std::invalid_argument if the baud rate is not positive or the
+     * broadcast does not write 1..123 registers.
+     */
+    TransactionCost broadcast_cost(const BusBudgetConfig &config, const BudgetBroadcast &broadcast);
+
+    /**
+     * @brief Compute the bus occupancy of scan plans on one serial bus
+     *
+     * Sums the bus time of every scan over its interval, flags devices whose
+     * scan cannot finish within its interval and plans that overload the
+     * bus, and suggests merging blocks of the same table where one larger
+     * request costs less bus time than the separate ones.
+     *
+     * Throws std::invalid_argument if the baud rate or an interval is not
+     * positive, or max_occupancy is not in (0, 1].
+     *
+     * @param config Serial line assumptions
+     * @param devices Devices scanned on the bus
+     * @param broadcasts Periodic broadcast writes on the bus
+     * @return BusBudget Occupancy per device and for the bus, merge suggestions
+     */
+    BusBudget analyze_bus_budget(const BusBudgetConfig &config, const std::vector<BudgetDevice> &devices,
+                                 const std::vector<BudgetBroadcast> &broadcasts = {});
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    struct ScanResult;
+
+    /**
+     * @brief Incrementally evaluated graph of values derived from a register image
+     *
+     * Input nodes read a register image entry (optionally scaled), operator
+     * nodes combine other nodes. Operands must be added before the nodes that
+     * use them, so node ids are always in topological order. An update only
+     * re-evaluates nodes downstream of changed image entries, and stops
+     * propagating at nodes whose value did not change, so the cost scales with
+     * the change volume rather than with the size of the graph.
+     *
+     * Rate-of-change nodes depend on time as well as on their input and are
+     * therefore evaluated on every update.
+     */
+    class DerivedTagGraph
+    {
+    public:
+        using NodeId = uint32_t;
+        using Function = std::function<double(std::span<const double>)>;
+
+        /// Returned by the add_* functions when an operand is invalid
+        static constexpr NodeId invalid_node = std::numeric_limits<NodeId>::max();
+
+        /**
+         * @brief Add a node reading one register image entry
+         *
+         * @param image_index Register image index (see ScanPlan)
+         * @param scale Factor applied to the raw value
+         * @param offset Offset added after scaling
+         * @return NodeId New node
+         */
+        NodeId add_input(uint32_t image_index, double scale = 1.0, double offset = 0.0);
+
+        /**
+         * @brief Add a node summing its operands (e.g. the three phases)
+         */
+        NodeId add_sum(std::span<const NodeId> operands);
+
+        /**
+         * @brief Add a node computing a - b
+         */
+        NodeId add_difference(NodeId a, NodeId b);
+
+        /**
+         * @brief Add a node computing a * b
+         */
+        NodeId add_product(NodeId a, NodeId b);
+
+        /**
+         * @brief Add a node computing a / b
+         */
+        NodeId add_quotient(NodeId a, NodeId b);
+
+        /**
+         * @brief Add a node computing the power factor P / sqrt(P^2 + Q^2)
+         *
+         * @param active Active power node
+         * @param reactive Reactive power node
+         */
+        NodeId add_power_factor(NodeId active, NodeId reactive);
+
+        /**
+         * @brief Add a node computing the rate of change of its input per second
+         *
+         * The rate is taken between the two most recent updates.
+         */
+        NodeId add_rate_of_change(NodeId input);
+
+        /**
+         * @brief Add a node computing an arbitrary function of its operands
+         */
+        NodeId add_function(std::span<const NodeId> operands, Function function);
+
+        /**
+         * @brief Propagate the change set of a scan through the graph
+         *
+         * @param result Latest scan result of a ScanPoller
+         */
+        void update(const ScanResult &result);
+
+        /**
+         * @brief Propagate a change set through the graph
+         *
+         * The first update evaluates every node regardless of the change set.
+         *
+         * @param image Register image
+         * @param changed Image indices that changed since the previous update
+         * @param timestamp Sample time of the image
+         */
+        void update(std::span<const uint16_t> image, std::span<const uint32_t> changed,
+                    std::chrono::system_clock::time_point timestamp);
+
+        /**
+         * @brief Get the current value of a node
+         *
+         * @return double Node value, NaN for an invalid node or before the first update
+         */
+        double value(NodeId node) const noexcept;
+
+        /**
+         * @brief Nodes whose value changed in the latest update (ascending)
+         */
+        std::span<const NodeId> changed() const noexcept { return changed_; }
+
+        /**
+         * @brief Number of nodes in the graph
+         */
+        size_t node_count() const noexcept { return ops_.size(); }
+
+    private:
+        enum class Op : uint8_t
+        {
+            input,
+            sum,
+            difference,
+            product,
+            quotient,
+            power_factor,
+            rate_of_change,
+            function
+        };
+
+        NodeId add_node(Op op, std::span<const NodeId> operands, uint32_t argument);
+        double evaluate(NodeId node, std::span<const uint16_t> image, double elapsed_seconds);
+        void schedule(NodeId node);
+
+        // Node storage (structure of arrays, indexed by NodeId)
+        std::vector<Op> ops_;
+        std::vector<uint32_t> arguments_;
+        std::vector<double> scales_;
+        std::vector<double> offsets_;
+        std::vector<uint32_t> operand_begin_;
+        std::vector<uint32_t> operand_count_;
+        std::vector<double> values_;
+        std::vector<double> previous_input_;
+        std::vector<uint8_t> queued_;
+        std::vector<std::vector<NodeId>> dependents_;
+
+        std::vector<NodeId> operands_;
+        std::vector<Function> functions_;
+        std::vector<NodeId> time_dependent_;
+        std::unordered_map<uint32_t, std::vector<NodeId>> inputs_by_index_;
+
+        std::vector<NodeId> heap_;
+        std::vector<NodeId> changed_;
+        std::vector<double> scratch_;
+        std::chrono::system_clock::time_point last_update_;
+        bool initialized_ = false;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Limit state of a tag
+     */
+    enum class LimitState : int8_t
+    {
+        lolo = -2,
+        lo = -1,
+        normal = 0,
+        hi = 1,
+        hihi = 2
+    };
+
+    /**
+     * @brief Alarm limits of a single tag
+     *
+     * Unused limits stay at +/- infinity. A state is entered when the value
+     * reaches its limit and left only once the value has moved back past the
+     * limit by more than the deadband (hysteresis).
+     */
+    struct LimitConfig
+    {
+        double lolo = -std::numeric_limits<double>::infinity();
+        double lo = -std::numeric_limits<double>::infinity();
+        double hi = std::numeric_limits<double>::infinity();
+        double hihi = std::numeric_limits<double>::infinity();
+        double deadband = 0.0;
+    };
+
+    /**
+     * @brief State change of a tag reported by LimitEvaluator
+     */
+    struct LimitTransition
+    {
+        uint32_t tag;
+        LimitState previous;
+        LimitState current;
+        double value;
+    };
+
+    /**
+     * @brief Evaluates HI/LO/HIHI/LOLO limits with hysteresis for many tags
+     *
+     * Limits are kept as contiguous arrays and evaluated in a branch-free pass
+     * over a decoded column (e.g. the output of RegisterTransform), which the
+     * compiler vectorizes. Only state transitions are reported, so callers can
+     * forward alarms instead of every value. Tag i corresponds to values[i].
+     */
+    class LimitEvaluator
+    {
+    public:
+        /**
+         * @brief Append a tag
+         *
+         * @param limits Limits of the tag
+         * @return true if the tag was added
+         * @return false if the limits are not ordered lolo <= lo < hi <= hihi
+         *         or the deadband is negative
+         */
+        bool add_tag(const LimitConfig &limits);
+
+        /**
+         * @brief Replace the limits of a tag, keeping its current state
+         *
+         * @param tag Tag index
+         * @param limits New limits
+         * @return true if the limits were replaced
+         * @return false if the tag does not exist or the limits are invalid
+         */
+        bool set_limits(size_t tag, const LimitConfig &limits);
+
+        /**
+         * @brief Number of tags
+         */
+        size_t tag_count() const noexcept { return hi_.size(); }
+
+        /**
+         * @brief Evaluate the limits against a new set of values
+         *
+         * @param values Decoded values, one per tag
+         * @return true if the values were evaluated
+         * @return false if values holds fewer than tag_count() elements
+         */
+        bool evaluate(std::span<const double> values);
+
+        /**
+         * @brief Transitions produced by the latest evaluate() call
+         */
+        std::span<const LimitTransition> transitions() const noexcept { return transitions_; }
+
+        /**
+         * @brief Current state of a tag
+         */
+        LimitState state(size_t tag) const noexcept;
+
+        /**
+         * @brief Return every tag to the normal state without reporting transitions
+         */
+        void reset();
+
+    private:
+        static bool valid(const LimitConfig &limits);
+        void store(size_t tag, const LimitConfig &limits);
+
+        // Entry thresholds and the thresholds a state is held down to
+        std::vector<double> lolo_;
+        std::vector<double> lo_;
+        std::vector<double> hi_;
+        std::vector<double> hihi_;
+        std::vector<double> lolo_hold_;
+        std::vector<double> lo_hold_;
+        std::vector<double> hi_hold_;
+        std::vector<double> hihi_hold_;
+
+        // Severity on the high and low side (0..2)
+        std::vector<double> high_;
+        std::vector<double> low_;
+        std::vector<double> next_high_;
+        std::vector<double> next_low_;
+
+        std::vector<LimitTransition> transitions_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
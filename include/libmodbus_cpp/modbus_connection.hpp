@@ -1,5 +1,8 @@
 #pragma once
 
+#include "libmodbus_cpp/rtu_frame.hpp"
+
+#include <chrono>
 #include <memory>
 #include <string>
 #include <cstdint>
@@ -13,11 +16,29 @@ namespace libmodbus_cpp
     inline namespace v1
     {
 
+    class AsciiLink;
+
+    /**
+     * @brief Timing of the most recent transaction of a connection
+     */
+    struct TransactionTiming
+    {
+        /// Time the request was handed to the transport
+        std::chrono::system_clock::time_point request_sent;
+        /// Time the response arrived
+        std::chrono::system_clock::time_point response_received;
+        /// true if response_received is a kernel receive timestamp
+        bool kernel_timestamp = false;
+    };
+
     /**
-     * @brief RAII wrapper for MODBUS TCP connection
+     * @brief RAII wrapper for MODBUS TCP, RTU or ASCII connection
      *
      * This class provides a modern C++23 interface to libmodbus with automatic
-     * resource management.
+     * resource management. An RTU or ASCII connection is a master on a serial
+     * line; select the slave with set_slave_id() before every request.
+     * libmodbus has no ASCII backend, so ASCII requests are framed by the
+     * library itself, without a libmodbus context.
      */
     class ModbusConnection
     {
@@ -30,6 +51,14 @@ namespace libmodbus_cpp
          */
         explicit ModbusConnection(const std::string &ip_address, int port = 502);
 
+        /**
+         * @brief Construct a new MODBUS RTU or ASCII connection
+         *
+         * @param serial Serial device and line settings (ASCII commonly uses 7 data bits)
+         * @param framing RTU or ASCII framing
+         */
+        explicit ModbusConnection(const SerialConfig &serial, SerialFraming framing = SerialFraming::rtu);
+
         /**
          * @brief Destroy the connection and cleanup resources
          */
@@ -85,6 +114,17 @@ namespace libmodbus_cpp
          */
         bool read_registers(uint16_t address, uint16_t count, uint16_t *values);
 
+        /**
+         * @brief Read multiple input registers (Modbus FC 04)
+         *
+         * @param address Starting input register address
+         * @param count Number of registers to read
+         * @param values Output array (must be at least count elements)
+         * @return true if read successful
+         * @return false if read failed
+         */
+        bool read_input_registers(uint16_t address, uint16_t count, uint16_t *values);
+
         /**
          * @brief Write a single holding register
          *
@@ -106,6 +146,46 @@ namespace libmodbus_cpp
          */
         bool write_registers(uint16_t address, uint16_t count, const uint16_t *values);
 
+        /**
+         * @brief Write a single holding register on all slaves (broadcast)
+         *
+         * The request goes to unit id 0 and no response is awaited: on a
+         * serial line every slave applies it silently, and a TCP gateway
+         * relays it to its RTU bus. The next request on this connection is
+         * held back until the frame is on the wire and the turnaround delay
+         * has passed (see set_turnaround_delay()). The slave id set with
+         * set_slave_id() is kept.
+         *
+         * @param address Register address
+         * @param value Value to write
+         * @return true if the request was sent
+         * @return false if it could not be sent
+         */
+        bool broadcast_write_register(uint16_t address, uint16_t value);
+
+        /**
+         * @brief Write multiple holding registers on all slaves (broadcast)
+         *
+         * See broadcast_write_register().
+         *
+         * @param address Starting register address
+         * @param count Number of registers to write
+         * @param values Input array (must be at least count elements)
+         * @return true if the request was sent
+         * @return false if it could not be sent
+         */
+        bool broadcast_write_registers(uint16_t address, uint16_t count, const uint16_t *values);
+
+        /**
+         * @brief Set the time slaves get to process a broadcast
+         *
+         * Counted from the end of the broadcast frame on the wire
+         * (default: 100 ms).
+         *
+         * @param delay Turnaround delay
+         */
+        void set_turnaround_delay(std::chrono::milliseconds delay) { turnaround_delay_ = delay; }
+
         /**
          * @brief Read a single coil status
          *
@@ -193,17 +273,57 @@ namespace libmodbus_cpp
          */
         void set_response_timeout(uint32_t seconds, uint32_t microseconds);
 
+        /**
+         * @brief Enable kernel receive timestamps for read responses
+         *
+         * Uses SO_TIMESTAMPING (software RX) on the TCP socket, so response
+         * times no longer include the scheduling jitter between packet
+         * arrival and the return of the read call. While enabled, read
+         * requests are sent and received through the raw libmodbus API so the
+         * timestamp can be fetched before the response is consumed. The
+         * setting survives reconnects. Only supported on Linux.
+         *
+         * @param enable true to enable, false to disable
+         * @return true if the setting was applied
+         * @return false if kernel timestamps are not supported
+         */
+        bool set_kernel_timestamps(bool enable);
+
+        /**
+         * @brief Check whether kernel receive timestamps are enabled
+         */
+        bool kernel_timestamps() const noexcept { return kernel_timestamps_; }
+
+        /**
+         * @brief Get the timing of the most recent transaction
+         *
+         * Without kernel timestamps, both times are taken in user space
+         * around the request.
+         */
+        const TransactionTiming &last_timing() const noexcept { return last_timing_; }
+
         /**
          * @brief Get the raw modbus context (for advanced use)
          *
-         * @return modbus_t* Raw context pointer
+         * @return modbus_t* Raw context pointer (nullptr for ASCII connections)
          */
         modbus_t *get_context() { return ctx_; }
 
     private:
+        bool apply_kernel_timestamps();
+        bool send_broadcast(const uint8_t *request, size_t length);
+
         modbus_t *ctx_;
         bool connected_;
+        bool serial_ = false;
+        std::unique_ptr<AsciiLink> ascii_; ///< Transport of ASCII connections (ctx_ is nullptr then)
         std::string last_error_;
+        bool kernel_timestamps_ = false;
+        TransactionTiming last_timing_;
+        uint16_t transaction_id_ = 0; ///< MBAP transaction id of the latest timed read
+        std::chrono::nanoseconds character_time_{0}; ///< Serial character time (0 for TCP)
+        std::chrono::milliseconds turnaround_delay_{100};
+        std::chrono::steady_clock::time_point turnaround_until_; ///< Set after a broadcast
     };
 
     } // namespace v1
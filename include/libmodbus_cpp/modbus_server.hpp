@@ -0,0 +1,434 @@
+#pragma once
+
+#include "libmodbus_cpp/rtu_frame.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Data table of a Modbus device
+     */
+    enum class RegisterTable : uint8_t
+    {
+        coils,
+        discrete_inputs,
+        holding_registers,
+        input_registers
+    };
+
+    /**
+     * @brief Response timing of a simulated device
+     *
+     * Every response is delayed by base plus a uniformly distributed share
+     * of jitter. A share of the requests (drop, 0..1) is never answered.
+     */
+    struct LatencyProfile
+    {
+        std::chrono::microseconds base{0};
+        std::chrono::microseconds jitter{0};
+        double drop = 0.0;
+    };
+
+    /**
+     * @brief Configuration of a simulated device
+     *
+     * Devices are addressed by port and unit id. Devices configured with the
+     * same port share one listening socket; port 0 selects an ephemeral port
+     * (shared by all devices configured with port 0). A device with a serial
+     * bus is an RTU slave on that bus instead and ignores the port.
+     */
+    struct DeviceConfig
+    {
+        uint16_t port = 502;
+        uint8_t unit_id = 1;
+        uint16_t coils = 0;             ///< Number of coils (addresses 0..coils-1)
+        uint16_t discrete_inputs = 0;
+        uint16_t holding_registers = 0;
+        uint16_t input_registers = 0;
+        LatencyProfile latency;
+        /// Serial bus returned by ModbusServer::add_serial_bus() (-1: Modbus TCP)
+        int serial_bus = -1;
+    };
+
+    /**
+     * @brief Configuration of a ModbusServer
+     */
+    struct ServerConfig
+    {
+        /// Address the listening sockets are bound to
+        std::string bind_address = "0.0.0.0";
+        /// Number of event-loop threads
+        size_t threads = 1;
+        /// Listen backlog of every listening socket
+        int backlog = 128;
+        /// Give every event loop its own SO_REUSEPORT listening sockets, so
+        /// the kernel spreads connections over the loops without a shared
+        /// accept queue (otherwise all loops share one socket per port)
+        bool reuse_port = false;
+        /// Pin event loop i to the i-th CPU the process may run on
+        bool pin_threads = false;
+        /// Serialized read responses cached per event loop (0 disables the cache)
+        size_t response_cache_entries = 256;
+        /// Sustained requests per second served per connection (token
+        /// bucket; 0 disables the limit). Requests above the rate are held
+        /// back, not rejected.
+        double client_request_rate = 0.0;
+        /// Requests a connection may send at once above client_request_rate
+        size_t client_burst = 16;
+        /// Requests per connection whose delayed response is still pending
+        /// before further requests are held back (0: no limit)
+        size_t max_in_flight = 0;
+        /// Requests served from one connection before the next ready
+        /// connection gets its turn
+        size_t dispatch_quantum = 1;
+        /// Threads running write handlers (started only if a device has one)
+        size_t write_workers = 1;
+        /// Write handler invocations queued at most; writes beyond it are
+        /// answered with exception 0x06 (server device busy)
+        size_t write_queue_capacity = 1024;
+    };
+
+    /**
+     * @brief Counters of a ModbusServer
+     */
+    struct ServerStats
+    {
+        uint64_t connections = 0; ///< Accepted connections
+        uint64_t requests = 0;    ///< Requests received
+        uint64_t exceptions = 0;  ///< Exception responses sent
+        uint64_t dropped = 0;     ///< Requests left unanswered by a latency profile
+        uint64_t protocol_errors = 0; ///< Connections closed because of malformed frames
+        uint64_t cache_hits = 0;      ///< Read responses served from the response cache
+        uint64_t cache_misses = 0;    ///< Read responses built and stored in the cache
+        uint64_t throttled = 0;         ///< Requests held back by a connection's token bucket
+        uint64_t in_flight_limited = 0; ///< Requests held back by the in-flight limit
+        uint64_t held_clients = 0;      ///< Connections with a request held back right now
+        uint64_t write_handler_runs = 0; ///< Writes passed to write handlers
+        uint64_t write_rejections = 0;   ///< Writes a write handler returned an exception code for
+        uint64_t write_queue_full = 0;   ///< Writes refused, or fire-and-forget handlers skipped, because the write queue was full
+        uint64_t serial_frames = 0;         ///< RTU frames received with a valid CRC
+        uint64_t serial_crc_errors = 0;     ///< RTU frames discarded because of a CRC mismatch
+        uint64_t serial_framing_errors = 0; ///< RTU frames discarded because of timing gaps or overruns
+    };
+
+    /**
+     * @brief Counters of one open client connection
+     */
+    struct ClientStats
+    {
+        std::string peer;               ///< Client address and port
+        uint16_t port = 0;              ///< Server port the client connected to
+        uint64_t requests = 0;          ///< Requests served
+        uint64_t throttled = 0;         ///< Requests held back by the token bucket
+        uint64_t in_flight_limited = 0; ///< Requests held back by the in-flight limit
+        size_t in_flight = 0;           ///< Delayed responses still pending
+        bool held = false;              ///< A request is held back right now
+    };
+
+    /**
+     * @brief How the response to a write with a write handler is sent
+     */
+    enum class WriteMode : uint8_t
+    {
+        /// The handler validates the write: values are stored and the
+        /// response is sent once it returns, or the exception code it
+        /// returns is sent instead
+        synchronous,
+        /// Values are stored and the response is sent at once; the handler
+        /// runs afterwards for its side effects and cannot reject the write
+        fire_and_forget
+    };
+
+    /**
+     * @brief A write by a master, as passed to a write handler
+     */
+    struct WriteRequest
+    {
+        size_t device = 0;                ///< Device index
+        RegisterTable table = RegisterTable::holding_registers;
+        uint16_t address = 0;             ///< First written address
+        std::span<const uint16_t> values; ///< Written values in host order (coils as 0/1)
+    };
+
+    /**
+     * @brief Handles writes to a register range
+     *
+     * Invoked on a write worker thread with the complete write (which may
+     * extend beyond the handler's range). Returns 0 to accept the write or
+     * a Modbus exception code (e.g. 0x03 illegal data value) to reject it.
+     */
+    using WriteHandler = std::function<uint8_t(const WriteRequest &request)>;
+
+    /**
+     * @brief Generates the values of a register range
+     *
+     * Invoked on an event-loop thread before a read of the range, with the
+     * time since the server was started and the current register values.
+     */
+    using ValueGenerator = std::function<void(std::chrono::nanoseconds elapsed, std::span<uint16_t> values)>;
+
+    /**
+     * @brief Generator counting up by step every step_period
+     *
+     * All registers of the range hold the same value, which wraps at 65536.
+     */
+    ValueGenerator ramp_generator(uint16_t start, uint16_t step, std::chrono::nanoseconds step_period);
+
+    /**
+     * @brief Generator of uniformly distributed values center +- amplitude
+     */
+    ValueGenerator noise_generator(uint16_t center, uint16_t amplitude, uint32_t seed = 1);
+
+    /**
+     * @brief Generator replaying captured register images
+     *
+     * Frame n is served from n * frame_period on; the capture is looped.
+     * Frames shorter than the range leave the remaining registers alone.
+     */
+    ValueGenerator replay_generator(std::vector<std::vector<uint16_t>> frames, std::chrono::nanoseconds frame_period);
+
+    /**
+     * @brief Modbus TCP server hosting many simulated devices in one process
+     *
+     * Requests are served by a few event-loop threads (epoll) instead of a
+     * thread or process per device. Each device has its own register images,
+     * optional value generators and a latency profile. Requests for unit ids
+     * without a device on the port are answered with exception 0x0B (gateway
+     * target device failed to respond).
+     *
+     * Devices and generators are added before start(). Register values may be
+     * read and written from any thread while the server runs.
+     *
+     * Registers are stored in Modbus wire order (big-endian): FC03/FC04
+     * responses and FC06/FC16 writes are plain copies, and byte swapping
+     * only happens in set_values()/get_values() and around generators.
+     *
+     * Every event loop caches serialized read responses by device, function
+     * code, address and count. An entry is reused while the device's version
+     * counter (incremented by every write and generator run) is unchanged and
+     * no generator of the range is due; a hit only copies the cached PDU
+     * behind the request's MBAP header, without taking the device lock.
+     *
+     * Received requests are served round-robin over the ready connections
+     * of a loop, dispatch_quantum requests per turn, so a client pipelining
+     * many requests cannot starve the others. A connection exceeding its
+     * token bucket or in-flight limit has its requests held back until it
+     * is within limits again; once its input buffer is full the server stops
+     * reading from it and TCP flow control slows the client down.
+     *
+     * Write handlers run on a pool of write worker threads fed by a
+     * lock-free queue, so slow validation or side effects never block an
+     * event loop; completions return to the loop through its eventfd. While
+     * a synchronous write is outstanding, later requests of the same
+     * connection wait (so a master reads its own writes), and other
+     * connections are served as usual.
+     *
+     * Devices on serial buses are served as RTU slaves by one thread per bus,
+     * which detects frames with the t1.5/t3.5 state machine of the Modbus
+     * serial line specification. A frame is only checked (CRC and unit id)
+     * until t3.5 of silence confirms it; then its writes are applied, its
+     * handlers run and it is answered.
+     * Frames for unit ids without a device on the bus are ignored (they may
+     * be for other slaves); broadcast writes (unit id 0) are applied by all
+     * devices of the bus and never answered. Synchronous write handlers of
+     * serial devices run on the bus thread, as the bus stays busy until the
+     * master has its response anyway.
+     * Only supported on Linux; elsewhere start() fails.
+     */
+    class ModbusServer
+    {
+    public:
+        /**
+         * @brief Construct a server
+         *
+         * Throws std::invalid_argument if threads, backlog, dispatch_quantum,
+         * write_workers or write_queue_capacity is not positive, or if a
+         * request rate is set with a zero burst.
+         *
+         * @param config Server configuration
+         */
+        explicit ModbusServer(const ServerConfig &config = {});
+
+        /**
+         * @brief Stop the server
+         */
+        ~ModbusServer();
+
+        ModbusServer(const ModbusServer &) = delete;
+        ModbusServer &operator=(const ModbusServer &) = delete;
+
+        /**
+         * @brief Add a simulated device
+         *
+         * Throws std::invalid_argument if another device already uses the port
+         * (or serial bus) and unit id, if the serial bus does not exist or a
+         * serial device has unit id 0, or if the server is running.
+         *
+         * @param config Device configuration
+         * @return size_t Device index
+         */
+        size_t add_device(const DeviceConfig &config);
+
+        /**
+         * @brief Add a serial bus for RTU slave devices
+         *
+         * Throws std::invalid_argument if the baud rate is not positive or
+         * if the server is running.
+         *
+         * @param config Serial line settings
+         * @return int Bus index for DeviceConfig::serial_bus
+         */
+        int add_serial_bus(const SerialConfig &config);
+
+        /**
+         * @brief Number of devices
+         */
+        size_t device_count() const noexcept { return devices_.size(); }
+
+        /**
+         * @brief Attach a value generator to a register range of a device
+         *
+         * @param device Device index
+         * @param table holding_registers or input_registers
+         * @param address First register of the range
+         * @param count Number of registers
+         * @param generator Generator function
+         * @param period Minimum time between two invocations (0: before every read)
+         * @return true if the generator was attached
+         * @return false if the device, table or range is invalid or the server is running
+         */
+        bool add_generator(size_t device, RegisterTable table, uint16_t address, uint16_t count,
+                           ValueGenerator generator, std::chrono::nanoseconds period = std::chrono::nanoseconds::zero());
+
+        /**
+         * @brief Attach a write handler to a coil or holding register range of a device
+         *
+         * A write overlapping the ranges of several handlers runs all of them
+         * in the order they were added; it is synchronous if any of them is.
+         *
+         * @param device Device index
+         * @param table coils or holding_registers
+         * @param address First address of the range
+         * @param count Number of addresses
+         * @param handler Handler function
+         * @param mode When the response is sent
+         * @return true if the handler was attached
+         * @return false if the device, table or range is invalid or the server is running
+         */
+        bool add_write_handler(size_t device, RegisterTable table, uint16_t address, uint16_t count,
+                               WriteHandler handler, WriteMode mode = WriteMode::synchronous);
+
+        /**
+         * @brief Set a value of a device (thread-safe)
+         *
+         * @param device Device index
+         * @param table Data table (bits are set for non-zero values)
+         * @param address Address within the table
+         * @param value New value
+         * @return true if the value was set
+         * @return false if the device or address does not exist
+         */
+        bool set_value(size_t device, RegisterTable table, uint16_t address, uint16_t value);
+
+        /**
+         * @brief Read a value of a device (thread-safe)
+         *
+         * @return true if the value was read
+         * @return false if the device or address does not exist
+         */
+        bool get_value(size_t device, RegisterTable table, uint16_t address, uint16_t &value) const;
+
+        /**
+         * @brief Set consecutive values of a device under one lock (thread-safe)
+         *
+         * @param device Device index
+         * @param table Data table (bits are set for non-zero values)
+         * @param address First address
+         * @param values New values in host order
+         * @return true if the values were set
+         * @return false if the device does not exist or the range is empty or out of bounds
+         */
+        bool set_values(size_t device, RegisterTable table, uint16_t address, std::span<const uint16_t> values);
+
+        /**
+         * @brief Read consecutive values of a device under one lock (thread-safe)
+         *
+         * @return true if the values were read
+         * @return false if the device does not exist or the range is empty or out of bounds
+         */
+        bool get_values(size_t device, RegisterTable table, uint16_t address, std::span<uint16_t> values) const;
+
+        /**
+         * @brief Open the listening sockets and start the event loops
+         *
+         * @return true if the server is running
+         * @return false on failure (see get_last_error())
+         */
+        bool start();
+
+        /**
+         * @brief Stop the event loops and close all sockets
+         */
+        void stop();
+
+        /**
+         * @brief Check if the server is running
+         */
+        bool running() const noexcept { return !loops_.empty(); }
+
+        /**
+         * @brief Port a device is reachable on (the bound port after start(); 0 for serial devices)
+         */
+        uint16_t port(size_t device) const;
+
+        /**
+         * @brief Counters summed over all event loops since construction
+         */
+        ServerStats stats() const;
+
+        /**
+         * @brief Counters of the currently open client connections
+         */
+        std::vector<ClientStats> client_stats() const;
+
+        /**
+         * @brief Get the last error message
+         */
+        std::string get_last_error() const;
+
+    private:
+        struct Device;
+        struct Listener;
+        struct WritePool;
+        class EventLoop;
+        class SerialBus;
+
+        Listener *find_listener(uint16_t configured_port);
+        size_t add_serial_device(const DeviceConfig &config);
+        std::unique_ptr<Device> make_device(const DeviceConfig &config) const;
+
+        ServerConfig config_;
+        std::vector<std::unique_ptr<Device>> devices_;
+        std::vector<std::unique_ptr<Listener>> listeners_;
+        std::unique_ptr<WritePool> write_pool_;
+        std::vector<std::unique_ptr<EventLoop>> loops_;
+        std::vector<std::unique_ptr<SerialBus>> serial_buses_;
+        std::chrono::steady_clock::time_point started_;
+        uint32_t bind_address_ = 0; ///< IPv4 bind address in network order
+        ServerStats retired_stats_; ///< Counters of loops destroyed by stop()
+        std::string last_error_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Encoding of a raw value inside a register block
+     */
+    enum class RawType : uint8_t
+    {
+        uint16,  ///< One register, unsigned
+        int16,   ///< One register, two's complement
+        uint32,  ///< Two registers, unsigned
+        int32,   ///< Two registers, two's complement
+        float32  ///< Two registers, IEEE 754 single precision
+    };
+
+    /**
+     * @brief Order of the two registers that make up a 32-bit value
+     */
+    enum class WordOrder : uint8_t
+    {
+        high_word_first, ///< Modbus convention (big-endian word order)
+        low_word_first   ///< Word-swapped layout used by many PLCs
+    };
+
+    /**
+     * @brief Engineering-unit transformation of a single tag
+     *
+     * The output value is clamp(raw * scale + offset, min, max).
+     */
+    struct TagTransform
+    {
+        uint16_t register_offset = 0; ///< Offset of the (first) register within the block
+        RawType type = RawType::uint16;
+        WordOrder word_order = WordOrder::high_word_first;
+        double scale = 1.0;
+        double offset = 0.0;
+        double min = -std::numeric_limits<double>::infinity();
+        double max = std::numeric_limits<double>::infinity();
+    };
+
+    /**
+     * @brief Transform stage turning a raw register block into an output column
+     *
+     * Tags are kept as contiguous arrays (structure of arrays) rather than as
+     * individual objects. Applying the stage first decodes every tag into the
+     * output column, grouped by raw type, and then runs a single branch-free
+     * scale/offset/clamp pass over the whole column that the compiler can
+     * vectorize. Output column i belongs to the i-th tag added.
+     */
+    class RegisterTransform
+    {
+    public:
+        /**
+         * @brief Append a tag to the stage
+         *
+         * @param tag Tag description
+         * @return true if the tag was added
+         * @return false if min is greater than max or a 32-bit tag starts at
+         *         register offset 0xFFFF
+         */
+        bool add_tag(const TagTransform &tag);
+
+        /**
+         * @brief Remove all tags
+         */
+        void clear();
+
+        /**
+         * @brief Number of tags (and output values) of the stage
+         */
+        size_t tag_count() const noexcept { return double_.scale.size(); }
+
+        /**
+         * @brief Minimum block size (in registers) accepted by apply()
+         */
+        size_t required_registers() const noexcept { return required_registers_; }
+
+        /**
+         * @brief Transform a register block into engineering values
+         *
+         * @param block Registers as returned by ModbusConnection::read_registers
+         * @param out Output column (must hold at least tag_count() elements)
+         * @return true if the block was transformed
+         * @return false if block or out are too small
+         */
+        bool apply(std::span<const uint16_t> block, std::span<double> out) const;
+
+        /**
+         * @brief Transform a register block into single precision values
+         *
+         * @param block Registers as returned by ModbusConnection::read_registers
+         * @param out Output column (must hold at least tag_count() elements)
+         * @return true if the block was transformed
+         * @return false if block or out are too small
+         */
+        bool apply(std::span<const uint16_t> block, std::span<float> out) const;
+
+    private:
+        static constexpr size_t raw_type_count = 5;
+
+        template <typename T>
+        struct Coefficients
+        {
+            std::vector<T> scale;
+            std::vector<T> offset;
+            std::vector<T> min;
+            std::vector<T> max;
+        };
+
+        // Per raw type: output index and register offsets of the high and
+        // low word (the low word is unused for 16-bit types).
+        struct DecodeGroup
+        {
+            std::vector<uint32_t> tags;
+            std::vector<uint16_t> high;
+            std::vector<uint16_t> low;
+        };
+
+        template <typename T>
+        bool apply_impl(std::span<const uint16_t> block, std::span<T> out,
+                        const Coefficients<T> &coefficients) const;
+
+        std::array<DecodeGroup, raw_type_count> groups_;
+        Coefficients<double> double_;
+        Coefficients<float> float_;
+        size_t required_registers_ = 0;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
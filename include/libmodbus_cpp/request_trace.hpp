@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Lifecycle stage recorded by the request tracer
+     */
+    enum class TraceEvent : uint8_t
+    {
+        enqueue,    ///< Scan became due (scheduler deadline)
+        dequeue,    ///< Scan was started
+        send,       ///< Request handed to the socket
+        first_byte, ///< First response byte arrived (kernel timestamp, if enabled)
+        complete,   ///< Response parsed or transaction failed
+        retry,      ///< Transaction is retried after a data error
+        drain,      ///< Stale bytes are drained from the socket before a retry
+        scan_end    ///< Scan finished, including image diffing and listeners
+    };
+
+    /**
+     * @brief A single trace record
+     */
+    struct TraceRecord
+    {
+        std::chrono::system_clock::time_point time;
+        uint64_t scan = 0;        ///< Scan the record belongs to (0 outside of scans)
+        uint64_t transaction = 0; ///< Transaction id (0 for scan-level records)
+        TraceEvent event = TraceEvent::send;
+        uint8_t function = 0;     ///< Modbus function code
+        uint16_t address = 0;
+        uint16_t count = 0;
+        int32_t error = 0;        ///< errno of failed completions and retries
+        uint32_t thread = 0;      ///< Recording thread (assigned by the tracer)
+    };
+
+    /**
+     * @brief Where the time of traced scans went
+     *
+     * Network and device time cannot be told apart from the client side;
+     * both are contained in the round trip from send to first byte.
+     */
+    struct StageBreakdown
+    {
+        uint64_t scans = 0;
+        uint64_t transactions = 0;
+        uint64_t retries = 0;
+        uint64_t drains = 0;
+        std::chrono::nanoseconds queueing{0};    ///< Due until started (enqueue to dequeue)
+        std::chrono::nanoseconds preparation{0}; ///< Client time before each send
+        std::chrono::nanoseconds round_trip{0};  ///< Network plus device (send to first byte)
+        std::chrono::nanoseconds receive{0};     ///< Response reception and parsing (first byte to complete)
+        std::chrono::nanoseconds processing{0};  ///< Decoding and listeners after the last response (complete to scan end)
+    };
+
+    /**
+     * @brief Process-wide request lifecycle tracer
+     *
+     * Every recording thread writes to its own fixed-size ring buffer, so
+     * recording is lock-free and allocation-free once a thread has recorded
+     * its first event. When a ring is full the oldest records are
+     * overwritten. ModbusConnection records send, first byte, complete,
+     * retry and drain events; ScanScheduler and AlignedScanGroup wrap every
+     * scan in enqueue, dequeue and scan end events. Nothing is recorded
+     * while the tracer is disabled.
+     */
+    class RequestTracer
+    {
+    public:
+        static constexpr size_t default_capacity = 65536;
+
+        /**
+         * @brief Get the process-wide tracer
+         */
+        static RequestTracer &instance();
+
+        RequestTracer(const RequestTracer &) = delete;
+        RequestTracer &operator=(const RequestTracer &) = delete;
+
+        /**
+         * @brief Start recording
+         *
+         * @param capacity_per_thread Ring size of threads that record for
+         *        the first time (existing rings keep their size)
+         */
+        void enable(size_t capacity_per_thread = default_capacity);
+
+        /**
+         * @brief Stop recording (recorded events are kept)
+         */
+        void disable() noexcept;
+
+        /**
+         * @brief Check whether events are recorded
+         */
+        bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Record an event in the ring of the calling thread
+         *
+         * The scan id of the calling thread is filled in if the record has none.
+         */
+        void record(TraceRecord record);
+
+        /**
+         * @brief Allocate a transaction id
+         */
+        uint64_t next_transaction() noexcept;
+
+        /**
+         * @brief Open a scan on the calling thread
+         *
+         * Records the enqueue and dequeue events; transactions recorded on
+         * this thread until end_scan() belong to the scan.
+         *
+         * @param enqueued Time the scan became due
+         * @return uint64_t Scan id
+         */
+        uint64_t begin_scan(std::chrono::system_clock::time_point enqueued);
+
+        /**
+         * @brief Close the scan of the calling thread and record its end
+         */
+        void end_scan();
+
+        /**
+         * @brief Get a snapshot of all recorded events, ordered by time
+         *
+         * Records that are overwritten while the snapshot is taken are
+         * dropped.
+         */
+        std::vector<TraceRecord> collect() const;
+
+        /**
+         * @brief Discard all recorded events
+         */
+        void clear();
+
+        /**
+         * @brief Sum up the stage durations of the given records
+         */
+        static StageBreakdown breakdown(std::span<const TraceRecord> records);
+
+        /**
+         * @brief Write the recorded events in the Chrome trace event format
+         *
+         * The file can be opened in chrome://tracing or Perfetto.
+         *
+         * @param path Output file
+         * @return true if the file was written
+         * @return false if the file could not be written
+         */
+        bool write_chrome_trace(const std::string &path) const;
+
+        /**
+         * @brief Write the recorded events as OTLP/JSON spans
+         *
+         * Every scan becomes a trace with one client span per transaction.
+         *
+         * @param path Output file
+         * @return true if the file was written
+         * @return false if the file could not be written
+         */
+        bool write_otlp(const std::string &path) const;
+
+        /**
+         * @brief Get the last error message
+         *
+         * @return std::string Error message
+         */
+        std::string get_last_error() const;
+
+    private:
+        struct ThreadBuffer;
+
+        RequestTracer() = default;
+        ThreadBuffer &thread_buffer();
+
+        std::atomic<bool> enabled_{false};
+        std::atomic<size_t> capacity_{default_capacity};
+        std::atomic<uint64_t> next_transaction_{0};
+        std::atomic<uint64_t> next_scan_{0};
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+        mutable std::string last_error_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Settings of a serial line (Modbus RTU)
+     */
+    struct SerialConfig
+    {
+        std::string device;  ///< Serial device, e.g. /dev/ttyUSB0 or a pty
+        int baud = 19200;
+        char parity = 'E';   ///< 'N', 'E' or 'O'
+        int data_bits = 8;
+        int stop_bits = 1;
+    };
+
+    /**
+     * @brief Framing of a serial connection
+     */
+    enum class SerialFraming
+    {
+        rtu,  ///< Binary frames with CRC-16, delimited by silent intervals
+        ascii ///< Hex encoded frames with LRC, delimited by ':' and CR LF
+    };
+
+    /**
+     * @brief Character timing of a serial line
+     *
+     * Characters of one RTU frame follow each other within t1.5; frames are
+     * separated by at least t3.5 of silence. Above 19200 baud the Modbus
+     * serial line specification fixes t1.5 at 750 us and t3.5 at 1750 us.
+     */
+    struct RtuTiming
+    {
+        std::chrono::nanoseconds character{0}; ///< Time to transmit one character
+        std::chrono::nanoseconds t15{0};       ///< Maximum gap within a frame
+        std::chrono::nanoseconds t35{0};       ///< Minimum gap between frames
+    };
+
+    /**
+     * @brief Character timing of a serial configuration
+     *
+     * Throws std::invalid_argument if the baud rate is not positive.
+     */
+    RtuTiming rtu_timing(const SerialConfig &config);
+
+    /**
+     * @brief Modbus CRC-16 (polynomial 0xA001, initial value 0xFFFF)
+     *
+     * The CRC is transmitted low byte first.
+     */
+    uint16_t rtu_crc16(std::span<const uint8_t> data);
+
+    /**
+     * @brief Check the CRC of a complete RTU frame
+     *
+     * @param frame Address, PDU and CRC
+     * @return true if the frame is at least 4 bytes long and its CRC matches
+     * @return false otherwise
+     */
+    bool rtu_check_crc(std::span<const uint8_t> frame);
+
+    /**
+     * @brief Append the CRC to an RTU frame
+     *
+     * @param frame Buffer holding address and PDU, with room for two more bytes
+     * @param length Length of address and PDU
+     * @return size_t Length of the frame including the CRC
+     */
+    size_t rtu_append_crc(uint8_t *frame, size_t length);
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "libmodbus_cpp/rtu_frame.hpp"
+#include "libmodbus_cpp/scan_plan.hpp"
+#include "libmodbus_cpp/scan_poller.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Modbus RTU master driving many serial buses from one thread
+     *
+     * Every bus is a serial port with its own request queue and timing; all
+     * of them are multiplexed by one epoll loop, so a request on one bus
+     * never waits for another bus. Devices are scanned like with
+     * ScanScheduler: at every deadline (fixed rate) all blocks of the
+     * device's ScanPlan are queued on its bus, and when the last one is
+     * answered the listeners get the ScanResult. A scan still in progress
+     * at the next deadline skips it (counted as overrun).
+     *
+     * On a bus, requests are sent one at a time. A response is complete
+     * once the length implied by its function code has arrived; the next
+     * request waits for t3.5 of silence after the response or timeout.
+     *
+     * Broadcast writes (unit id 0) join the queue of their bus in order
+     * with the scan requests. No slave answers them; instead the bus stays
+     * silent for the turnaround delay of the bus after the frame, so the
+     * slaves have applied the write before the next request.
+     * Only supported on Linux; elsewhere open() fails.
+     */
+    class RtuMaster
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /// Invoked on the master thread after every scan of a device.
+        using Listener = std::function<void(size_t device, const ScanResult &result, bool success)>;
+
+        /**
+         * @brief Transaction counters of a bus
+         */
+        struct BusStats
+        {
+            uint64_t requests = 0;    ///< Requests sent
+            uint64_t responses = 0;   ///< Valid responses (including exceptions)
+            uint64_t exceptions = 0;  ///< Exception responses
+            uint64_t timeouts = 0;    ///< Requests without a complete response in time
+            uint64_t crc_errors = 0;  ///< Responses with a CRC mismatch
+            uint64_t invalid = 0;     ///< Responses not matching their request
+            uint64_t stray_bytes = 0; ///< Bytes received outside a transaction
+            uint64_t broadcasts = 0;  ///< Broadcast writes sent (not counted in requests)
+        };
+
+        /**
+         * @brief Scan statistics of a device
+         */
+        struct DeviceStats
+        {
+            uint64_t scans = 0;       ///< Scans performed
+            uint64_t failures = 0;    ///< Scans with at least one failed block
+            uint64_t overruns = 0;    ///< Deadlines skipped because a scan was still in progress
+            uint64_t block_reads = 0; ///< Read requests issued
+        };
+
+        RtuMaster();
+        ~RtuMaster();
+
+        RtuMaster(const RtuMaster &) = delete;
+        RtuMaster &operator=(const RtuMaster &) = delete;
+
+        /**
+         * @brief Add a serial bus
+         *
+         * Throws std::invalid_argument if the baud rate or the timeout is
+         * not positive, the turnaround delay is negative, or if the master
+         * is open.
+         *
+         * @param config Serial line settings
+         * @param response_timeout Time a slave has to respond, counted from
+         *        the end of the request on the wire
+         * @param turnaround_delay Silence after a broadcast, counted from
+         *        the end of the frame on the wire
+         * @return int Bus index
+         */
+        int add_bus(const SerialConfig &config,
+                    clock::duration response_timeout = std::chrono::milliseconds(500),
+                    clock::duration turnaround_delay = std::chrono::milliseconds(100));
+
+        /**
+         * @brief Add a device scanned on a bus
+         *
+         * The first scan is due when run() starts. Throws
+         * std::invalid_argument if the bus does not exist, the unit id is
+         * not 1..247, the interval is not positive or the master is open.
+         *
+         * @param bus Bus index
+         * @param unit_id Unit id of the slave
+         * @param plan Blocks to read on every scan
+         * @param interval Scan interval
+         * @return size_t Device index
+         */
+        size_t add_device(int bus, uint8_t unit_id, ScanPlan plan, clock::duration interval);
+
+        /**
+         * @brief Register a listener for the scans of a device
+         *
+         * @param device Device index
+         * @param listener Callback invoked after every scan of the device
+         * @return true if the listener was registered
+         * @return false if the device does not exist
+         */
+        bool add_listener(size_t device, Listener listener);
+
+        /**
+         * @brief Queue a broadcast write of one holding register (FC 06)
+         *
+         * May be called from any thread, including listeners. The write is
+         * sent by run() once the requests queued before it are done.
+         *
+         * @param bus Bus index
+         * @param address Register address
+         * @param value Value to write
+         * @return true if the write was queued
+         * @return false if the bus does not exist
+         */
+        bool broadcast_write_register(int bus, uint16_t address, uint16_t value);
+
+        /**
+         * @brief Queue a broadcast write of holding registers (FC 16)
+         *
+         * See broadcast_write_register().
+         *
+         * @param bus Bus index
+         * @param address Starting register address
+         * @param count Number of registers to write (1..123)
+         * @param values Input array (must be at least count elements)
+         * @return true if the write was queued
+         * @return false if the bus does not exist or count is out of range
+         */
+        bool broadcast_write_registers(int bus, uint16_t address, uint16_t count, const uint16_t *values);
+
+        /**
+         * @brief Open the serial ports of all buses
+         *
+         * @return true if every port was opened
+         * @return false if a port could not be opened (see get_last_error())
+         */
+        bool open();
+
+        /**
+         * @brief Close all serial ports
+         */
+        void close();
+
+        /**
+         * @brief Check whether the ports are open
+         */
+        bool is_open() const noexcept { return epoll_ != -1; }
+
+        /**
+         * @brief Scan all devices until a stop is requested
+         *
+         * Returns right away if the master is not open.
+         *
+         * @param stop Stop token; requesting a stop also interrupts the wait
+         *        for serial input or the next deadline
+         */
+        void run(std::stop_token stop);
+
+        /**
+         * @brief Number of buses
+         */
+        size_t bus_count() const noexcept { return buses_.size(); }
+
+        /**
+         * @brief Number of devices
+         */
+        size_t device_count() const noexcept { return devices_.size(); }
+
+        /**
+         * @brief Result of the latest scan of a device
+         *
+         * Consistent on the master thread (in listeners) or after run() returned.
+         */
+        const ScanResult &result(size_t device) const;
+
+        /**
+         * @brief Scan statistics of a device (see result() for consistency)
+         */
+        const DeviceStats &stats(size_t device) const;
+
+        /**
+         * @brief Transaction counters of a bus (see result() for consistency)
+         */
+        const BusStats &bus_stats(int bus) const;
+
+        /**
+         * @brief Get the last error message
+         *
+         * @return std::string Error message
+         */
+        std::string get_last_error() const;
+
+    private:
+        struct Bus;
+        struct Device;
+
+        bool submit_broadcast(int bus, std::vector<uint8_t> frame);
+        void collect_broadcasts();
+        void begin_scans(clock::time_point now);
+        void start_request(Bus &bus, clock::time_point now);
+        void send(Bus &bus, clock::time_point now);
+        void receive(Bus &bus, clock::time_point now);
+        void finish_request(Bus &bus, bool success, clock::time_point now);
+        bool store_response(Bus &bus);
+        void expire(clock::time_point now);
+        void watch(Bus &bus, bool writable);
+        void arm_timer();
+
+        std::vector<std::unique_ptr<Bus>> buses_;
+        std::vector<std::unique_ptr<Device>> devices_;
+        int epoll_ = -1;
+        int timer_ = -1;
+        int wake_ = -1;
+        std::string last_error_;
+        std::mutex mutex_; ///< Guards submitted_ and the use of wake_ by other threads
+        std::vector<std::pair<size_t, std::vector<uint8_t>>> submitted_; ///< Broadcasts not yet queued on their bus
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
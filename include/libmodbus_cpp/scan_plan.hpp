@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Data table a scan block reads from
+     */
+    enum class BlockKind : uint8_t
+    {
+        holding_registers, ///< Modbus FC 03
+        input_registers,   ///< Modbus FC 04
+        coils,             ///< Modbus FC 01
+        discrete_inputs    ///< Modbus FC 02
+    };
+
+    /**
+     * @brief One contiguous read request of a scan
+     */
+    struct ScanBlock
+    {
+        BlockKind kind = BlockKind::holding_registers;
+        uint16_t address = 0;
+        uint16_t count = 0;
+    };
+
+    /**
+     * @brief Ordered list of blocks that make up one scan of a device
+     *
+     * All blocks are mapped into a single register image: block i occupies
+     * the image entries [block_offset(i), block_offset(i) + count). Coils and
+     * discrete inputs take one entry (0 or 1) per bit.
+     */
+    class ScanPlan
+    {
+    public:
+        /// Maximum registers per read request (Modbus application protocol)
+        static constexpr uint16_t max_registers_per_block = 125;
+        /// Maximum bits per read request (Modbus application protocol)
+        static constexpr uint16_t max_bits_per_block = 2000;
+
+        /**
+         * @brief Append a block to the plan
+         *
+         * @param kind Data table to read
+         * @param address Starting address
+         * @param count Number of registers or bits
+         * @return true if the block was added
+         * @return false if count is zero, exceeds the protocol limit or the
+         *         block runs past address 0xFFFF
+         */
+        bool add_block(BlockKind kind, uint16_t address, uint16_t count);
+
+        /**
+         * @brief Blocks of the plan in scan order
+         */
+        const std::vector<ScanBlock> &blocks() const noexcept { return blocks_; }
+
+        /**
+         * @brief Offset of a block within the register image
+         *
+         * @param index Block index
+         */
+        size_t block_offset(size_t index) const { return offsets_[index]; }
+
+        /**
+         * @brief Total number of register image entries
+         */
+        size_t image_size() const noexcept { return image_size_; }
+
+        /**
+         * @brief Find the block containing an image entry
+         *
+         * @param image_index Register image index
+         * @return size_t Block index, or blocks().size() if out of range
+         */
+        size_t find_block(size_t image_index) const;
+
+    private:
+        std::vector<ScanBlock> blocks_;
+        std::vector<size_t> offsets_;
+        size_t image_size_ = 0;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "libmodbus_cpp/scan_plan.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    class ModbusConnection;
+
+    /**
+     * @brief Register image and change set produced by a scan
+     */
+    struct ScanResult
+    {
+        /// One entry per register (or bit) of the plan, see ScanPlan
+        std::vector<uint16_t> image;
+        /// Image indices whose value changed in the latest scan (ascending)
+        std::vector<uint32_t> changed;
+        /// Per block: 1 if the latest read of the block succeeded
+        std::vector<uint8_t> block_valid;
+        /// Per block: 1 if the block was read in the latest scan
+        std::vector<uint8_t> block_polled;
+        /// Per block: 1 if the latest scan changed any entry of the block
+        std::vector<uint8_t> block_changed;
+        /// Per block: time the latest read request was issued
+        std::vector<std::chrono::system_clock::time_point> block_sent;
+        /// Per block: time the latest response was received
+        std::vector<std::chrono::system_clock::time_point> block_received;
+        /// Number of scans performed so far
+        uint64_t cycle = 0;
+        /// Time the latest scan started
+        std::chrono::system_clock::time_point timestamp;
+    };
+
+    /**
+     * @brief Executes a scan plan over a connection and diffs the results
+     *
+     * Each call to poll() reads every block of the plan and records which
+     * register image entries changed compared to the previous scan, so
+     * downstream stages can work on the change set instead of on every tag.
+     * The poller does not own the connection.
+     */
+    class ScanPoller
+    {
+    public:
+        /**
+         * @brief Construct a poller
+         *
+         * @param connection Connection used for all reads (must outlive the poller)
+         * @param plan Blocks to read on every scan
+         */
+        ScanPoller(ModbusConnection &connection, ScanPlan plan);
+
+        /**
+         * @brief Read all blocks of the plan once
+         *
+         * Blocks that fail are marked invalid and keep their previous image
+         * contents; the remaining blocks are still read.
+         *
+         * @return true if every block was read
+         * @return false if at least one block failed
+         */
+        bool poll();
+
+        /**
+         * @brief Read a subset of the blocks of the plan
+         *
+         * Blocks not listed keep their image contents and are reported as
+         * neither polled nor changed.
+         *
+         * @param blocks Block indices in ascending order
+         * @return true if every listed block was read
+         * @return false if at least one block failed or an index is invalid
+         */
+        bool poll(std::span<const size_t> blocks);
+
+        /**
+         * @brief Get the result of the latest scan
+         */
+        const ScanResult &result() const noexcept { return result_; }
+
+        /**
+         * @brief Get the scan plan
+         */
+        const ScanPlan &plan() const noexcept { return plan_; }
+
+        /**
+         * @brief Get the underlying connection
+         */
+        ModbusConnection &connection() noexcept { return connection_; }
+
+        /**
+         * @brief Get the last error message
+         *
+         * @return std::string Error message
+         */
+        std::string get_last_error() const;
+
+    private:
+        void begin_scan();
+        bool read_block(size_t index);
+
+        ModbusConnection &connection_;
+        ScanPlan plan_;
+        ScanResult result_;
+        std::vector<uint8_t> block_seen_;
+        std::vector<uint16_t> register_buffer_;
+        std::vector<uint8_t> bit_buffer_;
+        std::string last_error_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
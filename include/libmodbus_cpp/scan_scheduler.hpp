@@ -0,0 +1,187 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    class ScanPoller;
+    struct ScanResult;
+
+    /**
+     * @brief Deadline-driven scheduler running the scans of several devices
+     *
+     * Every device is a ScanPoller with its own scan interval. Deadlines
+     * advance by whole intervals (fixed rate, no drift); if a scan overruns
+     * past one or more later deadlines, those slots are skipped and counted.
+     * With adaptive rates enabled, every block of a device has its own
+     * interval that backs off while the block does not change.
+     * The scheduler runs on the calling thread and does not own the pollers.
+     */
+    class ScanScheduler
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /// Invoked on the scheduler thread after every scan of a device.
+        /// Listeners may call set_interval() but not add devices or listeners.
+        using Listener = std::function<void(size_t device, const ScanResult &result, bool success)>;
+
+        /**
+         * @brief Scan statistics of a device
+         */
+        struct DeviceStats
+        {
+            uint64_t scans = 0;       ///< Scans performed
+            uint64_t failures = 0;    ///< Scans with at least one failed block
+            uint64_t overruns = 0;    ///< Deadlines skipped because a scan ran late
+            uint64_t block_reads = 0; ///< Read requests issued
+            /// Block deadlines skipped because a scan ran late (adaptive rates only)
+            uint64_t block_overruns = 0;
+        };
+
+        /**
+         * @brief Back-off policy for blocks that do not change
+         *
+         * After stable_scans consecutive reads without a change, the block
+         * interval is multiplied by backoff_factor, up to max_interval. Any
+         * change or failed read snaps the block back to the device interval.
+         */
+        struct AdaptiveRate
+        {
+            clock::duration max_interval{std::chrono::seconds(60)};
+            double backoff_factor = 2.0;
+            uint32_t stable_scans = 3;
+        };
+
+        /**
+         * @brief Add a device
+         *
+         * The first scan is due immediately.
+         *
+         * @param poller Poller of the device (must outlive the scheduler)
+         * @param interval Scan interval (must be positive)
+         * @return size_t Device index
+         */
+        size_t add_device(ScanPoller &poller, clock::duration interval);
+
+        /**
+         * @brief Number of devices
+         */
+        size_t device_count() const noexcept { return devices_.size(); }
+
+        /**
+         * @brief Change the scan interval of a device
+         *
+         * The next deadline is moved so it is at most one new interval after
+         * the previous scan.
+         *
+         * @param device Device index
+         * @param interval New interval (must be positive)
+         * @return true if the interval was changed
+         * @return false if the device does not exist or the interval is not positive
+         */
+        bool set_interval(size_t device, clock::duration interval);
+
+        /**
+         * @brief Current scan interval of a device
+         */
+        clock::duration interval(size_t device) const { return devices_[device].interval; }
+
+        /**
+         * @brief Enable per-block adaptive scan rates for a device
+         *
+         * The device interval becomes the fastest (and initial) block interval.
+         *
+         * @param device Device index
+         * @param rate Back-off policy
+         * @return true if adaptive rates were enabled
+         * @return false if the device does not exist, the factor is not
+         *         greater than one or max_interval is below the device interval
+         */
+        bool set_adaptive(size_t device, const AdaptiveRate &rate);
+
+        /**
+         * @brief Current interval of a block of an adaptive device
+         *
+         * @return clock::duration Block interval, or the device interval if
+         *         adaptive rates are not enabled
+         */
+        clock::duration block_interval(size_t device, size_t block) const;
+
+        /**
+         * @brief Register a listener for the scans of a device
+         *
+         * @param device Device index
+         * @param listener Callback invoked after every scan of the device
+         * @return true if the listener was registered
+         * @return false if the device does not exist
+         */
+        bool add_listener(size_t device, Listener listener);
+
+        /**
+         * @brief Scan every device whose deadline has passed
+         *
+         * @param now Current time
+         * @return size_t Number of scans performed
+         */
+        size_t run_pending(clock::time_point now = clock::now());
+
+        /**
+         * @brief Earliest deadline over all devices
+         *
+         * @return clock::time_point Deadline, or time_point::max() without devices
+         */
+        clock::time_point next_deadline() const noexcept;
+
+        /**
+         * @brief Run scans until a stop is requested
+         *
+         * @param stop Stop token; requesting a stop also interrupts the wait
+         *        for the next deadline
+         */
+        void run(std::stop_token stop);
+
+        /**
+         * @brief Scan statistics of a device
+         */
+        const DeviceStats &stats(size_t device) const { return devices_[device].stats; }
+
+    private:
+        struct BlockSchedule
+        {
+            clock::duration interval;
+            clock::time_point deadline;
+            uint32_t stable;
+        };
+
+        struct Device
+        {
+            ScanPoller *poller = nullptr;
+            clock::duration interval{};
+            clock::time_point deadline;
+            clock::time_point last_scan;
+            std::vector<Listener> listeners;
+            DeviceStats stats;
+            bool adaptive = false;
+            AdaptiveRate rate;
+            std::vector<BlockSchedule> blocks;
+            std::vector<size_t> due;
+        };
+
+        void scan(size_t index, clock::time_point now);
+        bool scan_adaptive(Device &device, clock::time_point now);
+        static uint64_t advance(clock::time_point &deadline, clock::duration interval);
+
+        std::vector<Device> devices_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
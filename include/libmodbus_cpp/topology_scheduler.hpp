@@ -0,0 +1,224 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    class ModbusConnection;
+    class ScanPoller;
+    struct ScanResult;
+
+    /**
+     * @brief Scheduler for devices that share gateways and serial buses
+     *
+     * The topology is gateway (a TCP endpoint, host:port) -> serial bus ->
+     * devices (unit ids). A serial bus carries one transaction at a time, so
+     * scans of devices on the same bus are never issued concurrently; they
+     * would only queue up inside the gateway and run into timeouts. A
+     * gateway limits the scans in progress through it, and each bus can be
+     * given a share of bus time to leave room for other masters. Devices on
+     * different gateways and buses are scanned in parallel.
+     *
+     * Scans run on one worker thread per bus. Whenever a worker is free it
+     * picks the device with the earliest due deadline whose bus, gateway
+     * and connection are available (on equal deadlines, the one scanned
+     * least recently). Deadlines are fixed rate like with
+     * ScanScheduler; slots a scan runs past are skipped and counted.
+     * Devices may share a ModbusConnection (e.g. one TCP connection to a
+     * gateway); their scans are serialized and the unit id is set before
+     * every scan. A TCP device without a serial bus is a gateway with a
+     * single bus.
+     */
+    class TopologyScheduler
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /// Invoked on a worker thread after every scan of a device, concurrently
+        /// for devices on different buses.
+        using Listener = std::function<void(size_t device, const ScanResult &result, bool success)>;
+
+        /**
+         * @brief Scan statistics of a device
+         */
+        struct DeviceStats
+        {
+            uint64_t scans = 0;       ///< Scans performed
+            uint64_t failures = 0;    ///< Scans with at least one failed block or without the unit id set
+            uint64_t overruns = 0;    ///< Deadlines skipped because a scan started or ran late
+            uint64_t block_reads = 0; ///< Read requests issued
+            clock::duration max_lateness{0}; ///< Longest wait from a deadline to the start of its scan
+        };
+
+        /**
+         * @brief Usage of a gateway or bus
+         */
+        struct ResourceStats
+        {
+            uint64_t scans = 0;       ///< Scans run through the resource
+            clock::duration busy{0};  ///< Time with at least one scan in progress
+            size_t peak_in_flight = 0; ///< Most scans in progress at once
+        };
+
+        TopologyScheduler() = default;
+
+        /**
+         * @brief Stop all worker threads
+         */
+        ~TopologyScheduler();
+
+        TopologyScheduler(const TopologyScheduler &) = delete;
+        TopologyScheduler &operator=(const TopologyScheduler &) = delete;
+
+        /**
+         * @brief Add a gateway (TCP endpoint)
+         *
+         * Throws std::invalid_argument if the scheduler is running.
+         *
+         * @param name Label of the gateway, e.g. host:port
+         * @param max_concurrency Scans in progress through the gateway at
+         *        once (0: one per bus)
+         * @return size_t Gateway index
+         */
+        size_t add_gateway(std::string name, size_t max_concurrency = 0);
+
+        /**
+         * @brief Add a serial bus behind a gateway
+         *
+         * The bus runs one scan at a time. With max_occupancy below 1, the
+         * bus rests after every scan so that scans take at most that share
+         * of the time (a scan of duration d is followed by d * (1 - u) / u
+         * of rest). Throws std::invalid_argument if the gateway does not
+         * exist, max_occupancy is not in (0, 1] or the scheduler is running.
+         *
+         * @param gateway Gateway index
+         * @param max_occupancy Share of time the bus may be busy with scans
+         * @return size_t Bus index
+         */
+        size_t add_bus(size_t gateway, double max_occupancy = 1.0);
+
+        /**
+         * @brief Add a device on a bus
+         *
+         * The first scan is due when start() is called. Throws
+         * std::invalid_argument if the bus does not exist, the interval is
+         * not positive or the scheduler is running.
+         *
+         * @param bus Bus index
+         * @param poller Poller of the device (must outlive the scheduler)
+         * @param interval Scan interval
+         * @param unit_id Unit id set on the poller's connection before every
+         *        scan, -1 to leave the connection as configured. If it cannot
+         *        be set, the scan is skipped and counted as failed (listeners
+         *        get success == false and the result of the previous scan).
+         * @return size_t Device index
+         */
+        size_t add_device(size_t bus, ScanPoller &poller, clock::duration interval, int unit_id = -1);
+
+        /**
+         * @brief Register a listener for the scans of a device (only while stopped)
+         *
+         * @param device Device index
+         * @param listener Callback invoked after every scan of the device
+         * @return true if the listener was registered
+         * @return false if the device does not exist or the scheduler is running
+         */
+        bool add_listener(size_t device, Listener listener);
+
+        /**
+         * @brief Start one worker thread per bus
+         *
+         * @return true if the workers were started
+         * @return false if the scheduler is already running or has no devices
+         */
+        bool start();
+
+        /**
+         * @brief Stop and join the workers (scans in progress are finished)
+         */
+        void stop();
+
+        /**
+         * @brief Check whether the workers are running
+         */
+        bool running() const noexcept { return !threads_.empty(); }
+
+        /**
+         * @brief Scan statistics of a device
+         */
+        DeviceStats stats(size_t device) const;
+
+        /**
+         * @brief Usage of a bus
+         */
+        ResourceStats bus_stats(size_t bus) const;
+
+        /**
+         * @brief Usage of a gateway
+         */
+        ResourceStats gateway_stats(size_t gateway) const;
+
+    private:
+        struct Resource
+        {
+            size_t limit = 1;   ///< Scans in progress at once (0: unlimited)
+            size_t in_flight = 0;
+            clock::time_point busy_since;
+            ResourceStats stats;
+        };
+
+        struct Gateway
+        {
+            std::string name;
+            Resource resource;
+        };
+
+        struct Bus
+        {
+            size_t gateway = 0;
+            double max_occupancy = 1.0;
+            clock::time_point available; ///< End of the rest after the latest scan
+            Resource resource;
+        };
+
+        struct Device
+        {
+            size_t bus = 0;
+            ScanPoller *poller = nullptr;
+            ModbusConnection *connection = nullptr;
+            int unit_id = -1;
+            clock::duration interval{};
+            clock::time_point deadline;
+            clock::time_point last_start; ///< Breaks ties between equal deadlines
+            bool scanning = false;
+            std::vector<Listener> listeners;
+            DeviceStats stats;
+        };
+
+        void run_worker(std::stop_token stop);
+        bool connection_busy(const ModbusConnection *connection) const;
+        static void acquire(Resource &resource, clock::time_point now);
+        static void release(Resource &resource, clock::time_point now);
+
+        std::vector<Gateway> gateways_;
+        std::vector<Bus> buses_;
+        std::vector<Device> devices_;
+        std::vector<std::jthread> threads_;
+        mutable std::mutex mutex_;
+        std::condition_variable_any changed_;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
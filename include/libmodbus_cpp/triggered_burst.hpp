@@ -0,0 +1,158 @@
+#pragma once
+
+#include "libmodbus_cpp/scan_scheduler.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Condition that starts a burst
+     */
+    struct BurstTrigger
+    {
+        enum class Kind : uint8_t
+        {
+            rising_above,  ///< Register goes from <= threshold to > threshold
+            falling_below, ///< Register goes from >= threshold to < threshold
+            rising_edge,   ///< Coil or discrete input goes from 0 to 1
+            falling_edge,  ///< Coil or discrete input goes from 1 to 0
+            any_edge       ///< Coil or discrete input changes
+        };
+
+        Kind kind = Kind::rising_above;
+        uint32_t image_index = 0; ///< Register image index (see ScanPlan)
+        uint16_t threshold = 0;   ///< Raw register threshold (crossing triggers only)
+    };
+
+    /**
+     * @brief Timing of a triggered burst
+     */
+    struct BurstConfig
+    {
+        ScanScheduler::clock::duration normal_interval{std::chrono::seconds(1)};
+        ScanScheduler::clock::duration burst_interval{std::chrono::milliseconds(10)};
+        ScanScheduler::clock::duration burst_duration{std::chrono::seconds(2)};
+        size_t pre_trigger_scans = 16; ///< Scans kept in the pre-trigger ring buffer
+    };
+
+    /**
+     * @brief One scan stored in a burst capture
+     */
+    struct CapturedScan
+    {
+        std::chrono::system_clock::time_point timestamp;
+        uint64_t cycle;
+        std::span<const uint16_t> image;
+    };
+
+    /**
+     * @brief Result of a burst: pre-trigger history followed by the burst scans
+     */
+    struct BurstCapture
+    {
+        size_t trigger;                              ///< Index of the trigger that fired
+        size_t pre_trigger_count;                    ///< Leading scans taken before the trigger
+        std::span<const CapturedScan> scans;         ///< Oldest first; includes the triggering scan
+    };
+
+    /**
+     * @brief Switches a device to a fast scan interval when a trigger fires
+     *
+     * While idle, the device is scanned at the normal interval and the latest
+     * scans are kept in a ring buffer. When a trigger fires, the scheduler
+     * interval of the device is switched to the burst interval for the burst
+     * duration; afterwards the normal interval is restored and the capture
+     * (ring buffer contents plus all burst scans) is handed to the capture
+     * callback. All buffers are allocated up front.
+     *
+     * The object registers itself as a scheduler listener and must therefore
+     * outlive the scheduler's use of the device; it cannot be copied or moved.
+     */
+    class TriggeredBurst
+    {
+    public:
+        using CaptureCallback = std::function<void(const BurstCapture &capture)>;
+
+        /**
+         * @brief Attach burst acquisition to a scheduled device
+         *
+         * @param scheduler Scheduler running the device
+         * @param device Device index within the scheduler
+         * @param image_size Register image size of the device's scan plan
+         * @param config Burst timing
+         */
+        TriggeredBurst(ScanScheduler &scheduler, size_t device, size_t image_size, const BurstConfig &config);
+
+        TriggeredBurst(const TriggeredBurst &) = delete;
+        TriggeredBurst &operator=(const TriggeredBurst &) = delete;
+
+        /**
+         * @brief Add a trigger condition
+         *
+         * @return true if the trigger was added
+         * @return false if the image index is outside the register image
+         */
+        bool add_trigger(const BurstTrigger &trigger);
+
+        /**
+         * @brief Set the callback receiving completed captures
+         */
+        void set_capture_callback(CaptureCallback callback);
+
+        /**
+         * @brief Check whether a burst is in progress
+         */
+        bool active() const noexcept { return active_; }
+
+        /**
+         * @brief Number of bursts completed so far
+         */
+        uint64_t burst_count() const noexcept { return bursts_; }
+
+    private:
+        void on_scan(const ScanResult &result, bool success);
+        bool fired(size_t index, uint16_t previous, uint16_t current) const;
+        void store(std::vector<uint16_t> &images, std::vector<CapturedScan> &scans,
+                   size_t slot, const ScanResult &result);
+        void finish();
+
+        ScanScheduler &scheduler_;
+        size_t device_;
+        size_t image_size_;
+        BurstConfig config_;
+        CaptureCallback callback_;
+
+        std::vector<BurstTrigger> triggers_;
+        std::vector<uint16_t> previous_;
+        bool primed_ = false;
+
+        // Pre-trigger ring buffer
+        std::vector<uint16_t> ring_images_;
+        std::vector<CapturedScan> ring_scans_;
+        size_t ring_next_ = 0;
+        size_t ring_size_ = 0;
+
+        // Capture of the current burst
+        std::vector<uint16_t> capture_images_;
+        std::vector<CapturedScan> capture_scans_;
+        size_t capture_capacity_ = 0;
+        size_t capture_size_ = 0;
+        size_t capture_pre_trigger_ = 0;
+        size_t capture_trigger_ = 0;
+
+        bool active_ = false;
+        ScanScheduler::clock::time_point burst_end_;
+        uint64_t bursts_ = 0;
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
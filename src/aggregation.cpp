@@ -0,0 +1,243 @@
+#include "libmodbus_cpp/aggregation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        constexpr double infinity = std::numeric_limits<double>::infinity();
+
+        std::chrono::system_clock::time_point window_start(std::chrono::system_clock::time_point timestamp,
+                                                           std::chrono::system_clock::duration window)
+        {
+            const auto ticks = timestamp.time_since_epoch().count();
+            const auto length = window.count();
+            auto index = ticks / length;
+            if (ticks % length != 0 && ticks < 0)
+            {
+                --index;
+            }
+            return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(index * length));
+        }
+
+        double seconds_between(std::chrono::system_clock::time_point from,
+                               std::chrono::system_clock::time_point to)
+        {
+            return std::chrono::duration<double>(to - from).count();
+        }
+    }
+
+    WindowAggregator::WindowAggregator(size_t tag_count, std::chrono::system_clock::duration window)
+        : tag_count_(tag_count), window_(window),
+          min_(tag_count), max_(tag_count), sum_(tag_count), last_(tag_count), count_(tag_count),
+          closed_min_(tag_count), closed_max_(tag_count), closed_mean_(tag_count),
+          closed_last_(tag_count), closed_count_(tag_count)
+    {
+        if (window <= std::chrono::system_clock::duration::zero())
+        {
+            throw std::invalid_argument("Window length must be positive");
+        }
+        reset_accumulators();
+    }
+
+    bool WindowAggregator::add(std::span<const double> values, std::chrono::system_clock::time_point timestamp)
+    {
+        if (values.size() < tag_count_)
+        {
+            return false;
+        }
+
+        bool closed = false;
+        const auto start = window_start(timestamp, window_);
+        if (!open_)
+        {
+            open_start_ = start;
+            open_ = true;
+        }
+        else if (start > open_start_)
+        {
+            close_window();
+            open_start_ = start;
+            open_ = true;
+            closed = true;
+        }
+
+        // Branch-free accumulation; NaN compares false and is skipped.
+        const double *v = values.data();
+        for (size_t i = 0; i < tag_count_; ++i)
+        {
+            const bool valid = v[i] == v[i];
+            min_[i] = v[i] < min_[i] ? v[i] : min_[i];
+            max_[i] = v[i] > max_[i] ? v[i] : max_[i];
+            sum_[i] += valid ? v[i] : 0.0;
+            last_[i] = valid ? v[i] : last_[i];
+            count_[i] += valid ? 1u : 0u;
+        }
+
+        return closed;
+    }
+
+    bool WindowAggregator::flush()
+    {
+        if (!open_)
+        {
+            return false;
+        }
+
+        close_window();
+        return true;
+    }
+
+    WindowSummary WindowAggregator::summary() const noexcept
+    {
+        return {closed_start_, closed_start_ + window_,
+                closed_min_, closed_max_, closed_mean_, closed_last_, closed_count_};
+    }
+
+    void WindowAggregator::close_window()
+    {
+        closed_start_ = open_start_;
+        for (size_t i = 0; i < tag_count_; ++i)
+        {
+            const bool any = count_[i] != 0;
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            closed_min_[i] = any ? min_[i] : nan;
+            closed_max_[i] = any ? max_[i] : nan;
+            closed_mean_[i] = any ? sum_[i] / count_[i] : nan;
+            closed_last_[i] = any ? last_[i] : nan;
+            closed_count_[i] = count_[i];
+        }
+
+        reset_accumulators();
+        open_ = false;
+    }
+
+    void WindowAggregator::reset_accumulators()
+    {
+        std::fill(min_.begin(), min_.end(), infinity);
+        std::fill(max_.begin(), max_.end(), -infinity);
+        std::fill(sum_.begin(), sum_.end(), 0.0);
+        std::fill(last_.begin(), last_.end(), std::numeric_limits<double>::quiet_NaN());
+        std::fill(count_.begin(), count_.end(), 0u);
+    }
+
+    DeadbandFilter::DeadbandFilter(std::span<const double> deadbands)
+        : deadbands_(deadbands.begin(), deadbands.end()),
+          reported_(deadbands.size(), 0.0),
+          seen_(deadbands.size(), 0)
+    {
+        passed_.reserve(deadbands.size());
+    }
+
+    bool DeadbandFilter::pass(size_t tag, double value)
+    {
+        if (tag >= deadbands_.size())
+        {
+            return false;
+        }
+
+        if (seen_[tag] && !(std::fabs(value - reported_[tag]) > deadbands_[tag]))
+        {
+            return false;
+        }
+
+        seen_[tag] = 1;
+        reported_[tag] = value;
+        return true;
+    }
+
+    std::span<const uint32_t> DeadbandFilter::apply(std::span<const double> values)
+    {
+        passed_.clear();
+        const size_t count = std::min(values.size(), deadbands_.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (pass(i, values[i]))
+            {
+                passed_.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        return passed_;
+    }
+
+    SwingingDoorFilter::SwingingDoorFilter(std::span<const double> deviations)
+        : deviations_(deviations.begin(), deviations.end()),
+          states_(deviations.size(), State{{}, {}, -infinity, infinity, false, false})
+    {
+    }
+
+    bool SwingingDoorFilter::add(size_t tag, const SamplePoint &point, SamplePoint &archived)
+    {
+        if (tag >= states_.size() || std::isnan(point.value))
+        {
+            return false;
+        }
+
+        State &state = states_[tag];
+        const double deviation = deviations_[tag];
+
+        if (!state.started)
+        {
+            state.started = true;
+            state.pending = false;
+            state.anchor = point;
+            state.min_slope = -infinity;
+            state.max_slope = infinity;
+            archived = point;
+            return true;
+        }
+
+        const double elapsed = seconds_between(state.anchor.timestamp, point.timestamp);
+        if (elapsed <= 0.0 || point.timestamp <= state.last.timestamp)
+        {
+            return false;
+        }
+
+        // Slopes of lines from the anchor that stay within the deviation of
+        // every value seen since; the door closes when the range is empty.
+        const double lower = (point.value - deviation - state.anchor.value) / elapsed;
+        const double upper = (point.value + deviation - state.anchor.value) / elapsed;
+        const double min_slope = std::max(state.min_slope, lower);
+        const double max_slope = std::min(state.max_slope, upper);
+        if (min_slope <= max_slope)
+        {
+            state.min_slope = min_slope;
+            state.max_slope = max_slope;
+            state.last = point;
+            state.pending = true;
+            return false;
+        }
+
+        archived = state.last;
+        state.anchor = state.last;
+        const double since_anchor = seconds_between(state.anchor.timestamp, point.timestamp);
+        state.min_slope = (point.value - deviation - state.anchor.value) / since_anchor;
+        state.max_slope = (point.value + deviation - state.anchor.value) / since_anchor;
+        state.last = point;
+        state.pending = true;
+        return true;
+    }
+
+    bool SwingingDoorFilter::flush(size_t tag, SamplePoint &archived)
+    {
+        if (tag >= states_.size() || !states_[tag].pending)
+        {
+            return false;
+        }
+
+        State &state = states_[tag];
+        archived = state.last;
+        state.anchor = state.last;
+        state.min_slope = -infinity;
+        state.max_slope = infinity;
+        state.pending = false;
+        return true;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,236 @@
+#include "libmodbus_cpp/aligned_scan_group.hpp"
+#include "libmodbus_cpp/scan_poller.hpp"
+#include "libmodbus_cpp/request_trace.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <stdexcept>
+#include <utility>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        std::chrono::nanoseconds abs_duration(std::chrono::nanoseconds value)
+        {
+            return value < std::chrono::nanoseconds::zero() ? -value : value;
+        }
+    }
+
+    AlignedScanGroup::AlignedScanGroup(const AlignmentConfig &config)
+        : config_(config)
+    {
+        if (config_.period <= std::chrono::system_clock::duration::zero())
+        {
+            throw std::invalid_argument("Alignment period must be positive");
+        }
+        config_.rtt_smoothing = std::clamp(config_.rtt_smoothing, 0.01, 1.0);
+        config_.spin_margin = std::clamp(config_.spin_margin, std::chrono::system_clock::duration::zero(),
+                                         std::chrono::duration_cast<std::chrono::system_clock::duration>(max_spin_margin));
+    }
+
+    AlignedScanGroup::~AlignedScanGroup()
+    {
+        stop();
+    }
+
+    size_t AlignedScanGroup::add_device(ScanPoller &poller)
+    {
+        if (running())
+        {
+            throw std::invalid_argument("Devices cannot be added while the group is running");
+        }
+
+        DeviceState device;
+        device.poller = &poller;
+        devices_.push_back(device);
+        return devices_.size() - 1;
+    }
+
+    void AlignedScanGroup::set_listener(Listener listener)
+    {
+        listener_ = std::move(listener);
+    }
+
+    bool AlignedScanGroup::start()
+    {
+        if (running() || devices_.empty())
+        {
+            return false;
+        }
+
+        // Spinning threads beyond the number of CPUs only take the CPU from
+        // each other right at the boundary, which adds to the skew.
+        const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+        spin_margin_ = devices_.size() <= cpus ? config_.spin_margin : std::chrono::system_clock::duration::zero();
+
+        threads_.reserve(devices_.size());
+        for (size_t index = 0; index < devices_.size(); ++index)
+        {
+            threads_.emplace_back([this, index](std::stop_token stop)
+                                  { run_device(stop, index); });
+        }
+        return true;
+    }
+
+    void AlignedScanGroup::stop()
+    {
+        for (std::jthread &thread : threads_)
+        {
+            thread.request_stop();
+        }
+        threads_.clear();
+    }
+
+    AlignmentStats AlignedScanGroup::stats(size_t device) const
+    {
+        std::lock_guard lock(mutex_);
+        return devices_[device].stats;
+    }
+
+    std::chrono::nanoseconds AlignedScanGroup::cycle_spread() const
+    {
+        std::lock_guard lock(mutex_);
+
+        std::chrono::system_clock::time_point latest_boundary;
+        for (const DeviceState &device : devices_)
+        {
+            latest_boundary = std::max(latest_boundary, device.boundary);
+        }
+
+        auto earliest = std::chrono::system_clock::time_point::max();
+        auto latest = std::chrono::system_clock::time_point::min();
+        for (const DeviceState &device : devices_)
+        {
+            if (device.skew_samples != 0 && device.boundary == latest_boundary)
+            {
+                earliest = std::min(earliest, device.sampled);
+                latest = std::max(latest, device.sampled);
+            }
+        }
+
+        if (earliest > latest)
+        {
+            return std::chrono::nanoseconds::zero();
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(latest - earliest);
+    }
+
+    std::chrono::system_clock::time_point AlignedScanGroup::next_boundary(std::chrono::system_clock::time_point after) const
+    {
+        const auto since_phase = (after - config_.phase).time_since_epoch();
+        auto periods = since_phase / config_.period + 1;
+        if (since_phase < std::chrono::system_clock::duration::zero() && since_phase % config_.period != std::chrono::system_clock::duration::zero())
+        {
+            --periods;
+        }
+        return std::chrono::system_clock::time_point(periods * config_.period + config_.phase);
+    }
+
+    bool AlignedScanGroup::wait_until(std::stop_token &stop, std::chrono::system_clock::time_point target,
+                                      std::chrono::system_clock::duration spin_margin)
+    {
+        std::mutex mutex;
+        std::condition_variable_any wakeup;
+        {
+            std::unique_lock lock(mutex);
+            wakeup.wait_until(lock, stop, target - spin_margin, []
+                              { return false; });
+        }
+
+        // Sleep granularity is far coarser than the alignment we aim for, so
+        // the last stretch is spent spinning.
+        while (!stop.stop_requested() && std::chrono::system_clock::now() < target)
+        {
+            std::this_thread::yield();
+        }
+        return !stop.stop_requested();
+    }
+
+    void AlignedScanGroup::run_device(std::stop_token stop, size_t index)
+    {
+        ScanPoller &poller = *devices_[index].poller;
+        std::chrono::nanoseconds rtt{0};
+        std::chrono::system_clock::time_point previous_boundary;
+        bool first = true;
+
+        while (!stop.stop_requested())
+        {
+            const auto lead = config_.compensate_rtt ? rtt / 2 : std::chrono::nanoseconds::zero();
+            const auto lead_time = std::chrono::duration_cast<std::chrono::system_clock::duration>(lead);
+            const auto boundary = next_boundary(std::chrono::system_clock::now() + lead_time + spin_margin_);
+            if (!wait_until(stop, boundary - lead_time, spin_margin_))
+            {
+                break;
+            }
+
+            RequestTracer &tracer = RequestTracer::instance();
+            const bool tracing = tracer.enabled();
+            if (tracing)
+            {
+                tracer.begin_scan(boundary - lead_time);
+            }
+
+            const bool success = poller.poll();
+            const ScanResult &result = poller.result();
+
+            // The device samples roughly half a round trip after the request.
+            // Without a valid first block there is no sample to judge.
+            std::chrono::nanoseconds skew{0};
+            std::chrono::system_clock::time_point sampled = boundary;
+            const bool sample_valid = !result.block_sent.empty() && result.block_valid[0];
+            if (sample_valid)
+            {
+                const auto round_trip = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    result.block_received[0] - result.block_sent[0]);
+                sampled = result.block_sent[0] +
+                          std::chrono::duration_cast<std::chrono::system_clock::duration>(round_trip / 2);
+                skew = std::chrono::duration_cast<std::chrono::nanoseconds>(sampled - boundary);
+                rtt = first ? round_trip
+                            : std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  round_trip * config_.rtt_smoothing + rtt * (1.0 - config_.rtt_smoothing));
+                first = false;
+            }
+
+            {
+                std::lock_guard lock(mutex_);
+                DeviceState &device = devices_[index];
+                AlignmentStats &stats = device.stats;
+                if (stats.scans != 0 && boundary - previous_boundary > config_.period)
+                {
+                    stats.missed_boundaries += static_cast<uint64_t>((boundary - previous_boundary) / config_.period - 1);
+                }
+                ++stats.scans;
+                if (!success)
+                {
+                    ++stats.failures;
+                }
+                if (sample_valid)
+                {
+                    ++device.skew_samples;
+                    stats.last_skew = skew;
+                    stats.max_abs_skew = std::max(stats.max_abs_skew, abs_duration(skew));
+                    device.abs_skew_sum += abs_duration(skew);
+                    stats.mean_abs_skew = device.abs_skew_sum / static_cast<int64_t>(device.skew_samples);
+                    stats.rtt = rtt;
+                    device.boundary = boundary;
+                    device.sampled = sampled;
+                }
+            }
+            previous_boundary = boundary;
+
+            if (listener_)
+            {
+                listener_(index, result, success, skew);
+            }
+
+            if (tracing)
+            {
+                tracer.end_scan();
+            }
+        }
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,104 @@
+#include "libmodbus_cpp/ascii_frame.hpp"
+#include <array>
+#include <cstring>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        // Both digits of every byte value, so encoding is one copy per byte.
+        constexpr std::array<char, 512> make_hex_table()
+        {
+            constexpr char digits[] = "0123456789ABCDEF";
+            std::array<char, 512> table{};
+            for (size_t i = 0; i < 256; ++i)
+            {
+                table[2 * i] = digits[i >> 4];
+                table[2 * i + 1] = digits[i & 0x0F];
+            }
+            return table;
+        }
+
+        // Nibble value of every character, 0xFF for non-hex characters.
+        constexpr std::array<uint8_t, 256> make_nibble_table()
+        {
+            std::array<uint8_t, 256> table{};
+            table.fill(0xFF);
+            for (uint8_t i = 0; i < 10; ++i)
+            {
+                table['0' + i] = i;
+            }
+            for (uint8_t i = 0; i < 6; ++i)
+            {
+                table['A' + i] = static_cast<uint8_t>(10 + i);
+                table['a' + i] = static_cast<uint8_t>(10 + i);
+            }
+            return table;
+        }
+
+        constexpr std::array<char, 512> hex_table = make_hex_table();
+        constexpr std::array<uint8_t, 256> nibble_table = make_nibble_table();
+    }
+
+    uint8_t ascii_lrc(std::span<const uint8_t> data)
+    {
+        // A wide accumulator lets the compiler vectorize the sum.
+        uint32_t sum = 0;
+        for (uint8_t byte : data)
+        {
+            sum += byte;
+        }
+        return static_cast<uint8_t>(-sum);
+    }
+
+    bool ascii_check_lrc(std::span<const uint8_t> frame)
+    {
+        return frame.size() >= 3 && ascii_lrc(frame.first(frame.size() - 1)) == frame.back();
+    }
+
+    size_t ascii_encode(std::span<const uint8_t> data, char *out)
+    {
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            std::memcpy(out + 2 * i, hex_table.data() + 2 * data[i], 2);
+        }
+        return 2 * data.size();
+    }
+
+    size_t ascii_decode(std::span<const char> text, uint8_t *out)
+    {
+        if (text.size() % 2 != 0)
+        {
+            return 0;
+        }
+        // Invalid characters are collected in one flag instead of a branch per digit.
+        uint8_t invalid = 0;
+        for (size_t i = 0; i < text.size() / 2; ++i)
+        {
+            const uint8_t high = nibble_table[static_cast<uint8_t>(text[2 * i])];
+            const uint8_t low = nibble_table[static_cast<uint8_t>(text[2 * i + 1])];
+            invalid |= static_cast<uint8_t>(high | low);
+            out[i] = static_cast<uint8_t>((high << 4) | (low & 0x0F));
+        }
+        return (invalid & 0xF0) != 0 ? 0 : text.size() / 2;
+    }
+
+    size_t ascii_frame(std::span<const uint8_t> adu, char *out)
+    {
+        if (adu.size() + 1 > (max_ascii_length - 3) / 2)
+        {
+            return 0;
+        }
+        out[0] = ':';
+        size_t length = 1 + ascii_encode(adu, out + 1);
+        const uint8_t lrc = ascii_lrc(adu);
+        length += ascii_encode(std::span<const uint8_t>(&lrc, 1), out + length);
+        out[length++] = '\r';
+        out[length++] = '\n';
+        return length;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,442 @@
+#include "ascii_link.hpp"
+#include "serial_port.hpp"
+#include <modbus/modbus.h>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        void write_be16(uint8_t *data, uint16_t value)
+        {
+            data[0] = static_cast<uint8_t>(value >> 8);
+            data[1] = static_cast<uint8_t>(value & 0xFF);
+        }
+
+        uint16_t read_be16(const uint8_t *data)
+        {
+            return static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+    }
+
+    AsciiLink::AsciiLink(const SerialConfig &config)
+        : config_(config)
+    {
+    }
+
+    AsciiLink::~AsciiLink()
+    {
+        close();
+    }
+
+    bool AsciiLink::open(std::string &error)
+    {
+        if (fd_ == -1)
+        {
+            fd_ = open_serial_port(config_, error);
+        }
+        return fd_ != -1;
+    }
+
+    bool AsciiLink::set_slave(int slave)
+    {
+        if (slave < 0 || slave > 247)
+        {
+            errno = EINVAL;
+            return false;
+        }
+        slave_ = slave;
+        return true;
+    }
+
+    int AsciiLink::read_bits(uint8_t function, uint16_t address, uint16_t count, uint8_t *dest)
+    {
+        if (count == 0 || count > MODBUS_MAX_READ_BITS)
+        {
+            errno = EMBMDATA;
+            return -1;
+        }
+        request_[1] = function;
+        write_be16(request_.data() + 2, address);
+        write_be16(request_.data() + 4, count);
+        const int length = transact(5);
+        if (length == -1)
+        {
+            return -1;
+        }
+
+        const uint8_t *pdu = response_.data() + 1;
+        const size_t bytes = (size_t{count} + 7) / 8;
+        if (static_cast<size_t>(length) != 2 + bytes || pdu[1] != bytes)
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            dest[i] = static_cast<uint8_t>((pdu[2 + i / 8] >> (i % 8)) & 1);
+        }
+        return count;
+    }
+
+    int AsciiLink::read_registers(uint8_t function, uint16_t address, uint16_t count, uint16_t *dest)
+    {
+        if (count == 0 || count > MODBUS_MAX_READ_REGISTERS)
+        {
+            errno = EMBMDATA;
+            return -1;
+        }
+        request_[1] = function;
+        write_be16(request_.data() + 2, address);
+        write_be16(request_.data() + 4, count);
+        const int length = transact(5);
+        if (length == -1)
+        {
+            return -1;
+        }
+
+        const uint8_t *pdu = response_.data() + 1;
+        if (static_cast<size_t>(length) != 2 + size_t{count} * 2 || pdu[1] != count * 2)
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            dest[i] = read_be16(pdu + 2 + 2 * i);
+        }
+        return count;
+    }
+
+    int AsciiLink::write_bit(uint16_t address, bool state)
+    {
+        request_[1] = 0x05;
+        write_be16(request_.data() + 2, address);
+        write_be16(request_.data() + 4, state ? 0xFF00 : 0x0000);
+        const int length = transact(5);
+        if (length == -1)
+        {
+            return -1;
+        }
+        // The response echoes the request (nothing to check for a broadcast).
+        if (length != 0 && (length != 5 || std::memcmp(response_.data() + 1, request_.data() + 1, 5) != 0))
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        return 1;
+    }
+
+    int AsciiLink::write_register(uint16_t address, uint16_t value)
+    {
+        request_[1] = 0x06;
+        write_be16(request_.data() + 2, address);
+        write_be16(request_.data() + 4, value);
+        const int length = transact(5);
+        if (length == -1)
+        {
+            return -1;
+        }
+        if (length != 0 && (length != 5 || std::memcmp(response_.data() + 1, request_.data() + 1, 5) != 0))
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        return 1;
+    }
+
+    int AsciiLink::write_bits(uint16_t address, uint16_t count, const uint8_t *values)
+    {
+        if (count == 0 || count > MODBUS_MAX_WRITE_BITS)
+        {
+            errno = EMBMDATA;
+            return -1;
+        }
+        const size_t bytes = (size_t{count} + 7) / 8;
+        request_[1] = 0x0F;
+        write_be16(request_.data() + 2, address);
+        write_be16(request_.data() + 4, count);
+        request_[6] = static_cast<uint8_t>(bytes);
+        std::memset(request_.data() + 7, 0, bytes);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (values[i] != 0)
+            {
+                request_[7 + i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+            }
+        }
+        const int length = transact(6 + bytes);
+        if (length == -1)
+        {
+            return -1;
+        }
+        // The response echoes function, address and count.
+        if (length != 0 && (length != 5 || std::memcmp(response_.data() + 1, request_.data() + 1, 5) != 0))
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        return count;
+    }
+
+    int AsciiLink::write_registers(uint16_t address, uint16_t count, const uint16_t *values)
+    {
+        if (count == 0 || count > MODBUS_MAX_WRITE_REGISTERS)
+        {
+            errno = EMBMDATA;
+            return -1;
+        }
+        request_[1] = 0x10;
+        write_be16(request_.data() + 2, address);
+        write_be16(request_.data() + 4, count);
+        request_[6] = static_cast<uint8_t>(count * 2);
+        for (size_t i = 0; i < count; ++i)
+        {
+            write_be16(request_.data() + 7 + 2 * i, values[i]);
+        }
+        const int length = transact(6 + size_t{count} * 2);
+        if (length == -1)
+        {
+            return -1;
+        }
+        if (length != 0 && (length != 5 || std::memcmp(response_.data() + 1, request_.data() + 1, 5) != 0))
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        return count;
+    }
+
+    int AsciiLink::send_raw(const uint8_t *request, size_t length)
+    {
+        if (fd_ == -1)
+        {
+            errno = EBADF;
+            return -1;
+        }
+        if (length < 2 || length > max_ascii_adu_length)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        std::memcpy(request_.data(), request, length);
+        return send_frame(length) ? static_cast<int>(length) : -1;
+    }
+
+    int AsciiLink::transact(size_t length)
+    {
+        if (fd_ == -1)
+        {
+            errno = EBADF;
+            return -1;
+        }
+        if (slave_ == -1)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        request_[0] = static_cast<uint8_t>(slave_);
+        flush();
+        if (!send_frame(1 + length))
+        {
+            return -1;
+        }
+        // Broadcasts are not answered.
+        if (slave_ == 0)
+        {
+            return 0;
+        }
+
+        const int received = receive_frame();
+        if (received == -1)
+        {
+            return -1;
+        }
+        const std::span<const uint8_t> frame(response_.data(), static_cast<size_t>(received));
+        if (!ascii_check_lrc(frame))
+        {
+            errno = frame.size() < 3 ? EMBBADDATA : EMBBADCRC;
+            return -1;
+        }
+        const uint8_t function = request_[1];
+        if (frame[0] != slave_ || (frame[1] & 0x7F) != function)
+        {
+            errno = EMBBADDATA;
+            return -1;
+        }
+        if (frame[1] == (function | 0x80))
+        {
+            errno = frame.size() == 4 ? MODBUS_ENOBASE + frame[2] : EMBBADEXC;
+            return -1;
+        }
+        return received - 2;
+    }
+
+#ifdef __linux__
+    void AsciiLink::close()
+    {
+        if (fd_ != -1)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    void AsciiLink::flush()
+    {
+        if (fd_ != -1)
+        {
+            tcflush(fd_, TCIFLUSH);
+        }
+    }
+
+    bool AsciiLink::send_frame(size_t length)
+    {
+        const size_t frame_length = ascii_frame(std::span<const uint8_t>(request_.data(), length), text_.data());
+        if (frame_length == 0)
+        {
+            errno = EMBMDATA;
+            return false;
+        }
+        size_t written = 0;
+        while (written < frame_length)
+        {
+            const ssize_t result = write(fd_, text_.data() + written, frame_length - written);
+            if (result > 0)
+            {
+                written += static_cast<size_t>(result);
+            }
+            else if (result == -1 && errno == EAGAIN)
+            {
+                pollfd descriptor{fd_, POLLOUT, 0};
+                if (poll(&descriptor, 1, static_cast<int>(timeout_.count() / 1000)) == 0)
+                {
+                    errno = ETIMEDOUT;
+                    return false;
+                }
+            }
+            else if (result == -1 && errno != EINTR)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int AsciiLink::receive_frame()
+    {
+        // Characters up to ':' are ignored, a new ':' restarts the frame and
+        // CR LF ends it.
+        const auto deadline = std::chrono::steady_clock::now() + timeout_;
+        size_t length = 0;
+        bool started = false;
+        char chunk[64];
+        while (true)
+        {
+            const ssize_t count = read(fd_, chunk, sizeof(chunk));
+            for (ssize_t i = 0; i < count; ++i)
+            {
+                const char character = chunk[i];
+                if (character == ':')
+                {
+                    started = true;
+                    length = 0;
+                }
+                else if (!started)
+                {
+                    continue;
+                }
+                else if (character == '\n')
+                {
+                    if (length == 0 || text_[length - 1] != '\r')
+                    {
+                        errno = EMBBADDATA;
+                        return -1;
+                    }
+                    const size_t decoded =
+                        ascii_decode(std::span<const char>(text_.data(), length - 1), response_.data());
+                    if (decoded == 0)
+                    {
+                        errno = EMBBADDATA;
+                        return -1;
+                    }
+                    return static_cast<int>(decoded);
+                }
+                else if (length < text_.size() - 1)
+                {
+                    text_[length++] = character;
+                }
+                else
+                {
+                    errno = EMBBADDATA;
+                    return -1;
+                }
+            }
+            if (count > 0 || (count == -1 && errno == EINTR))
+            {
+                continue;
+            }
+            // The port is non-blocking, so end of file means the line hung up.
+            if (count == 0)
+            {
+                errno = EIO;
+                return -1;
+            }
+            if (errno != EAGAIN)
+            {
+                return -1;
+            }
+
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            pollfd descriptor{fd_, POLLIN, 0};
+            const int ready = remaining.count() <= 0 ? 0 : poll(&descriptor, 1, static_cast<int>(remaining.count()));
+            if (ready == 0)
+            {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            if (ready == -1 && errno != EINTR)
+            {
+                return -1;
+            }
+            // A hung up pty or port would otherwise report ready until the deadline.
+            if (ready > 0 && (descriptor.revents & POLLIN) == 0 && (descriptor.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0)
+            {
+                errno = EIO;
+                return -1;
+            }
+        }
+    }
+#else
+    void AsciiLink::close()
+    {
+    }
+
+    void AsciiLink::flush()
+    {
+    }
+
+    bool AsciiLink::send_frame(size_t)
+    {
+        errno = ENOTSUP;
+        return false;
+    }
+
+    int AsciiLink::receive_frame()
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+#endif
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,90 @@
+#pragma once
+
+// Modbus ASCII master transport behind ModbusConnection. libmodbus has no
+// ASCII backend, so requests are framed and parsed here; the operations
+// follow the libmodbus conventions (count or -1 with errno set) so the
+// connection can treat both transports alike.
+
+#include "libmodbus_cpp/ascii_frame.hpp"
+#include "libmodbus_cpp/rtu_frame.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    class AsciiLink
+    {
+    public:
+        explicit AsciiLink(const SerialConfig &config);
+        ~AsciiLink();
+
+        AsciiLink(const AsciiLink &) = delete;
+        AsciiLink &operator=(const AsciiLink &) = delete;
+
+        /**
+         * @brief Open the serial port
+         *
+         * @param error Error message if the port cannot be opened
+         * @return true if the port is open
+         * @return false if it could not be opened
+         */
+        bool open(std::string &error);
+        void close();
+
+        /**
+         * @brief Set the unit id of the slave (0 broadcasts writes)
+         *
+         * @return true if the id is 0..247
+         * @return false otherwise
+         */
+        bool set_slave(int slave);
+        int slave() const noexcept { return slave_; }
+
+        void set_response_timeout(std::chrono::microseconds timeout) { timeout_ = timeout; }
+
+        /**
+         * @brief Discard received input (e.g. the rest of a broken response)
+         */
+        void flush();
+
+        int read_bits(uint8_t function, uint16_t address, uint16_t count, uint8_t *dest);
+        int read_registers(uint8_t function, uint16_t address, uint16_t count, uint16_t *dest);
+        int write_bit(uint16_t address, bool state);
+        int write_register(uint16_t address, uint16_t value);
+        int write_bits(uint16_t address, uint16_t count, const uint8_t *values);
+        int write_registers(uint16_t address, uint16_t count, const uint16_t *values);
+
+        /**
+         * @brief Send an ADU (unit id and PDU) without waiting for a response
+         *
+         * @return int length, or -1 with errno set (EINVAL if the ADU is
+         *         shorter than 2 or longer than max_ascii_adu_length bytes)
+         */
+        int send_raw(const uint8_t *request, size_t length);
+
+    private:
+        // Sends request_ (PDU of the given length) and receives the response
+        // PDU into response_ + 1. Returns the PDU length (0 for broadcasts),
+        // or -1 with errno set.
+        int transact(size_t length);
+        bool send_frame(size_t length);
+        int receive_frame();
+
+        SerialConfig config_;
+        int fd_ = -1;
+        int slave_ = -1;
+        std::chrono::microseconds timeout_{500000};
+        std::array<uint8_t, 256> request_{};  ///< Unit id and PDU
+        std::array<uint8_t, 256> response_{}; ///< Unit id, PDU and LRC
+        std::array<char, max_ascii_length> text_{};
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,126 @@
+#pragma once
+
+// Bounded multi-producer multi-consumer queue after Dmitry Vyukov's design.
+// Every cell carries a sequence number telling whether it is free for the
+// producer of a position or filled for its consumer, so producers and
+// consumers only contend on their own position counter and never lock.
+// try_pop() may fail while a producer that claimed an earlier position has
+// not finished writing it; callers that know an element is there retry.
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        /**
+         * @brief Construct a queue
+         *
+         * @param capacity Minimum number of elements (rounded up to a power of two)
+         */
+        explicit BoundedQueue(size_t capacity)
+            : mask_(std::bit_ceil(capacity < 2 ? size_t{2} : capacity) - 1),
+              cells_(std::make_unique<Cell[]>(mask_ + 1))
+        {
+            for (size_t i = 0; i <= mask_; ++i)
+            {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Append an element
+         *
+         * @return true if the element was queued
+         * @return false if the queue is full
+         */
+        bool try_push(const T &value)
+        {
+            size_t position = tail_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Cell &cell = cells_[position & mask_];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+                if (difference == 0)
+                {
+                    if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = value;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Remove the oldest element
+         *
+         * @return true if an element was removed
+         * @return false if the queue is empty (or its head is still being written)
+         */
+        bool try_pop(T &value)
+        {
+            size_t position = head_.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Cell &cell = cells_[position & mask_];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+                if (difference == 0)
+                {
+                    if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        value = cell.value;
+                        cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = head_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        size_t capacity() const noexcept { return mask_ + 1; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        // Producers and consumers on separate cache lines.
+        static constexpr size_t cache_line = 64;
+
+        const size_t mask_;
+        std::unique_ptr<Cell[]> cells_;
+        alignas(cache_line) std::atomic<size_t> tail_{0};
+        alignas(cache_line) std::atomic<size_t> head_{0};
+    };
+
+    } // namespace v1
+} // namespace libmodbus_cpp
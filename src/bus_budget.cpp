@@ -0,0 +1,184 @@
+#include "libmodbus_cpp/bus_budget.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        constexpr uint16_t max_write_registers = 123;
+
+        bool bit_block(BlockKind kind)
+        {
+            return kind == BlockKind::coils || kind == BlockKind::discrete_inputs;
+        }
+
+        // Characters on the wire for an ADU (unit id and PDU) of the given length.
+        size_t frame_characters(SerialFraming framing, size_t adu_length)
+        {
+            // RTU appends the CRC; ASCII hex encodes ADU and LRC between ':' and CR LF.
+            return framing == SerialFraming::rtu ? adu_length + 2 : 2 * (adu_length + 1) + 3;
+        }
+
+        // Silence that ends a frame (ASCII frames end with CR LF instead).
+        std::chrono::nanoseconds frame_gap(const BusBudgetConfig &config, const RtuTiming &timing)
+        {
+            return config.framing == SerialFraming::rtu ? timing.t35 : std::chrono::nanoseconds{0};
+        }
+
+        TransactionCost read_cost(const BusBudgetConfig &config, const RtuTiming &timing, BlockKind kind,
+                                  uint16_t count, std::chrono::nanoseconds response_time)
+        {
+            const size_t data_bytes = bit_block(kind) ? (size_t{count} + 7) / 8 : size_t{count} * 2;
+            TransactionCost cost;
+            cost.request_characters = frame_characters(config.framing, 6);
+            cost.response_characters = frame_characters(config.framing, 3 + data_bytes);
+            cost.time = timing.character * static_cast<int64_t>(cost.request_characters + cost.response_characters) +
+                        2 * frame_gap(config, timing) + response_time + config.master_latency;
+            return cost;
+        }
+    }
+
+    TransactionCost read_cost(const BusBudgetConfig &config, BlockKind kind, uint16_t count,
+                              std::chrono::nanoseconds response_time)
+    {
+        return read_cost(config, rtu_timing(config.serial), kind, count, response_time);
+    }
+
+    TransactionCost broadcast_cost(const BusBudgetConfig &config, const BudgetBroadcast &broadcast)
+    {
+        if (broadcast.registers == 0 || broadcast.registers > max_write_registers)
+        {
+            throw std::invalid_argument("Broadcast must write 1..123 registers");
+        }
+        const RtuTiming timing = rtu_timing(config.serial);
+        const size_t adu_length = broadcast.registers == 1 ? 6 : 7 + size_t{broadcast.registers} * 2;
+        TransactionCost cost;
+        cost.request_characters = frame_characters(config.framing, adu_length);
+        cost.time = timing.character * static_cast<int64_t>(cost.request_characters) +
+                    std::max(broadcast.turnaround_delay, frame_gap(config, timing)) + config.master_latency;
+        return cost;
+    }
+
+    BusBudget analyze_bus_budget(const BusBudgetConfig &config, const std::vector<BudgetDevice> &devices,
+                                 const std::vector<BudgetBroadcast> &broadcasts)
+    {
+        if (!(config.max_occupancy > 0.0 && config.max_occupancy <= 1.0))
+        {
+            throw std::invalid_argument("Maximum occupancy must be in (0, 1]");
+        }
+        const RtuTiming timing = rtu_timing(config.serial);
+
+        BusBudget budget;
+        budget.feasible = true;
+        for (const BudgetBroadcast &broadcast : broadcasts)
+        {
+            if (broadcast.interval <= std::chrono::nanoseconds::zero())
+            {
+                throw std::invalid_argument("Broadcast interval must be positive");
+            }
+            budget.broadcast_occupancy += std::chrono::duration<double>(broadcast_cost(config, broadcast).time) /
+                                          std::chrono::duration<double>(broadcast.interval);
+        }
+        budget.occupancy = budget.broadcast_occupancy;
+
+        budget.devices.reserve(devices.size());
+        double merge_saving = 0.0;
+        for (size_t index = 0; index < devices.size(); ++index)
+        {
+            const BudgetDevice &device = devices[index];
+            if (device.interval <= std::chrono::nanoseconds::zero())
+            {
+                throw std::invalid_argument("Scan interval must be positive");
+            }
+            const std::vector<ScanBlock> &blocks = device.plan.blocks();
+            const auto cost = [&](BlockKind kind, uint16_t count)
+            {
+                return read_cost(config, timing, kind, count, device.response_time).time;
+            };
+
+            DeviceBudget device_budget;
+            device_budget.block_time.reserve(blocks.size());
+            for (const ScanBlock &block : blocks)
+            {
+                device_budget.block_time.push_back(cost(block.kind, block.count));
+                device_budget.scan_time += device_budget.block_time.back();
+            }
+            const double interval = std::chrono::duration<double>(device.interval).count();
+            device_budget.occupancy = std::chrono::duration<double>(device_budget.scan_time).count() / interval;
+            device_budget.fits = device_budget.scan_time <= device.interval;
+            budget.feasible = budget.feasible && device_budget.fits;
+            budget.occupancy += device_budget.occupancy;
+            budget.burst_time += device_budget.scan_time;
+
+            // Greedy merge of the blocks of each table in address order: a block
+            // joins the current group while one request for both is cheaper.
+            for (const BlockKind kind : {BlockKind::holding_registers, BlockKind::input_registers, BlockKind::coils,
+                                         BlockKind::discrete_inputs})
+            {
+                std::vector<size_t> order;
+                for (size_t i = 0; i < blocks.size(); ++i)
+                {
+                    if (blocks[i].kind == kind)
+                    {
+                        order.push_back(i);
+                    }
+                }
+                std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                                 { return blocks[a].address < blocks[b].address; });
+
+                const uint32_t limit = bit_block(kind) ? ScanPlan::max_bits_per_block : ScanPlan::max_registers_per_block;
+                BlockMerge group;
+                uint32_t first = 0;
+                uint32_t end = 0;
+                std::chrono::nanoseconds separate{0};
+                const auto flush = [&]()
+                {
+                    if (group.blocks.size() > 1)
+                    {
+                        group.device = index;
+                        group.merged = {kind, static_cast<uint16_t>(first), static_cast<uint16_t>(end - first)};
+                        group.saving = separate - cost(kind, static_cast<uint16_t>(end - first));
+                        merge_saving += std::chrono::duration<double>(group.saving).count() / interval;
+                        budget.merges.push_back(group);
+                    }
+                    group.blocks.clear();
+                };
+                for (size_t i : order)
+                {
+                    const ScanBlock &block = blocks[i];
+                    const uint32_t block_end = uint32_t{block.address} + block.count;
+                    if (!group.blocks.empty())
+                    {
+                        const uint32_t merged_end = std::max(end, block_end);
+                        if (merged_end - first <= limit &&
+                            cost(kind, static_cast<uint16_t>(merged_end - first)) <
+                                cost(kind, static_cast<uint16_t>(end - first)) + device_budget.block_time[i])
+                        {
+                            group.blocks.push_back(i);
+                            end = merged_end;
+                            separate += device_budget.block_time[i];
+                            continue;
+                        }
+                        flush();
+                    }
+                    group.blocks.push_back(i);
+                    first = block.address;
+                    end = block_end;
+                    separate = device_budget.block_time[i];
+                }
+                flush();
+            }
+            budget.devices.push_back(std::move(device_budget));
+        }
+
+        budget.feasible = budget.feasible && budget.occupancy <= config.max_occupancy;
+        budget.interval_scale = budget.occupancy / config.max_occupancy;
+        budget.merged_occupancy = budget.occupancy - merge_saving;
+        return budget;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,270 @@
+#include "libmodbus_cpp/derived_tags.hpp"
+#include "libmodbus_cpp/scan_poller.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        bool same_value(double a, double b)
+        {
+            return a == b || (std::isnan(a) && std::isnan(b));
+        }
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_input(uint32_t image_index, double scale, double offset)
+    {
+        const NodeId node = add_node(Op::input, {}, image_index);
+        scales_[node] = scale;
+        offsets_[node] = offset;
+        inputs_by_index_[image_index].push_back(node);
+        return node;
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_sum(std::span<const NodeId> operands)
+    {
+        return add_node(Op::sum, operands, 0);
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_difference(NodeId a, NodeId b)
+    {
+        const NodeId operands[] = {a, b};
+        return add_node(Op::difference, operands, 0);
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_product(NodeId a, NodeId b)
+    {
+        const NodeId operands[] = {a, b};
+        return add_node(Op::product, operands, 0);
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_quotient(NodeId a, NodeId b)
+    {
+        const NodeId operands[] = {a, b};
+        return add_node(Op::quotient, operands, 0);
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_power_factor(NodeId active, NodeId reactive)
+    {
+        const NodeId operands[] = {active, reactive};
+        return add_node(Op::power_factor, operands, 0);
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_rate_of_change(NodeId input)
+    {
+        const NodeId operands[] = {input};
+        const NodeId node = add_node(Op::rate_of_change, operands, 0);
+        if (node != invalid_node)
+        {
+            time_dependent_.push_back(node);
+        }
+        return node;
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_function(std::span<const NodeId> operands, Function function)
+    {
+        if (!function)
+        {
+            return invalid_node;
+        }
+
+        const NodeId node = add_node(Op::function, operands, static_cast<uint32_t>(functions_.size()));
+        if (node != invalid_node)
+        {
+            functions_.push_back(std::move(function));
+            scratch_.resize(std::max(scratch_.size(), operands.size()));
+        }
+        return node;
+    }
+
+    DerivedTagGraph::NodeId DerivedTagGraph::add_node(Op op, std::span<const NodeId> operands, uint32_t argument)
+    {
+        const auto node = static_cast<NodeId>(ops_.size());
+        if (node == invalid_node)
+        {
+            return invalid_node;
+        }
+
+        for (const NodeId operand : operands)
+        {
+            if (operand >= node)
+            {
+                return invalid_node;
+            }
+        }
+
+        ops_.push_back(op);
+        arguments_.push_back(argument);
+        scales_.push_back(1.0);
+        offsets_.push_back(0.0);
+        operand_begin_.push_back(static_cast<uint32_t>(operands_.size()));
+        operand_count_.push_back(static_cast<uint32_t>(operands.size()));
+        values_.push_back(std::numeric_limits<double>::quiet_NaN());
+        previous_input_.push_back(std::numeric_limits<double>::quiet_NaN());
+        queued_.push_back(0);
+        dependents_.emplace_back();
+
+        operands_.insert(operands_.end(), operands.begin(), operands.end());
+        for (const NodeId operand : operands)
+        {
+            dependents_[operand].push_back(node);
+        }
+
+        heap_.reserve(ops_.size());
+        changed_.reserve(ops_.size());
+
+        // A node added after the first update has no value yet.
+        if (initialized_)
+        {
+            schedule(node);
+        }
+        return node;
+    }
+
+    void DerivedTagGraph::update(const ScanResult &result)
+    {
+        update(result.image, result.changed, result.timestamp);
+    }
+
+    void DerivedTagGraph::update(std::span<const uint16_t> image, std::span<const uint32_t> changed,
+                                 std::chrono::system_clock::time_point timestamp)
+    {
+        changed_.clear();
+
+        double elapsed_seconds = 0.0;
+        if (!initialized_)
+        {
+            for (NodeId node = 0; node < ops_.size(); ++node)
+            {
+                schedule(node);
+            }
+            initialized_ = true;
+        }
+        else
+        {
+            elapsed_seconds = std::chrono::duration<double>(timestamp - last_update_).count();
+            for (const uint32_t index : changed)
+            {
+                const auto it = inputs_by_index_.find(index);
+                if (it == inputs_by_index_.end())
+                {
+                    continue;
+                }
+                for (const NodeId node : it->second)
+                {
+                    schedule(node);
+                }
+            }
+            for (const NodeId node : time_dependent_)
+            {
+                schedule(node);
+            }
+        }
+        last_update_ = timestamp;
+
+        // Node ids are topologically ordered, so popping the smallest id
+        // guarantees all operands of a node are final before it is evaluated.
+        while (!heap_.empty())
+        {
+            std::pop_heap(heap_.begin(), heap_.end(), std::greater<>{});
+            const NodeId node = heap_.back();
+            heap_.pop_back();
+            queued_[node] = 0;
+
+            const double value = evaluate(node, image, elapsed_seconds);
+            if (same_value(value, values_[node]))
+            {
+                continue;
+            }
+
+            values_[node] = value;
+            changed_.push_back(node);
+            for (const NodeId dependent : dependents_[node])
+            {
+                schedule(dependent);
+            }
+        }
+    }
+
+    double DerivedTagGraph::value(NodeId node) const noexcept
+    {
+        if (node >= values_.size())
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return values_[node];
+    }
+
+    void DerivedTagGraph::schedule(NodeId node)
+    {
+        if (queued_[node])
+        {
+            return;
+        }
+        queued_[node] = 1;
+        heap_.push_back(node);
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<>{});
+    }
+
+    double DerivedTagGraph::evaluate(NodeId node, std::span<const uint16_t> image, double elapsed_seconds)
+    {
+        const NodeId *operands = operands_.data() + operand_begin_[node];
+        const uint32_t count = operand_count_[node];
+
+        switch (ops_[node])
+        {
+        case Op::input:
+        {
+            const uint32_t index = arguments_[node];
+            if (index >= image.size())
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            return static_cast<double>(image[index]) * scales_[node] + offsets_[node];
+        }
+        case Op::sum:
+        {
+            double sum = 0.0;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                sum += values_[operands[i]];
+            }
+            return sum;
+        }
+        case Op::difference:
+            return values_[operands[0]] - values_[operands[1]];
+        case Op::product:
+            return values_[operands[0]] * values_[operands[1]];
+        case Op::quotient:
+            return values_[operands[0]] / values_[operands[1]];
+        case Op::power_factor:
+        {
+            const double active = values_[operands[0]];
+            const double apparent = std::hypot(active, values_[operands[1]]);
+            return apparent > 0.0 ? active / apparent : std::numeric_limits<double>::quiet_NaN();
+        }
+        case Op::rate_of_change:
+        {
+            const double current = values_[operands[0]];
+            const double previous = std::exchange(previous_input_[node], current);
+            return elapsed_seconds > 0.0 ? (current - previous) / elapsed_seconds : 0.0;
+        }
+        case Op::function:
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                scratch_[i] = values_[operands[i]];
+            }
+            return functions_[arguments_[node]](std::span<const double>(scratch_.data(), count));
+        }
+        }
+
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
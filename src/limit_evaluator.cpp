@@ -0,0 +1,155 @@
+#include "libmodbus_cpp/limit_evaluator.hpp"
+#include <algorithm>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        LimitState combine(double high, double low)
+        {
+            return static_cast<LimitState>(static_cast<int>(high != 0.0 ? high : -low));
+        }
+
+        // The restrict qualifiers spare the vectorizer a run-time alias check
+        // for every pair of arrays, which it would otherwise give up on.
+        void evaluate_levels(size_t count, const double *__restrict v,
+                             const double *__restrict lolo, const double *__restrict lo,
+                             const double *__restrict hi, const double *__restrict hihi,
+                             const double *__restrict lolo_hold, const double *__restrict lo_hold,
+                             const double *__restrict hi_hold, const double *__restrict hihi_hold,
+                             const double *__restrict high, const double *__restrict low,
+                             double *__restrict next_high, double *__restrict next_low)
+        {
+            // Branch-free pass over all tags: the number of limits reached gives
+            // the entry level, the number of hold thresholds still exceeded caps
+            // how long the current level is kept. Levels are kept as doubles so
+            // the loop stays in one vector width even on baseline SSE2.
+            for (size_t i = 0; i < count; ++i)
+            {
+                const double enter_high = (v[i] >= hi[i] ? 1.0 : 0.0) + (v[i] >= hihi[i] ? 1.0 : 0.0);
+                const double hold_high = (v[i] >= hi_hold[i] ? 1.0 : 0.0) + (v[i] >= hihi_hold[i] ? 1.0 : 0.0);
+                const double enter_low = (v[i] <= lo[i] ? 1.0 : 0.0) + (v[i] <= lolo[i] ? 1.0 : 0.0);
+                const double hold_low = (v[i] <= lo_hold[i] ? 1.0 : 0.0) + (v[i] <= lolo_hold[i] ? 1.0 : 0.0);
+
+                const double held_high = high[i] < hold_high ? high[i] : hold_high;
+                const double held_low = low[i] < hold_low ? low[i] : hold_low;
+
+                // Entering one side clears the other, even inside a wide deadband.
+                const double kept_high = enter_low == 0.0 ? held_high : 0.0;
+                const double kept_low = enter_high == 0.0 ? held_low : 0.0;
+
+                next_high[i] = enter_high > kept_high ? enter_high : kept_high;
+                next_low[i] = enter_low > kept_low ? enter_low : kept_low;
+            }
+        }
+    }
+
+    bool LimitEvaluator::valid(const LimitConfig &limits)
+    {
+        return limits.lolo <= limits.lo && limits.lo < limits.hi && limits.hi <= limits.hihi &&
+               limits.deadband >= 0.0;
+    }
+
+    bool LimitEvaluator::add_tag(const LimitConfig &limits)
+    {
+        if (!valid(limits))
+        {
+            return false;
+        }
+
+        const size_t count = tag_count() + 1;
+        lolo_.resize(count);
+        lo_.resize(count);
+        hi_.resize(count);
+        hihi_.resize(count);
+        lolo_hold_.resize(count);
+        lo_hold_.resize(count);
+        hi_hold_.resize(count);
+        hihi_hold_.resize(count);
+        high_.resize(count, 0.0);
+        low_.resize(count, 0.0);
+        next_high_.resize(count, 0.0);
+        next_low_.resize(count, 0.0);
+        transitions_.reserve(count);
+
+        store(count - 1, limits);
+        return true;
+    }
+
+    bool LimitEvaluator::set_limits(size_t tag, const LimitConfig &limits)
+    {
+        if (tag >= tag_count() || !valid(limits))
+        {
+            return false;
+        }
+
+        store(tag, limits);
+        return true;
+    }
+
+    void LimitEvaluator::store(size_t tag, const LimitConfig &limits)
+    {
+        lolo_[tag] = limits.lolo;
+        lo_[tag] = limits.lo;
+        hi_[tag] = limits.hi;
+        hihi_[tag] = limits.hihi;
+        lolo_hold_[tag] = limits.lolo + limits.deadband;
+        lo_hold_[tag] = limits.lo + limits.deadband;
+        hi_hold_[tag] = limits.hi - limits.deadband;
+        hihi_hold_[tag] = limits.hihi - limits.deadband;
+    }
+
+    bool LimitEvaluator::evaluate(std::span<const double> values)
+    {
+        transitions_.clear();
+
+        const size_t count = tag_count();
+        if (values.size() < count)
+        {
+            return false;
+        }
+
+        evaluate_levels(count, values.data(),
+                        lolo_.data(), lo_.data(), hi_.data(), hihi_.data(),
+                        lolo_hold_.data(), lo_hold_.data(), hi_hold_.data(), hihi_hold_.data(),
+                        high_.data(), low_.data(), next_high_.data(), next_low_.data());
+
+        const double *v = values.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (next_high_[i] == high_[i] && next_low_[i] == low_[i])
+            {
+                continue;
+            }
+
+            transitions_.push_back({static_cast<uint32_t>(i),
+                                    combine(high_[i], low_[i]),
+                                    combine(next_high_[i], next_low_[i]),
+                                    v[i]});
+            high_[i] = next_high_[i];
+            low_[i] = next_low_[i];
+        }
+
+        return true;
+    }
+
+    LimitState LimitEvaluator::state(size_t tag) const noexcept
+    {
+        if (tag >= tag_count())
+        {
+            return LimitState::normal;
+        }
+        return combine(high_[tag], low_[tag]);
+    }
+
+    void LimitEvaluator::reset()
+    {
+        std::fill(high_.begin(), high_.end(), 0.0);
+        std::fill(low_.begin(), low_.end(), 0.0);
+        transitions_.clear();
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
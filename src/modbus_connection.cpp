@@ -1,6 +1,12 @@
 #include "libmodbus_cpp/modbus_connection.hpp"
+#include "libmodbus_cpp/request_trace.hpp"
+#include "ascii_link.hpp"
+#include "modbus_probes.hpp"
 #include <modbus/modbus.h>
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <thread>
 #include <utility>
 #include <stdexcept>
 #include <cerrno>
@@ -13,6 +19,25 @@
 #include <sys/socket.h>
 #endif
 
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <poll.h>
+#endif
+
+#ifdef LIBMODBUS_CPP_HAVE_USDT
+// USDT semaphores, incremented by tracers attached to the probe of the same name.
+#define LIBMODBUS_CPP_PROBE_SEMAPHORE(name) \
+    unsigned short libmodbus_cpp_##name##_semaphore __attribute__((unused, section(".probes"))) = 0
+LIBMODBUS_CPP_PROBE_SEMAPHORE(request__submit);
+LIBMODBUS_CPP_PROBE_SEMAPHORE(request__complete);
+LIBMODBUS_CPP_PROBE_SEMAPHORE(request__retry);
+LIBMODBUS_CPP_PROBE_SEMAPHORE(socket__drain);
+LIBMODBUS_CPP_PROBE_SEMAPHORE(connect);
+LIBMODBUS_CPP_PROBE_SEMAPHORE(disconnect);
+#undef LIBMODBUS_CPP_PROBE_SEMAPHORE
+#endif
+
 namespace libmodbus_cpp
 {
     inline namespace v1
@@ -35,6 +60,7 @@ namespace libmodbus_cpp
             {
                 return;
             }
+            LIBMODBUS_CPP_PROBE1(socket__drain, socket_fd);
 
 #ifdef _WIN32
             // Set socket to non-blocking mode for drain
@@ -87,24 +113,313 @@ namespace libmodbus_cpp
 #endif
         }
 
+        void drain_input(modbus_t *ctx)
+        {
+            // An RTU context (one byte header) reads a serial line, not a socket.
+            if (modbus_get_header_length(ctx) == 1)
+            {
+                modbus_flush(ctx);
+                return;
+            }
+            drain_socket_nonblocking(ctx);
+        }
+
+#ifdef __linux__
+        // Read request written to the socket directly so the kernel receive
+        // timestamp can be peeked before libmodbus consumes the response. The
+        // MBAP header is built here (libmodbus keeps its transaction id
+        // private), so the response can be matched by transaction and unit id.
+        // Returns the number of registers/bits read, or -1 with errno set.
+        int timed_read(modbus_t *ctx, uint8_t function, uint16_t address, uint16_t count,
+                       void *dest, uint16_t &transaction_id, TransactionTiming &timing)
+        {
+            const bool bits = function == 0x01 || function == 0x02;
+            if (count == 0 || count > (bits ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGISTERS))
+            {
+                errno = EMBMDATA;
+                return -1;
+            }
+
+            const int slave = modbus_get_slave(ctx);
+            ++transaction_id;
+            const uint8_t request[] = {
+                static_cast<uint8_t>(transaction_id >> 8),
+                static_cast<uint8_t>(transaction_id & 0xFF),
+                0x00,
+                0x00,
+                0x00,
+                0x06,
+                static_cast<uint8_t>(slave),
+                function,
+                static_cast<uint8_t>(address >> 8),
+                static_cast<uint8_t>(address & 0xFF),
+                static_cast<uint8_t>(count >> 8),
+                static_cast<uint8_t>(count & 0xFF),
+            };
+
+            const int socket_fd = modbus_get_socket(ctx);
+            timing.request_sent = std::chrono::system_clock::now();
+            // A partly written request would desynchronize the stream: the rest
+            // is sent before anything else, and if that fails the connection
+            // is shut down so later requests fail instead of misreading it.
+            for (size_t sent = 0; sent < sizeof(request);)
+            {
+                const ssize_t written = send(socket_fd, request + sent, sizeof(request) - sent, MSG_NOSIGNAL);
+                if (written > 0)
+                {
+                    sent += static_cast<size_t>(written);
+                    continue;
+                }
+                if (written == -1 && errno == EINTR)
+                {
+                    continue;
+                }
+                const int error = written == 0 ? EIO : errno;
+                if (sent != 0)
+                {
+                    shutdown(socket_fd, SHUT_RDWR);
+                }
+                errno = error;
+                return -1;
+            }
+
+            uint32_t timeout_sec = 0;
+            uint32_t timeout_usec = 0;
+            modbus_get_response_timeout(ctx, &timeout_sec, &timeout_usec);
+            const auto timeout_end = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec) +
+                                     std::chrono::microseconds(timeout_usec);
+
+            // Late responses to earlier (timed out) requests carry another
+            // transaction id; they are skipped while the response is awaited.
+            uint8_t response[MODBUS_MAX_ADU_LENGTH];
+            int length = 0;
+            bool stale = false;
+            const int offset = modbus_get_header_length(ctx);
+            do
+            {
+                const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(timeout_end - std::chrono::steady_clock::now());
+                pollfd descriptor{socket_fd, POLLIN, 0};
+                const int ready = poll(&descriptor, 1, static_cast<int>(std::max<int64_t>(remaining.count(), 0)));
+                if (ready <= 0)
+                {
+                    if (ready == 0)
+                    {
+                        // Only stale responses arrived: bad data, so the socket is drained and the read retried.
+                        errno = stale ? EMBBADDATA : ETIMEDOUT;
+                    }
+                    return -1;
+                }
+
+                uint8_t peek_byte = 0;
+                iovec vector{&peek_byte, sizeof(peek_byte)};
+                alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+                msghdr message{};
+                message.msg_iov = &vector;
+                message.msg_iovlen = 1;
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+                timing.response_received = std::chrono::system_clock::now();
+                timing.kernel_timestamp = false;
+                if (recvmsg(socket_fd, &message, MSG_PEEK | MSG_DONTWAIT) > 0)
+                {
+                    for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+                    {
+                        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_TIMESTAMPING)
+                        {
+                            continue;
+                        }
+                        scm_timestamping stamps{};
+                        std::memcpy(&stamps, CMSG_DATA(header), sizeof(stamps));
+                        if (stamps.ts[0].tv_sec != 0 || stamps.ts[0].tv_nsec != 0)
+                        {
+                            timing.response_received = std::chrono::system_clock::time_point(
+                                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                    std::chrono::seconds(stamps.ts[0].tv_sec) + std::chrono::nanoseconds(stamps.ts[0].tv_nsec)));
+                            timing.kernel_timestamp = true;
+                        }
+                    }
+                }
+
+                length = modbus_receive_confirmation(ctx, response);
+                if (length == -1)
+                {
+                    return -1;
+                }
+                stale = length < offset || response[0] != request[0] || response[1] != request[1];
+            } while (stale);
+
+            // A response from another unit is bad data as well.
+            if (length < offset + 2 || response[offset - 1] != request[6])
+            {
+                errno = EMBBADDATA;
+                return -1;
+            }
+
+            if (response[offset] == (function | 0x80))
+            {
+                errno = MODBUS_ENOBASE + response[offset + 1];
+                return -1;
+            }
+
+            const int expected_bytes = bits ? (count + 7) / 8 : count * 2;
+            if (response[offset] != function || response[offset + 1] != expected_bytes ||
+                length < offset + 2 + expected_bytes)
+            {
+                errno = EMBBADDATA;
+                return -1;
+            }
+
+            const uint8_t *data = response + offset + 2;
+            if (bits)
+            {
+                auto *values = static_cast<uint8_t *>(dest);
+                for (uint16_t i = 0; i < count; ++i)
+                {
+                    values[i] = (data[i / 8] >> (i % 8)) & 0x01;
+                }
+            }
+            else
+            {
+                auto *values = static_cast<uint16_t *>(dest);
+                for (uint16_t i = 0; i < count; ++i)
+                {
+                    values[i] = static_cast<uint16_t>((data[2 * i] << 8) | data[2 * i + 1]);
+                }
+            }
+            return count;
+        }
+#else
+        int timed_read(modbus_t *, uint8_t, uint16_t, uint16_t, void *, uint16_t &, TransactionTiming &)
+        {
+            errno = ENOTSUP;
+            return -1;
+        }
+#endif
+
+        struct RequestInfo
+        {
+            uint8_t function;
+            uint16_t address;
+            uint16_t count;
+        };
+
+        // libmodbus context or ASCII link a request runs on.
+        struct Link
+        {
+            modbus_t *ctx;
+            AsciiLink *ascii;
+            std::chrono::steady_clock::time_point &turnaround_until;
+
+            int slave() const
+            {
+                return ascii ? ascii->slave() : modbus_get_slave(ctx);
+            }
+
+            void drain() const
+            {
+                if (ascii)
+                {
+                    ascii->flush();
+                }
+                else
+                {
+                    drain_input(ctx);
+                }
+            }
+
+            // Holds the request back until the slaves have processed a
+            // preceding broadcast. TCP devices that answered it anyway are
+            // drained.
+            void settle() const
+            {
+                if (turnaround_until == std::chrono::steady_clock::time_point{})
+                {
+                    return;
+                }
+                std::this_thread::sleep_until(turnaround_until);
+                turnaround_until = {};
+                drain();
+            }
+        };
+
         template <typename Operation>
-        bool execute_with_data_error_retry(modbus_t *ctx,
+        bool execute_with_data_error_retry(const Link &link,
                                            std::string &last_error,
+                                           TransactionTiming &timing,
+                                           const RequestInfo &request,
                                            const char *error_prefix,
                                            Operation operation)
         {
+            RequestTracer &tracer = RequestTracer::instance();
+            const bool tracing = tracer.enabled();
+            TraceRecord trace;
+            if (tracing)
+            {
+                trace.transaction = tracer.next_transaction();
+                trace.function = request.function;
+                trace.address = request.address;
+                trace.count = request.count;
+            }
+
+            link.settle();
             constexpr int max_attempts = 2;
             for (int attempt = 0; attempt < max_attempts; ++attempt)
             {
-                if (operation() != -1)
+                LIBMODBUS_CPP_PROBE4(request__submit, request.function, request.address, request.count,
+                                     link.slave());
+                timing = TransactionTiming{std::chrono::system_clock::now(), {}, false};
+                const int result = operation();
+                const int error_code = errno;
+                const auto finished = std::chrono::system_clock::now();
+                if (!timing.kernel_timestamp)
+                {
+                    timing.response_received = finished;
+                }
+                LIBMODBUS_CPP_PROBE5(request__complete, request.function, request.address, request.count,
+                                     static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                              finished - timing.request_sent)
+                                                              .count()),
+                                     result == -1 ? error_code : 0);
+
+                if (tracing)
+                {
+                    trace.error = 0;
+                    trace.event = TraceEvent::send;
+                    trace.time = timing.request_sent;
+                    tracer.record(trace);
+                    if (timing.kernel_timestamp)
+                    {
+                        trace.event = TraceEvent::first_byte;
+                        trace.time = timing.response_received;
+                        tracer.record(trace);
+                    }
+                    trace.event = TraceEvent::complete;
+                    trace.time = finished;
+                    trace.error = result == -1 ? error_code : 0;
+                    tracer.record(trace);
+                }
+
+                if (result != -1)
                 {
                     return true;
                 }
 
-                const int error_code = errno;
                 if (attempt == 0 && is_retryable_modbus_data_error(error_code))
                 {
-                    drain_socket_nonblocking(ctx);
+                    LIBMODBUS_CPP_PROBE3(request__retry, request.function, request.address, error_code);
+                    if (tracing)
+                    {
+                        trace.event = TraceEvent::retry;
+                        tracer.record(trace);
+                    }
+                    link.drain();
+                    if (tracing)
+                    {
+                        trace.event = TraceEvent::drain;
+                        trace.time = std::chrono::system_clock::now();
+                        trace.error = 0;
+                        tracer.record(trace);
+                    }
                     continue;
                 }
 
@@ -127,6 +442,25 @@ namespace libmodbus_cpp
         }
     }
 
+    ModbusConnection::ModbusConnection(const SerialConfig &serial, SerialFraming framing)
+        : ctx_(nullptr), connected_(false), serial_(true)
+    {
+        if (serial.baud > 0)
+        {
+            character_time_ = rtu_timing(serial).character;
+        }
+        if (framing == SerialFraming::ascii)
+        {
+            ascii_ = std::make_unique<AsciiLink>(serial);
+            return;
+        }
+        ctx_ = modbus_new_rtu(serial.device.c_str(), serial.baud, serial.parity, serial.data_bits, serial.stop_bits);
+        if (!ctx_)
+        {
+            last_error_ = "Failed to create MODBUS RTU context for " + serial.device;
+        }
+    }
+
     ModbusConnection::~ModbusConnection()
     {
         if (connected_)
@@ -141,8 +475,15 @@ namespace libmodbus_cpp
     }
 
     ModbusConnection::ModbusConnection(ModbusConnection &&other) noexcept
-        : ctx_(other.ctx_), connected_(other.connected_),
-          last_error_(std::move(other.last_error_))
+        : ctx_(other.ctx_), connected_(other.connected_), serial_(other.serial_),
+          ascii_(std::move(other.ascii_)),
+          last_error_(std::move(other.last_error_)),
+          kernel_timestamps_(other.kernel_timestamps_),
+          last_timing_(other.last_timing_),
+          transaction_id_(other.transaction_id_),
+          character_time_(other.character_time_),
+          turnaround_delay_(other.turnaround_delay_),
+          turnaround_until_(other.turnaround_until_)
     {
         other.ctx_ = nullptr;
         other.connected_ = false;
@@ -163,7 +504,15 @@ namespace libmodbus_cpp
 
             ctx_ = other.ctx_;
             connected_ = other.connected_;
+            serial_ = other.serial_;
+            ascii_ = std::move(other.ascii_);
             last_error_ = std::move(other.last_error_);
+            kernel_timestamps_ = other.kernel_timestamps_;
+            last_timing_ = other.last_timing_;
+            transaction_id_ = other.transaction_id_;
+            character_time_ = other.character_time_;
+            turnaround_delay_ = other.turnaround_delay_;
+            turnaround_until_ = other.turnaround_until_;
 
             other.ctx_ = nullptr;
             other.connected_ = false;
@@ -173,7 +522,7 @@ namespace libmodbus_cpp
 
     bool ModbusConnection::connect()
     {
-        if (!ctx_)
+        if (!ctx_ && !ascii_)
         {
             last_error_ = "Invalid MODBUS context";
             return false;
@@ -184,17 +533,34 @@ namespace libmodbus_cpp
             return true;
         }
 
+        if (ascii_)
+        {
+            if (!ascii_->open(last_error_))
+            {
+                last_error_ = "Connection failed: " + last_error_;
+                return false;
+            }
+            connected_ = true;
+            return true;
+        }
+
         // Retry connection a few times if we get EWOULDBLOCK
         const int max_retries = 3;
         for (int attempt = 0; attempt < max_retries; ++attempt)
         {
             if (modbus_connect(ctx_) == 0)
             {
+                LIBMODBUS_CPP_PROBE2(connect, modbus_get_socket(ctx_), 0);
                 connected_ = true;
+                if (kernel_timestamps_ && !apply_kernel_timestamps())
+                {
+                    kernel_timestamps_ = false;
+                }
                 return true;
             }
 
             int err = errno;
+            LIBMODBUS_CPP_PROBE2(connect, -1, err);
 #ifdef _WIN32
             if (err == EWOULDBLOCK)
 #else
@@ -222,8 +588,14 @@ namespace libmodbus_cpp
 
     void ModbusConnection::disconnect()
     {
+        if (ascii_ && connected_)
+        {
+            ascii_->close();
+            connected_ = false;
+        }
         if (ctx_ && connected_)
         {
+            LIBMODBUS_CPP_PROBE1(disconnect, modbus_get_socket(ctx_));
             modbus_close(ctx_);
             connected_ = false;
         }
@@ -237,9 +609,11 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Read failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x03, address, 1}, "Read failed: ",
                                              [this, address, &value]()
-                                             { return modbus_read_registers(ctx_, address, 1, &value); });
+                                             { return ascii_ ? ascii_->read_registers(0x03, address, 1, &value)
+                                                      : kernel_timestamps_ ? timed_read(ctx_, 0x03, address, 1, &value, transaction_id_, last_timing_)
+                                                                           : modbus_read_registers(ctx_, address, 1, &value); });
     }
 
     bool ModbusConnection::read_registers(uint16_t address, uint16_t count, uint16_t *values)
@@ -250,9 +624,26 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Read failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x03, address, count}, "Read failed: ",
+                                             [this, address, count, values]()
+                                             { return ascii_ ? ascii_->read_registers(0x03, address, count, values)
+                                                      : kernel_timestamps_ ? timed_read(ctx_, 0x03, address, count, values, transaction_id_, last_timing_)
+                                                                           : modbus_read_registers(ctx_, address, count, values); });
+    }
+
+    bool ModbusConnection::read_input_registers(uint16_t address, uint16_t count, uint16_t *values)
+    {
+        if (!connected_)
+        {
+            last_error_ = "Not connected";
+            return false;
+        }
+
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x04, address, count}, "Read input registers failed: ",
                                              [this, address, count, values]()
-                                             { return modbus_read_registers(ctx_, address, count, values); });
+                                             { return ascii_ ? ascii_->read_registers(0x04, address, count, values)
+                                                      : kernel_timestamps_ ? timed_read(ctx_, 0x04, address, count, values, transaction_id_, last_timing_)
+                                                                           : modbus_read_input_registers(ctx_, address, count, values); });
     }
 
     bool ModbusConnection::write_register(uint16_t address, uint16_t value)
@@ -263,9 +654,10 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Write failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x06, address, 1}, "Write failed: ",
                                              [this, address, value]()
-                                             { return modbus_write_register(ctx_, address, value); });
+                                             { return ascii_ ? ascii_->write_register(address, value)
+                                                             : modbus_write_register(ctx_, address, value); });
     }
 
     bool ModbusConnection::write_registers(uint16_t address, uint16_t count, const uint16_t *values)
@@ -276,9 +668,72 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Write failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x10, address, count}, "Write failed: ",
                                              [this, address, count, values]()
-                                             { return modbus_write_registers(ctx_, address, count, values); });
+                                             { return ascii_ ? ascii_->write_registers(address, count, values)
+                                                             : modbus_write_registers(ctx_, address, count, values); });
+    }
+
+    bool ModbusConnection::broadcast_write_register(uint16_t address, uint16_t value)
+    {
+        const uint8_t request[] = {
+            0,
+            0x06,
+            static_cast<uint8_t>(address >> 8),
+            static_cast<uint8_t>(address & 0xFF),
+            static_cast<uint8_t>(value >> 8),
+            static_cast<uint8_t>(value & 0xFF),
+        };
+        return send_broadcast(request, sizeof(request));
+    }
+
+    bool ModbusConnection::broadcast_write_registers(uint16_t address, uint16_t count, const uint16_t *values)
+    {
+        if (count == 0 || count > MODBUS_MAX_WRITE_REGISTERS)
+        {
+            last_error_ = std::string("Broadcast failed: ") + modbus_strerror(EMBMDATA);
+            return false;
+        }
+
+        std::array<uint8_t, 7 + 2 * MODBUS_MAX_WRITE_REGISTERS> request;
+        request[0] = 0;
+        request[1] = 0x10;
+        request[2] = static_cast<uint8_t>(address >> 8);
+        request[3] = static_cast<uint8_t>(address & 0xFF);
+        request[4] = static_cast<uint8_t>(count >> 8);
+        request[5] = static_cast<uint8_t>(count & 0xFF);
+        request[6] = static_cast<uint8_t>(count * 2);
+        for (size_t i = 0; i < count; ++i)
+        {
+            request[7 + 2 * i] = static_cast<uint8_t>(values[i] >> 8);
+            request[8 + 2 * i] = static_cast<uint8_t>(values[i] & 0xFF);
+        }
+        return send_broadcast(request.data(), 7 + size_t{count} * 2);
+    }
+
+    bool ModbusConnection::send_broadcast(const uint8_t *request, size_t length)
+    {
+        if (!connected_)
+        {
+            last_error_ = "Not connected";
+            return false;
+        }
+
+        // Back-to-back broadcasts are spaced like any other request.
+        Link{ctx_, ascii_.get(), turnaround_until_}.settle();
+        const int result = ascii_ ? ascii_->send_raw(request, length)
+                                  : modbus_send_raw_request(ctx_, request, static_cast<int>(length));
+        if (result == -1)
+        {
+            last_error_ = std::string("Broadcast failed: ") + modbus_strerror(errno);
+            return false;
+        }
+
+        // Characters on the wire: RTU adds the CRC, ASCII hex encodes and adds ':', LRC and CR LF.
+        const size_t wire_length = ascii_ ? 2 * (length + 1) + 3 : length + 2;
+        turnaround_until_ = std::chrono::steady_clock::now() +
+                            character_time_ * static_cast<int64_t>(wire_length) + turnaround_delay_;
+        return true;
     }
 
     bool ModbusConnection::read_coil(uint16_t address, bool &value)
@@ -290,9 +745,11 @@ namespace libmodbus_cpp
         }
 
         uint8_t coil_value = 0;
-        const bool success = execute_with_data_error_retry(ctx_, last_error_, "Read coil failed: ",
+        const bool success = execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x01, address, 1}, "Read coil failed: ",
                                                            [this, address, &coil_value]()
-                                                           { return modbus_read_bits(ctx_, address, 1, &coil_value); });
+                                                           { return ascii_ ? ascii_->read_bits(0x01, address, 1, &coil_value)
+                                                                    : kernel_timestamps_ ? timed_read(ctx_, 0x01, address, 1, &coil_value, transaction_id_, last_timing_)
+                                                                                         : modbus_read_bits(ctx_, address, 1, &coil_value); });
         if (!success)
         {
             return false;
@@ -310,9 +767,11 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Read coils failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x01, address, count}, "Read coils failed: ",
                                              [this, address, count, values]()
-                                             { return modbus_read_bits(ctx_, address, count, values); });
+                                             { return ascii_ ? ascii_->read_bits(0x01, address, count, values)
+                                                      : kernel_timestamps_ ? timed_read(ctx_, 0x01, address, count, values, transaction_id_, last_timing_)
+                                                                           : modbus_read_bits(ctx_, address, count, values); });
     }
 
     bool ModbusConnection::read_discrete_input(uint16_t address, bool &value)
@@ -324,9 +783,11 @@ namespace libmodbus_cpp
         }
 
         uint8_t input_value = 0;
-        const bool success = execute_with_data_error_retry(ctx_, last_error_, "Read discrete input failed: ",
+        const bool success = execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x02, address, 1}, "Read discrete input failed: ",
                                                            [this, address, &input_value]()
-                                                           { return modbus_read_input_bits(ctx_, address, 1, &input_value); });
+                                                           { return ascii_ ? ascii_->read_bits(0x02, address, 1, &input_value)
+                                                                    : kernel_timestamps_ ? timed_read(ctx_, 0x02, address, 1, &input_value, transaction_id_, last_timing_)
+                                                                                         : modbus_read_input_bits(ctx_, address, 1, &input_value); });
         if (!success)
         {
             return false;
@@ -344,9 +805,11 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Read discrete inputs failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x02, address, count}, "Read discrete inputs failed: ",
                                              [this, address, count, values]()
-                                             { return modbus_read_input_bits(ctx_, address, count, values); });
+                                             { return ascii_ ? ascii_->read_bits(0x02, address, count, values)
+                                                      : kernel_timestamps_ ? timed_read(ctx_, 0x02, address, count, values, transaction_id_, last_timing_)
+                                                                           : modbus_read_input_bits(ctx_, address, count, values); });
     }
 
     bool ModbusConnection::write_coil(uint16_t address, bool state)
@@ -357,9 +820,10 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Write coil failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x05, address, 1}, "Write coil failed: ",
                                              [this, address, state]()
-                                             { return modbus_write_bit(ctx_, address, state ? 1 : 0); });
+                                             { return ascii_ ? ascii_->write_bit(address, state)
+                                                             : modbus_write_bit(ctx_, address, state ? 1 : 0); });
     }
 
     bool ModbusConnection::write_coils(uint16_t address, uint16_t count, const uint8_t *values)
@@ -370,14 +834,25 @@ namespace libmodbus_cpp
             return false;
         }
 
-        return execute_with_data_error_retry(ctx_, last_error_, "Write coils failed: ",
+        return execute_with_data_error_retry({ctx_, ascii_.get(), turnaround_until_}, last_error_, last_timing_, {0x0F, address, count}, "Write coils failed: ",
                                              [this, address, count, values]()
-                                             { return modbus_write_bits(ctx_, address, count, values); });
+                                             { return ascii_ ? ascii_->write_bits(address, count, values)
+                                                             : modbus_write_bits(ctx_, address, count, values); });
     }
 
     // Add to implementation
     bool ModbusConnection::set_slave_id(int slave_id)
     {
+        if (ascii_)
+        {
+            if (!ascii_->set_slave(slave_id))
+            {
+                last_error_ = std::string("Set slave failed: ") + modbus_strerror(errno);
+                return false;
+            }
+            return true;
+        }
+
         if (!ctx_)
         {
             last_error_ = "Invalid MODBUS context";
@@ -400,11 +875,64 @@ namespace libmodbus_cpp
 
     void ModbusConnection::set_response_timeout(uint32_t seconds, uint32_t microseconds)
     {
+        if (ascii_)
+        {
+            ascii_->set_response_timeout(std::chrono::seconds(seconds) + std::chrono::microseconds(microseconds));
+        }
         if (ctx_)
         {
             modbus_set_response_timeout(ctx_, seconds, microseconds);
         }
     }
 
+    bool ModbusConnection::set_kernel_timestamps(bool enable)
+    {
+#ifdef __linux__
+        if (!enable)
+        {
+            kernel_timestamps_ = false;
+            return true;
+        }
+
+        if (serial_)
+        {
+            last_error_ = "Kernel timestamps are only supported on TCP connections";
+            return false;
+        }
+
+        if (connected_ && !apply_kernel_timestamps())
+        {
+            return false;
+        }
+
+        kernel_timestamps_ = true;
+        return true;
+#else
+        if (enable)
+        {
+            last_error_ = "Kernel timestamps not supported on this platform";
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    bool ModbusConnection::apply_kernel_timestamps()
+    {
+#ifdef __linux__
+        const int socket_fd = ctx_ ? modbus_get_socket(ctx_) : -1;
+        const int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (socket_fd < 0 || setsockopt(socket_fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == -1)
+        {
+            last_error_ = std::string("Enable kernel timestamps failed: ") + std::strerror(errno);
+            return false;
+        }
+        return true;
+#else
+        last_error_ = "Kernel timestamps not supported on this platform";
+        return false;
+#endif
+    }
+
     } // namespace v1
 } // namespace libmodbus_cpp
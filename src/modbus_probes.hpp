@@ -0,0 +1,114 @@
+#pragma once
+
+// USDT probes of the "libmodbus_cpp" provider. Every probe is guarded by a
+// USDT semaphore that tracers (bpftrace, perf, SystemTap) increment while
+// they are attached: until then a probe site costs a load and a not-taken
+// branch, and its arguments (e.g. the slave id or the latency) are not
+// computed. Without <sys/sdt.h>, or when built with
+// LIBMODBUS_CPP_DISABLE_USDT, the probes compile to nothing.
+//
+//   request__submit(function, address, count, slave)
+//   request__complete(function, address, count, latency_ns, error)
+//   request__retry(function, address, error)
+//   socket__drain(socket)
+//   connect(socket, error)
+//   disconnect(socket)
+//
+// Example: bpftrace -e 'usdt:./libmodbus_cpp.so:libmodbus_cpp:request__complete { @us = hist(arg3 / 1000); }'
+
+#if !defined(LIBMODBUS_CPP_DISABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define LIBMODBUS_CPP_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef LIBMODBUS_CPP_HAVE_USDT
+// Semaphores are defined in modbus_connection.cpp; sdt.h refers to them by
+// these (unmangled, global) names.
+extern unsigned short libmodbus_cpp_request__submit_semaphore;
+extern unsigned short libmodbus_cpp_request__complete_semaphore;
+extern unsigned short libmodbus_cpp_request__retry_semaphore;
+extern unsigned short libmodbus_cpp_socket__drain_semaphore;
+extern unsigned short libmodbus_cpp_connect_semaphore;
+extern unsigned short libmodbus_cpp_disconnect_semaphore;
+
+#define LIBMODBUS_CPP_PROBE_ENABLED(name) __builtin_expect(libmodbus_cpp_##name##_semaphore != 0, 0)
+#define LIBMODBUS_CPP_PROBE1(name, a)                \
+    do                                               \
+    {                                                \
+        if (LIBMODBUS_CPP_PROBE_ENABLED(name))       \
+        {                                            \
+            STAP_PROBE1(libmodbus_cpp, name, a);     \
+        }                                            \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE2(name, a, b)             \
+    do                                               \
+    {                                                \
+        if (LIBMODBUS_CPP_PROBE_ENABLED(name))       \
+        {                                            \
+            STAP_PROBE2(libmodbus_cpp, name, a, b);  \
+        }                                            \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE3(name, a, b, c)             \
+    do                                                  \
+    {                                                   \
+        if (LIBMODBUS_CPP_PROBE_ENABLED(name))          \
+        {                                               \
+            STAP_PROBE3(libmodbus_cpp, name, a, b, c);  \
+        }                                               \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE4(name, a, b, c, d)             \
+    do                                                     \
+    {                                                      \
+        if (LIBMODBUS_CPP_PROBE_ENABLED(name))             \
+        {                                                  \
+            STAP_PROBE4(libmodbus_cpp, name, a, b, c, d);  \
+        }                                                  \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE5(name, a, b, c, d, e)             \
+    do                                                        \
+    {                                                         \
+        if (LIBMODBUS_CPP_PROBE_ENABLED(name))                \
+        {                                                     \
+            STAP_PROBE5(libmodbus_cpp, name, a, b, c, d, e);  \
+        }                                                     \
+    } while (0)
+#else
+#define LIBMODBUS_CPP_PROBE1(name, a) \
+    do                                \
+    {                                 \
+        (void)sizeof(a);              \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE2(name, a, b) \
+    do                                   \
+    {                                    \
+        (void)sizeof(a);                 \
+        (void)sizeof(b);                 \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE3(name, a, b, c) \
+    do                                      \
+    {                                       \
+        (void)sizeof(a);                    \
+        (void)sizeof(b);                    \
+        (void)sizeof(c);                    \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE4(name, a, b, c, d) \
+    do                                         \
+    {                                          \
+        (void)sizeof(a);                       \
+        (void)sizeof(b);                       \
+        (void)sizeof(c);                       \
+        (void)sizeof(d);                       \
+    } while (0)
+#define LIBMODBUS_CPP_PROBE5(name, a, b, c, d, e) \
+    do                                            \
+    {                                             \
+        (void)sizeof(a);                          \
+        (void)sizeof(b);                          \
+        (void)sizeof(c);                          \
+        (void)sizeof(d);                          \
+        (void)sizeof(e);                          \
+    } while (0)
+#endif
@@ -0,0 +1,2228 @@
+#include "libmodbus_cpp/modbus_server.hpp"
+#include "bounded_queue.hpp"
+#include "serial_port.hpp"
+#include <modbus/modbus.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <semaphore>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#endif
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        // Converts between host order and Modbus wire order (big-endian);
+        // the conversion is its own inverse.
+        uint16_t wire_order(uint16_t value)
+        {
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                return std::byteswap(value);
+            }
+            else
+            {
+                return value;
+            }
+        }
+
+        uint8_t bit_value(uint16_t value)
+        {
+            return value != 0 ? 1 : 0;
+        }
+    }
+
+    struct ModbusServer::Device
+    {
+        struct Generator
+        {
+            RegisterTable table;
+            uint16_t address;
+            uint16_t count;
+            ValueGenerator function;
+            std::chrono::nanoseconds period;
+            std::chrono::nanoseconds last{0};
+            bool ran = false;
+        };
+
+        struct WriteHook
+        {
+            RegisterTable table;
+            uint16_t address;
+            uint16_t count;
+            WriteHandler function;
+            WriteMode mode;
+        };
+
+        size_t index = 0;
+        DeviceConfig config;
+        mutable std::mutex mutex;
+        std::vector<uint8_t> coils;
+        std::vector<uint8_t> discrete_inputs;
+        // Registers are kept in wire order, so reads and writes by masters
+        // are plain copies; only the application and generators convert.
+        std::vector<uint16_t> holding_registers;
+        std::vector<uint16_t> input_registers;
+        std::vector<Generator> generators;
+        std::vector<uint16_t> scratch; ///< Host-order values handed to generators
+        std::vector<WriteHook> write_hooks;
+        /// Incremented whenever a value may have changed (for response caches)
+        std::atomic<uint64_t> version{0};
+        Listener *listener = nullptr;
+
+        size_t size(RegisterTable table) const
+        {
+            switch (table)
+            {
+            case RegisterTable::coils:
+                return coils.size();
+            case RegisterTable::discrete_inputs:
+                return discrete_inputs.size();
+            case RegisterTable::holding_registers:
+                return holding_registers.size();
+            case RegisterTable::input_registers:
+                return input_registers.size();
+            }
+            return 0;
+        }
+
+        // Runs the generators overlapping a register range that are due.
+        void generate(RegisterTable table, size_t address, size_t count, std::chrono::nanoseconds elapsed)
+        {
+            std::vector<uint16_t> &registers =
+                table == RegisterTable::holding_registers ? holding_registers : input_registers;
+            for (Generator &generator : generators)
+            {
+                if (generator.table != table || generator.address >= address + count ||
+                    generator.address + generator.count <= address)
+                {
+                    continue;
+                }
+                if (generator.ran && elapsed - generator.last < generator.period)
+                {
+                    continue;
+                }
+                const auto wire = std::span<uint16_t>(registers).subspan(generator.address, generator.count);
+                // Reserved by add_generator(), so this never allocates.
+                scratch.resize(generator.count);
+                std::transform(wire.begin(), wire.end(), scratch.begin(), wire_order);
+                generator.function(elapsed, scratch);
+                std::transform(scratch.begin(), scratch.end(), wire.begin(), wire_order);
+                generator.last = elapsed;
+                generator.ran = true;
+                version.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        // Time until which no generator changes a register range.
+        std::chrono::nanoseconds stable_until(RegisterTable table, size_t address, size_t count) const
+        {
+            auto until = std::chrono::nanoseconds::max();
+            for (const Generator &generator : generators)
+            {
+                if (generator.table == table && generator.address < address + count &&
+                    generator.address + generator.count > address)
+                {
+                    until = std::min(until, generator.period == std::chrono::nanoseconds::zero()
+                                                ? std::chrono::nanoseconds::zero()
+                                                : generator.last + generator.period);
+                }
+            }
+            return until;
+        }
+
+        bool hooked(RegisterTable table, size_t address, size_t count, const WriteHook &hook) const
+        {
+            return hook.table == table && hook.address < address + count && hook.address + hook.count > address;
+        }
+
+        // Write PDUs (FC05/06/15/16) are checked before they are applied or
+        // handed to write handlers; the table sizes never change while running.
+        uint8_t check_write(const uint8_t *request, size_t length) const;
+        void apply_write(const uint8_t *request);
+        std::optional<WriteMode> write_mode(const uint8_t *request, size_t length) const;
+
+        // Serves a request PDU (the caller holds the mutex); returns the response PDU length.
+        size_t process(const uint8_t *request, size_t length, uint8_t *response, std::chrono::nanoseconds elapsed);
+    };
+
+    struct ModbusServer::Listener
+    {
+        uint16_t configured_port = 0;
+        uint16_t port = 0;
+        int socket = -1;
+        /// Device of every unit id (nullptr if none)
+        std::array<Device *, 256> units{};
+    };
+
+    ValueGenerator ramp_generator(uint16_t start, uint16_t step, std::chrono::nanoseconds step_period)
+    {
+        if (step_period <= std::chrono::nanoseconds::zero())
+        {
+            throw std::invalid_argument("Ramp step period must be positive");
+        }
+        return [start, step, step_period](std::chrono::nanoseconds elapsed, std::span<uint16_t> values)
+        {
+            const auto steps = static_cast<uint64_t>(elapsed / step_period);
+            std::fill(values.begin(), values.end(), static_cast<uint16_t>(start + steps * step));
+        };
+    }
+
+    ValueGenerator noise_generator(uint16_t center, uint16_t amplitude, uint32_t seed)
+    {
+        return [center, amplitude, random = std::minstd_rand(seed)](std::chrono::nanoseconds,
+                                                                    std::span<uint16_t> values) mutable
+        {
+            std::uniform_int_distribution<int> offset(-static_cast<int>(amplitude), static_cast<int>(amplitude));
+            for (uint16_t &value : values)
+            {
+                value = static_cast<uint16_t>(std::clamp(center + offset(random), 0, 0xFFFF));
+            }
+        };
+    }
+
+    ValueGenerator replay_generator(std::vector<std::vector<uint16_t>> frames, std::chrono::nanoseconds frame_period)
+    {
+        if (frames.empty() || frame_period <= std::chrono::nanoseconds::zero())
+        {
+            throw std::invalid_argument("Replay needs frames and a positive frame period");
+        }
+        return [frames = std::move(frames), frame_period](std::chrono::nanoseconds elapsed, std::span<uint16_t> values)
+        {
+            const std::vector<uint16_t> &frame = frames[static_cast<size_t>(elapsed / frame_period) % frames.size()];
+            std::copy_n(frame.begin(), std::min(frame.size(), values.size()), values.begin());
+        };
+    }
+
+#ifdef __linux__
+    namespace
+    {
+        uint16_t read_be16(const uint8_t *data)
+        {
+            return static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+
+        void write_be16(uint8_t *data, uint16_t value)
+        {
+            data[0] = static_cast<uint8_t>(value >> 8);
+            data[1] = static_cast<uint8_t>(value & 0xFF);
+        }
+
+        size_t exception_pdu(uint8_t function, uint8_t code, uint8_t *response)
+        {
+            response[0] = static_cast<uint8_t>(function | 0x80);
+            response[1] = code;
+            return 2;
+        }
+
+        constexpr uint8_t illegal_function = 0x01;
+        constexpr uint8_t illegal_data_address = 0x02;
+        constexpr uint8_t illegal_data_value = 0x03;
+        constexpr uint8_t server_device_failure = 0x04;
+        constexpr uint8_t server_device_busy = 0x06;
+        constexpr uint8_t gateway_target_failed = 0x0B;
+
+        constexpr size_t mbap_length = 7;
+        constexpr size_t max_adu_length = 260;
+        constexpr size_t max_rtu_length = 256;
+
+        bool is_write(uint8_t function)
+        {
+            return function == 0x05 || function == 0x06 || function == 0x0F || function == 0x10;
+        }
+
+        // Tags in the upper half of the epoll data word.
+        constexpr uint64_t tag_wake = 0;
+        constexpr uint64_t tag_timer = 1;
+        constexpr uint64_t tag_listener = 2;
+        constexpr uint64_t tag_client = 3;
+
+        uint64_t event_data(uint64_t tag, uint32_t value)
+        {
+            return (tag << 32) | value;
+        }
+
+        sockaddr_in make_address(uint32_t address, uint16_t port)
+        {
+            sockaddr_in result{};
+            result.sin_family = AF_INET;
+            result.sin_addr.s_addr = address;
+            result.sin_port = htons(port);
+            return result;
+        }
+
+        // Returns the listening socket or -1 with errno set.
+        int open_listening_socket(const sockaddr_in &address, int backlog, bool reuse_port)
+        {
+            const int socket = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (socket == -1)
+            {
+                return -1;
+            }
+            const int enable = 1;
+            if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1 ||
+                (reuse_port && setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == -1) ||
+                bind(socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == -1 ||
+                listen(socket, backlog) == -1)
+            {
+                const int error = errno;
+                close(socket);
+                errno = error;
+                return -1;
+            }
+            return socket;
+        }
+
+        // Pins the calling thread to the index-th CPU the process may run on.
+        void pin_to_cpu(size_t index)
+        {
+            cpu_set_t allowed;
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+            {
+                return;
+            }
+            index %= static_cast<size_t>(CPU_COUNT(&allowed));
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &allowed) && index-- == 0)
+                {
+                    cpu_set_t target;
+                    CPU_ZERO(&target);
+                    CPU_SET(cpu, &target);
+                    pthread_setaffinity_np(pthread_self(), sizeof(target), &target);
+                    return;
+                }
+            }
+        }
+    }
+
+    uint8_t ModbusServer::Device::check_write(const uint8_t *request, size_t length) const
+    {
+        const uint8_t function = request[0];
+        const uint16_t address = read_be16(request + 1);
+        const uint16_t count = read_be16(request + 3);
+        switch (function)
+        {
+        case 0x05:
+            if (count != 0xFF00 && count != 0x0000)
+            {
+                return illegal_data_value;
+            }
+            return address >= coils.size() ? illegal_data_address : 0;
+        case 0x06:
+            return address >= holding_registers.size() ? illegal_data_address : 0;
+        default:
+        {
+            const bool bits = function == 0x0F;
+            const size_t max_count = bits ? MODBUS_MAX_WRITE_BITS : MODBUS_MAX_WRITE_REGISTERS;
+            const size_t bytes = bits ? (count + 7u) / 8u : count * 2u;
+            if (count < 1 || count > max_count || length < 6 || request[5] != bytes || length < 6 + bytes)
+            {
+                return illegal_data_value;
+            }
+            return size_t{address} + count > (bits ? coils.size() : holding_registers.size()) ? illegal_data_address
+                                                                                                : 0;
+        }
+        }
+    }
+
+    void ModbusServer::Device::apply_write(const uint8_t *request)
+    {
+        const uint8_t function = request[0];
+        const uint16_t address = read_be16(request + 1);
+        const uint16_t count = read_be16(request + 3);
+        switch (function)
+        {
+        case 0x05:
+            coils[address] = count != 0 ? 1 : 0;
+            break;
+        case 0x06:
+            std::memcpy(holding_registers.data() + address, request + 3, 2);
+            break;
+        case 0x0F:
+            for (size_t i = 0; i < count; ++i)
+            {
+                coils[address + i] = (request[6 + i / 8] >> (i % 8)) & 1;
+            }
+            break;
+        default:
+            std::memcpy(holding_registers.data() + address, request + 6, count * 2u);
+            break;
+        }
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    size_t ModbusServer::Device::process(const uint8_t *request, size_t length, uint8_t *response,
+                                         std::chrono::nanoseconds elapsed)
+    {
+        const uint8_t function = request[0];
+        const bool supported = (function >= 0x01 && function <= 0x06) || function == 0x0F || function == 0x10;
+        if (!supported)
+        {
+            return exception_pdu(function, illegal_function, response);
+        }
+        if (length < 5)
+        {
+            return exception_pdu(function, illegal_data_value, response);
+        }
+        const uint16_t address = read_be16(request + 1);
+        const uint16_t count = read_be16(request + 3);
+
+        switch (function)
+        {
+        case 0x01:
+        case 0x02:
+        {
+            const std::vector<uint8_t> &bits = function == 0x01 ? coils : discrete_inputs;
+            if (count < 1 || count > MODBUS_MAX_READ_BITS)
+            {
+                return exception_pdu(function, illegal_data_value, response);
+            }
+            if (size_t{address} + count > bits.size())
+            {
+                return exception_pdu(function, illegal_data_address, response);
+            }
+            const size_t bytes = (count + 7u) / 8u;
+            response[0] = function;
+            response[1] = static_cast<uint8_t>(bytes);
+            std::memset(response + 2, 0, bytes);
+            for (size_t i = 0; i < count; ++i)
+            {
+                response[2 + i / 8] |= static_cast<uint8_t>((bits[address + i] != 0 ? 1u : 0u) << (i % 8));
+            }
+            return 2 + bytes;
+        }
+        case 0x03:
+        case 0x04:
+        {
+            const RegisterTable table =
+                function == 0x03 ? RegisterTable::holding_registers : RegisterTable::input_registers;
+            const std::vector<uint16_t> &registers = function == 0x03 ? holding_registers : input_registers;
+            if (count < 1 || count > MODBUS_MAX_READ_REGISTERS)
+            {
+                return exception_pdu(function, illegal_data_value, response);
+            }
+            if (size_t{address} + count > registers.size())
+            {
+                return exception_pdu(function, illegal_data_address, response);
+            }
+            generate(table, address, count, elapsed);
+            response[0] = function;
+            response[1] = static_cast<uint8_t>(count * 2);
+            std::memcpy(response + 2, registers.data() + address, count * 2u);
+            return 2 + count * 2u;
+        }
+        case 0x05:
+        case 0x06:
+        case 0x0F:
+        case 0x10:
+            if (const uint8_t code = check_write(request, length); code != 0)
+            {
+                return exception_pdu(function, code, response);
+            }
+            apply_write(request);
+            std::memcpy(response, request, 5);
+            return 5;
+        default:
+            return exception_pdu(function, illegal_function, response);
+        }
+    }
+
+    std::optional<WriteMode> ModbusServer::Device::write_mode(const uint8_t *request, size_t length) const
+    {
+        const uint8_t function = request[0];
+        if (write_hooks.empty() || length < 5 || !is_write(function) || check_write(request, length) != 0)
+        {
+            return std::nullopt;
+        }
+        const RegisterTable table =
+            function == 0x05 || function == 0x0F ? RegisterTable::coils : RegisterTable::holding_registers;
+        const size_t address = read_be16(request + 1);
+        const size_t count = function == 0x05 || function == 0x06 ? 1 : read_be16(request + 3);
+        std::optional<WriteMode> mode;
+        for (const WriteHook &hook : write_hooks)
+        {
+            if (hooked(table, address, count, hook) && mode != WriteMode::synchronous)
+            {
+                mode = hook.mode;
+            }
+        }
+        return mode;
+    }
+
+    /**
+     * @brief Write worker threads running the write handlers of all devices
+     *
+     * Event loops queue jobs in a lock-free queue and post a semaphore;
+     * synchronous jobs carry their loop and return to it with the response.
+     */
+    struct ModbusServer::WritePool
+    {
+        struct Job
+        {
+            Device *device = nullptr;
+            EventLoop *loop = nullptr; ///< Loop awaiting the response (nullptr: fire-and-forget)
+            int socket = -1;
+            uint64_t connection = 0;
+            std::chrono::nanoseconds delay{0};
+            uint16_t length = 0;
+            std::array<uint8_t, max_adu_length> frame; ///< Request ADU, replaced by the response
+        };
+
+        WritePool(size_t workers, size_t capacity)
+            : jobs(capacity)
+        {
+            for (size_t i = 0; i < workers; ++i)
+            {
+                threads.emplace_back([this](std::stop_token stop)
+                                     { run(stop); });
+            }
+        }
+
+        ~WritePool()
+        {
+            stop();
+        }
+
+        void stop()
+        {
+            // Queued jobs are still run; every worker leaves on an empty queue.
+            for (std::jthread &thread : threads)
+            {
+                thread.request_stop();
+            }
+            available.release(static_cast<std::ptrdiff_t>(threads.size()));
+            threads.clear();
+        }
+
+        bool submit(const Job &job)
+        {
+            if (!jobs.try_push(job))
+            {
+                return false;
+            }
+            available.release();
+            return true;
+        }
+
+        void run(std::stop_token stop);
+        void execute(Job &job, std::vector<uint16_t> &values);
+        // Runs the handlers overlapping a write; returns 0 or the exception
+        // code of the first rejecting handler of a synchronous write.
+        uint8_t run_handlers(Device &device, const uint8_t *pdu, bool synchronous, std::vector<uint16_t> &values);
+
+        void add_stats(ServerStats &stats) const
+        {
+            stats.write_handler_runs += runs.load(std::memory_order_relaxed);
+            stats.write_rejections += rejections.load(std::memory_order_relaxed);
+        }
+
+        BoundedQueue<Job> jobs;
+        std::counting_semaphore<> available{0};
+        std::atomic<uint64_t> runs{0};
+        std::atomic<uint64_t> rejections{0};
+        std::vector<std::jthread> threads;
+    };
+
+    /**
+     * @brief One event-loop thread serving client connections
+     *
+     * Every loop watches all listening sockets (EPOLLEXCLUSIVE, so one loop
+     * is woken per connection attempt), or with reuse_port its own
+     * SO_REUSEPORT sockets, and owns the connections it accepts.
+     * Received bytes are only buffered; after every epoll batch the ready
+     * connections are served round-robin. Delayed responses and connections
+     * waiting for tokens wait in deadline heaps behind one timerfd.
+     */
+    class ModbusServer::EventLoop
+    {
+    public:
+        EventLoop(ModbusServer &server, size_t index)
+            : server_(server), index_(index), random_(static_cast<unsigned>(index) + 1),
+              cache_(server.config_.response_cache_entries), completions_(server.config_.write_queue_capacity)
+        {
+        }
+
+        ~EventLoop()
+        {
+            stop();
+            for (const auto &[socket, connection] : connections_)
+            {
+                close(socket);
+            }
+            // Only the extra SO_REUSEPORT sockets belong to the loop; loop 0 and,
+            // without reuse_port, every loop watch the server's own sockets.
+            const bool owns_sockets = server_.config_.reuse_port && index_ != 0;
+            for (size_t i = 0; owns_sockets && i < listening_sockets_.size(); ++i)
+            {
+                close(listening_sockets_[i]);
+            }
+            for (int fd : {epoll_, wake_, timer_})
+            {
+                if (fd != -1)
+                {
+                    close(fd);
+                }
+            }
+        }
+
+        bool open(std::string &error)
+        {
+            epoll_ = epoll_create1(EPOLL_CLOEXEC);
+            wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            timer_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (epoll_ == -1 || wake_ == -1 || timer_ == -1 || !watch(wake_, EPOLLIN, event_data(tag_wake, 0)) ||
+                !watch(timer_, EPOLLIN, event_data(tag_timer, 0)))
+            {
+                error = std::string("Failed to create event loop: ") + modbus_strerror(errno);
+                return false;
+            }
+            const bool reuse_port = server_.config_.reuse_port;
+            for (size_t i = 0; i < server_.listeners_.size(); ++i)
+            {
+                const Listener &listener = *server_.listeners_[i];
+                int socket = listener.socket;
+                if (reuse_port && index_ != 0)
+                {
+                    socket = open_listening_socket(make_address(server_.bind_address_, listener.port),
+                                                   server_.config_.backlog, true);
+                    if (socket == -1)
+                    {
+                        error = "Failed to listen on port " + std::to_string(listener.port) + ": " +
+                                modbus_strerror(errno);
+                        return false;
+                    }
+                }
+                listening_sockets_.push_back(socket);
+                if (!watch(socket, reuse_port ? EPOLLIN : EPOLLIN | EPOLLEXCLUSIVE,
+                           event_data(tag_listener, static_cast<uint32_t>(i))))
+                {
+                    error = std::string("Failed to watch listening socket: ") + modbus_strerror(errno);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void start()
+        {
+            thread_ = std::jthread([this](std::stop_token stop)
+                                   { run(stop); });
+        }
+
+        void stop()
+        {
+            if (thread_.joinable())
+            {
+                thread_.request_stop();
+                const uint64_t one = 1;
+                [[maybe_unused]] const ssize_t written = write(wake_, &one, sizeof(one));
+                thread_.join();
+            }
+        }
+
+        void add_stats(ServerStats &stats) const
+        {
+            stats.connections += connections_accepted_.load(std::memory_order_relaxed);
+            stats.requests += requests_.load(std::memory_order_relaxed);
+            stats.exceptions += exceptions_.load(std::memory_order_relaxed);
+            stats.dropped += dropped_.load(std::memory_order_relaxed);
+            stats.protocol_errors += protocol_errors_.load(std::memory_order_relaxed);
+            stats.cache_hits += cache_hits_.load(std::memory_order_relaxed);
+            stats.cache_misses += cache_misses_.load(std::memory_order_relaxed);
+            stats.throttled += throttled_.load(std::memory_order_relaxed);
+            stats.in_flight_limited += in_flight_limited_.load(std::memory_order_relaxed);
+            stats.held_clients += held_clients_.load(std::memory_order_relaxed);
+            stats.write_queue_full += write_queue_full_.load(std::memory_order_relaxed);
+        }
+
+        // Called by a write worker with the response to a synchronous write.
+        void complete(const WritePool::Job &job)
+        {
+            // Never full: a loop has at most write_queue_capacity writes outstanding.
+            while (!completions_.try_push(job))
+            {
+                std::this_thread::yield();
+            }
+            if (!wake_pending_.exchange(true))
+            {
+                const uint64_t one = 1;
+                [[maybe_unused]] const ssize_t written = write(wake_, &one, sizeof(one));
+            }
+        }
+
+        void add_client_stats(std::vector<ClientStats> &clients) const
+        {
+            std::lock_guard lock(connections_mutex_);
+            for (const auto &[socket, connection] : connections_)
+            {
+                ClientStats client;
+                client.peer = connection->peer;
+                client.port = connection->listener->port;
+                client.requests = connection->requests.load(std::memory_order_relaxed);
+                client.throttled = connection->throttled.load(std::memory_order_relaxed);
+                client.in_flight_limited = connection->in_flight_limited.load(std::memory_order_relaxed);
+                client.in_flight = connection->in_flight.load(std::memory_order_relaxed);
+                client.held = connection->held.load(std::memory_order_relaxed);
+                clients.push_back(std::move(client));
+            }
+        }
+
+    private:
+        struct Connection
+        {
+            int socket = -1;
+            uint64_t id = 0;
+            Listener *listener = nullptr;
+            std::string peer;
+            std::array<uint8_t, 16 * max_adu_length> input;
+            size_t input_begin = 0; ///< First byte not yet served
+            size_t input_size = 0;
+            std::vector<uint8_t> output;
+            size_t output_offset = 0;
+            uint32_t events = EPOLLIN; ///< Current epoll interest
+            bool writing = false;
+            bool ready = false;  ///< Queued for dispatch
+            bool dirty = false;  ///< Served in the current dispatch
+            bool awaiting_write = false; ///< A synchronous write is with the write workers
+            bool failed = false; ///< Sent a malformed frame; closed after dispatch
+            double tokens = 0.0;
+            std::chrono::steady_clock::time_point refilled;
+            std::chrono::steady_clock::time_point resume; ///< Scheduled token wake-up (epoch: none)
+            // Read by client_stats() from other threads.
+            std::atomic<uint64_t> requests{0};
+            std::atomic<uint64_t> throttled{0};
+            std::atomic<uint64_t> in_flight_limited{0};
+            std::atomic<size_t> in_flight{0};
+            std::atomic<bool> held{false};
+        };
+
+        struct Resume
+        {
+            std::chrono::steady_clock::time_point due;
+            uint64_t connection;
+            int socket;
+
+            bool operator>(const Resume &other) const { return due > other.due; }
+        };
+
+        struct CacheEntry
+        {
+            const Device *device = nullptr;
+            std::array<uint8_t, 5> request{}; ///< Function code, address and count
+            uint64_t version = 0;
+            std::chrono::nanoseconds stable_until{0};
+            uint16_t length = 0;
+            std::array<uint8_t, max_adu_length - mbap_length> response;
+        };
+
+        struct Pending
+        {
+            std::chrono::steady_clock::time_point due;
+            uint64_t connection;
+            int socket;
+            uint16_t length;
+            std::array<uint8_t, max_adu_length> frame;
+
+            bool operator>(const Pending &other) const { return due > other.due; }
+        };
+
+        bool watch(int fd, uint32_t events, uint64_t data)
+        {
+            epoll_event event{};
+            event.events = events;
+            event.data.u64 = data;
+            return epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) == 0;
+        }
+
+        void run(std::stop_token stop)
+        {
+            if (server_.config_.pin_threads)
+            {
+                pin_to_cpu(index_);
+            }
+
+            std::array<epoll_event, 64> events;
+            while (!stop.stop_requested())
+            {
+                const int count = epoll_wait(epoll_, events.data(), static_cast<int>(events.size()), -1);
+                for (int i = 0; i < count; ++i)
+                {
+                    const uint64_t tag = events[i].data.u64 >> 32;
+                    const auto value = static_cast<uint32_t>(events[i].data.u64);
+                    if (tag == tag_wake)
+                    {
+                        uint64_t wakes = 0;
+                        [[maybe_unused]] const ssize_t bytes = read(wake_, &wakes, sizeof(wakes));
+                        wake_pending_.store(false);
+                        complete_writes();
+                    }
+                    else if (tag == tag_listener)
+                    {
+                        accept_clients(*server_.listeners_[value], listening_sockets_[value]);
+                    }
+                    else if (tag == tag_timer)
+                    {
+                        uint64_t expirations = 0;
+                        [[maybe_unused]] const ssize_t bytes = read(timer_, &expirations, sizeof(expirations));
+                        expire_timers();
+                    }
+                    else if (tag == tag_client)
+                    {
+                        const auto found = connections_.find(static_cast<int>(value));
+                        if (found == connections_.end())
+                        {
+                            continue;
+                        }
+                        Connection &connection = *found->second;
+                        if ((events[i].events & EPOLLOUT) != 0 && !flush(connection))
+                        {
+                            continue;
+                        }
+                        if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+                        {
+                            receive(connection);
+                        }
+                    }
+                }
+                dispatch();
+            }
+        }
+
+        Connection *find_connection(int socket, uint64_t id)
+        {
+            // The connection may have been closed (and the socket reused) meanwhile.
+            const auto found = connections_.find(socket);
+            return found != connections_.end() && found->second->id == id ? found->second.get() : nullptr;
+        }
+
+        void accept_clients(Listener &listener, int listening_socket)
+        {
+            while (true)
+            {
+                sockaddr_in address{};
+                socklen_t address_length = sizeof(address);
+                const int socket = accept4(listening_socket, reinterpret_cast<sockaddr *>(&address), &address_length,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (socket == -1)
+                {
+                    // EAGAIN: another loop took the connection.
+                    return;
+                }
+                const int enable = 1;
+                setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+                if (!watch(socket, EPOLLIN, event_data(tag_client, static_cast<uint32_t>(socket))))
+                {
+                    close(socket);
+                    continue;
+                }
+
+                auto connection = std::make_unique<Connection>();
+                connection->socket = socket;
+                connection->id = ++next_connection_id_;
+                connection->listener = &listener;
+                char peer[INET_ADDRSTRLEN] = "";
+                inet_ntop(AF_INET, &address.sin_addr, peer, sizeof(peer));
+                connection->peer = std::string(peer) + ":" + std::to_string(ntohs(address.sin_port));
+                connection->tokens = static_cast<double>(server_.config_.client_burst);
+                connection->refilled = std::chrono::steady_clock::now();
+                std::lock_guard lock(connections_mutex_);
+                connections_[socket] = std::move(connection);
+                connections_accepted_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void close_connection(Connection &connection)
+        {
+            const int socket = connection.socket;
+            if (connection.held.load(std::memory_order_relaxed))
+            {
+                held_clients_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            close(socket);
+            std::lock_guard lock(connections_mutex_);
+            connections_.erase(socket);
+        }
+
+        void receive(Connection &connection)
+        {
+            if (connection.input_begin != 0)
+            {
+                std::memmove(connection.input.data(), connection.input.data() + connection.input_begin,
+                             connection.input_size - connection.input_begin);
+                connection.input_size -= connection.input_begin;
+                connection.input_begin = 0;
+            }
+            // With a full buffer only a hangup or error gets here, and recv() returns 0.
+            const ssize_t received = recv(connection.socket, connection.input.data() + connection.input_size,
+                                          connection.input.size() - connection.input_size, 0);
+            if (received <= 0)
+            {
+                if (received == 0 || (errno != EAGAIN && errno != EINTR))
+                {
+                    close_connection(connection);
+                }
+                return;
+            }
+            connection.input_size += static_cast<size_t>(received);
+            make_ready(connection);
+            update_events(connection);
+        }
+
+        void make_ready(Connection &connection)
+        {
+            if (!connection.ready)
+            {
+                connection.ready = true;
+                ready_.emplace_back(connection.socket, connection.id);
+            }
+        }
+
+        // Serves the ready connections round-robin, dispatch_quantum requests
+        // per turn, then sends the responses of every served connection.
+        void dispatch()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            while (!ready_.empty())
+            {
+                const auto [socket, id] = ready_.front();
+                ready_.pop_front();
+                Connection *connection = find_connection(socket, id);
+                if (!connection)
+                {
+                    continue;
+                }
+                connection->ready = false;
+                if (serve(*connection, now))
+                {
+                    make_ready(*connection);
+                }
+                if (!connection->dirty)
+                {
+                    connection->dirty = true;
+                    served_.push_back(connection);
+                }
+            }
+
+            // Responses of all requests served in this round leave in one send.
+            for (Connection *connection : served_)
+            {
+                connection->dirty = false;
+                if (connection->failed)
+                {
+                    close_connection(*connection);
+                }
+                else
+                {
+                    flush(*connection);
+                }
+            }
+            served_.clear();
+        }
+
+        // Returns true if the connection has another request it may be served right away.
+        bool serve(Connection &connection, std::chrono::steady_clock::time_point now)
+        {
+            for (size_t served = 0;; ++served)
+            {
+                const size_t available = connection.input_size - connection.input_begin;
+                if (available < mbap_length || connection.writing || connection.awaiting_write)
+                {
+                    // The rest follows with the next read, once the output
+                    // drained or once the pending write completed.
+                    return false;
+                }
+                const uint8_t *frame = connection.input.data() + connection.input_begin;
+                const uint16_t length = read_be16(frame + 4);
+                if (read_be16(frame + 2) != 0 || length < 2 || length > max_adu_length - 6)
+                {
+                    protocol_errors_.fetch_add(1, std::memory_order_relaxed);
+                    connection.failed = true;
+                    return false;
+                }
+                if (available < 6u + length)
+                {
+                    return false;
+                }
+                if (served == server_.config_.dispatch_quantum)
+                {
+                    return true;
+                }
+                if (!admit(connection, now))
+                {
+                    return false;
+                }
+                handle_request(connection, frame, 6u + length);
+                connection.input_begin += 6u + length;
+            }
+        }
+
+        // Takes a token and checks the in-flight limit; otherwise holds the
+        // connection back until a delayed response is sent or a token is due.
+        bool admit(Connection &connection, std::chrono::steady_clock::time_point now)
+        {
+            const ServerConfig &config = server_.config_;
+            if (config.max_in_flight != 0 &&
+                connection.in_flight.load(std::memory_order_relaxed) >= config.max_in_flight)
+            {
+                hold(connection, connection.in_flight_limited, in_flight_limited_);
+                return false;
+            }
+            if (config.client_request_rate > 0.0)
+            {
+                const double elapsed = std::chrono::duration<double>(now - connection.refilled).count();
+                connection.tokens = std::min(static_cast<double>(config.client_burst),
+                                             connection.tokens + elapsed * config.client_request_rate);
+                connection.refilled = now;
+                if (connection.tokens < 1.0)
+                {
+                    hold(connection, connection.throttled, throttled_);
+                    if (connection.resume == std::chrono::steady_clock::time_point{})
+                    {
+                        const std::chrono::duration<double> wait((1.0 - connection.tokens) / config.client_request_rate);
+                        connection.resume = now + std::chrono::ceil<std::chrono::nanoseconds>(wait);
+                        resumes_.push({connection.resume, connection.id, connection.socket});
+                        if (resumes_.top().due == connection.resume)
+                        {
+                            arm_timer();
+                        }
+                    }
+                    return false;
+                }
+                connection.tokens -= 1.0;
+            }
+            if (connection.held.load(std::memory_order_relaxed))
+            {
+                connection.held.store(false, std::memory_order_relaxed);
+                held_clients_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        // Counts a held-back request once, however often it is retried.
+        void hold(Connection &connection, std::atomic<uint64_t> &client_counter, std::atomic<uint64_t> &loop_counter)
+        {
+            if (!connection.held.load(std::memory_order_relaxed))
+            {
+                connection.held.store(true, std::memory_order_relaxed);
+                held_clients_.fetch_add(1, std::memory_order_relaxed);
+                client_counter.fetch_add(1, std::memory_order_relaxed);
+                loop_counter.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Reads while the buffer has room for another frame; writes while output is pending.
+        void update_events(Connection &connection)
+        {
+            const size_t buffered = connection.input_size - connection.input_begin;
+            const uint32_t events = (connection.input.size() - buffered >= max_adu_length ? EPOLLIN : 0u) |
+                                    (connection.writing ? EPOLLOUT : 0u);
+            if (events != connection.events)
+            {
+                epoll_event event{};
+                event.events = events;
+                event.data.u64 = event_data(tag_client, static_cast<uint32_t>(connection.socket));
+                epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.socket, &event);
+                connection.events = events;
+            }
+        }
+
+        void handle_request(Connection &connection, const uint8_t *request, size_t length)
+        {
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            connection.requests.fetch_add(1, std::memory_order_relaxed);
+
+            Pending response;
+            std::memcpy(response.frame.data(), request, mbap_length);
+            uint8_t *pdu = response.frame.data() + mbap_length;
+            const uint8_t unit = request[6];
+            Device *device = connection.listener->units[unit];
+
+            size_t pdu_length = 0;
+            std::chrono::nanoseconds delay{0};
+            if (!device)
+            {
+                pdu_length = exception_pdu(request[7], gateway_target_failed, pdu);
+            }
+            else
+            {
+                const LatencyProfile &latency = device->config.latency;
+                if (latency.drop > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < latency.drop)
+                {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                delay = latency.base;
+                if (latency.jitter > std::chrono::microseconds::zero())
+                {
+                    delay += std::chrono::microseconds(
+                        std::uniform_int_distribution<int64_t>(0, latency.jitter.count())(random_));
+                }
+                const std::optional<WriteMode> mode = device->write_mode(request + mbap_length, length - mbap_length);
+                if (mode == WriteMode::synchronous)
+                {
+                    if (submit_write(connection, *device, request, length, delay, *mode))
+                    {
+                        // Answered by complete_writes().
+                        return;
+                    }
+                    write_queue_full_.fetch_add(1, std::memory_order_relaxed);
+                    pdu_length = exception_pdu(request[7], server_device_busy, pdu);
+                }
+                else
+                {
+                    // Stored before the handlers are queued, so they read the values they are told about.
+                    pdu_length = build_response(*device, request + mbap_length, length - mbap_length, pdu);
+                    if (mode && !submit_write(connection, *device, request, length, delay, *mode))
+                    {
+                        write_queue_full_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+            send_response(connection, response, pdu_length, delay);
+        }
+
+        void send_response(Connection &connection, Pending &response, size_t pdu_length,
+                           std::chrono::nanoseconds delay)
+        {
+            if ((response.frame[mbap_length] & 0x80) != 0)
+            {
+                exceptions_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            write_be16(response.frame.data() + 4, static_cast<uint16_t>(1 + pdu_length));
+            response.length = static_cast<uint16_t>(mbap_length + pdu_length);
+            if (delay <= std::chrono::nanoseconds::zero())
+            {
+                connection.output.insert(connection.output.end(), response.frame.begin(),
+                                         response.frame.begin() + response.length);
+                return;
+            }
+
+            response.due = std::chrono::steady_clock::now() + delay;
+            response.connection = connection.id;
+            response.socket = connection.socket;
+            connection.in_flight.fetch_add(1, std::memory_order_relaxed);
+            pending_.push(response);
+            if (pending_.top().due == response.due)
+            {
+                arm_timer();
+            }
+        }
+
+        // Queues a write for the write handlers; a fire-and-forget write has
+        // already been stored by the caller, which answers it right away.
+        bool submit_write(Connection &connection, Device &device, const uint8_t *request, size_t length,
+                          std::chrono::nanoseconds delay, WriteMode mode)
+        {
+            const bool synchronous = mode == WriteMode::synchronous;
+            if (synchronous && outstanding_writes_ >= completions_.capacity())
+            {
+                return false;
+            }
+            WritePool::Job job;
+            job.device = &device;
+            job.loop = synchronous ? this : nullptr;
+            job.socket = connection.socket;
+            job.connection = connection.id;
+            job.delay = delay;
+            job.length = static_cast<uint16_t>(length);
+            std::memcpy(job.frame.data(), request, length);
+            if (!server_.write_pool_->submit(job))
+            {
+                return false;
+            }
+            if (synchronous)
+            {
+                ++outstanding_writes_;
+                connection.awaiting_write = true;
+            }
+            return true;
+        }
+
+        void complete_writes()
+        {
+            WritePool::Job job;
+            while (completions_.try_pop(job))
+            {
+                --outstanding_writes_;
+                Connection *connection = find_connection(job.socket, job.connection);
+                if (!connection)
+                {
+                    continue;
+                }
+                connection->awaiting_write = false;
+                Pending response;
+                std::memcpy(response.frame.data(), job.frame.data(), job.length);
+                send_response(*connection, response, job.length - mbap_length, job.delay);
+                // Sends the response and serves the requests that waited for it.
+                make_ready(*connection);
+            }
+        }
+
+        // Serves reads from the response cache while the device has not
+        // changed since the cached PDU was built; builds it otherwise.
+        size_t build_response(Device &device, const uint8_t *request, size_t length, uint8_t *response)
+        {
+            const uint8_t function = request[0];
+            CacheEntry *entry = nullptr;
+            if (!cache_.empty() && function >= 0x01 && function <= 0x04 && length == 5)
+            {
+                entry = &cache_[cache_index(device, request)];
+                if (entry->device == &device && std::memcmp(entry->request.data(), request, 5) == 0 &&
+                    entry->version == device.version.load(std::memory_order_acquire) &&
+                    std::chrono::steady_clock::now() - server_.started_ < entry->stable_until)
+                {
+                    std::memcpy(response, entry->response.data(), entry->length);
+                    cache_hits_.fetch_add(1, std::memory_order_relaxed);
+                    return entry->length;
+                }
+            }
+
+            std::lock_guard lock(device.mutex);
+            const size_t pdu_length =
+                device.process(request, length, response, std::chrono::steady_clock::now() - server_.started_);
+            if (entry && (response[0] & 0x80) == 0)
+            {
+                cache_misses_.fetch_add(1, std::memory_order_relaxed);
+                entry->device = &device;
+                std::memcpy(entry->request.data(), request, 5);
+                entry->version = device.version.load(std::memory_order_relaxed);
+                entry->stable_until =
+                    function == 0x03 || function == 0x04
+                        ? device.stable_until(function == 0x03 ? RegisterTable::holding_registers
+                                                               : RegisterTable::input_registers,
+                                              read_be16(request + 1), read_be16(request + 3))
+                        : std::chrono::nanoseconds::max();
+                entry->length = static_cast<uint16_t>(pdu_length);
+                std::memcpy(entry->response.data(), response, pdu_length);
+            }
+            return pdu_length;
+        }
+
+        size_t cache_index(const Device &device, const uint8_t *request) const
+        {
+            uint64_t key = reinterpret_cast<uintptr_t>(&device);
+            key ^= ((uint64_t{request[0]} << 32) | (uint64_t{read_be16(request + 1)} << 16) | read_be16(request + 3)) *
+                   0x9E3779B97F4A7C15ull;
+            key ^= key >> 29;
+            key *= 0xBF58476D1CE4E5B9ull;
+            key ^= key >> 32;
+            return static_cast<size_t>(key % cache_.size());
+        }
+
+        // Sends buffered output; returns false if the connection was closed.
+        bool flush(Connection &connection)
+        {
+            while (connection.output_offset < connection.output.size())
+            {
+                const ssize_t sent = send(connection.socket, connection.output.data() + connection.output_offset,
+                                          connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+                if (sent == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno != EAGAIN)
+                    {
+                        close_connection(connection);
+                        return false;
+                    }
+                    break;
+                }
+                connection.output_offset += static_cast<size_t>(sent);
+            }
+
+            const bool writing = connection.output_offset < connection.output.size();
+            if (!writing)
+            {
+                connection.output.clear();
+                connection.output_offset = 0;
+                if (connection.writing)
+                {
+                    // Requests left while the client was not reading are served again.
+                    make_ready(connection);
+                }
+            }
+            connection.writing = writing;
+            update_events(connection);
+            return true;
+        }
+
+        // Sends the delayed responses that are due and resumes the
+        // connections whose next token is due.
+        void expire_timers()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            std::vector<Connection *> touched;
+            while (!pending_.empty() && pending_.top().due <= now)
+            {
+                const Pending &response = pending_.top();
+                if (Connection *connection = find_connection(response.socket, response.connection))
+                {
+                    connection->output.insert(connection->output.end(), response.frame.begin(),
+                                              response.frame.begin() + response.length);
+                    connection->in_flight.fetch_sub(1, std::memory_order_relaxed);
+                    if (std::find(touched.begin(), touched.end(), connection) == touched.end())
+                    {
+                        touched.push_back(connection);
+                    }
+                }
+                pending_.pop();
+            }
+            for (Connection *connection : touched)
+            {
+                if (flush(*connection))
+                {
+                    // It may have been held back by the in-flight limit.
+                    make_ready(*connection);
+                }
+            }
+            while (!resumes_.empty() && resumes_.top().due <= now)
+            {
+                if (Connection *connection = find_connection(resumes_.top().socket, resumes_.top().connection))
+                {
+                    connection->resume = {};
+                    make_ready(*connection);
+                }
+                resumes_.pop();
+            }
+            arm_timer();
+        }
+
+        void arm_timer()
+        {
+            itimerspec spec{};
+            if (!pending_.empty() || !resumes_.empty())
+            {
+                auto next = std::chrono::steady_clock::time_point::max();
+                if (!pending_.empty())
+                {
+                    next = pending_.top().due;
+                }
+                if (!resumes_.empty())
+                {
+                    next = std::min(next, resumes_.top().due);
+                }
+                const auto due = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch());
+                // A zero it_value would disarm the timer.
+                const int64_t nanoseconds = std::max<int64_t>(due.count(), 1);
+                spec.it_value.tv_sec = static_cast<time_t>(nanoseconds / 1000000000);
+                spec.it_value.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+            }
+            timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+        }
+
+        ModbusServer &server_;
+        const size_t index_;
+        std::minstd_rand random_;
+        std::vector<int> listening_sockets_;
+        std::vector<CacheEntry> cache_;
+        BoundedQueue<WritePool::Job> completions_; ///< Responses to synchronous writes
+        std::atomic<bool> wake_pending_{false};    ///< A worker has written to wake_
+        size_t outstanding_writes_ = 0;
+        int epoll_ = -1;
+        int wake_ = -1;
+        int timer_ = -1;
+        std::jthread thread_;
+        /// Guards connections_ against client_stats(); only the loop modifies it.
+        mutable std::mutex connections_mutex_;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+        std::deque<std::pair<int, uint64_t>> ready_; ///< Socket and id of connections to serve
+        std::vector<Connection *> served_;
+        std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending_;
+        std::priority_queue<Resume, std::vector<Resume>, std::greater<>> resumes_;
+        uint64_t next_connection_id_ = 0;
+        std::atomic<uint64_t> connections_accepted_{0};
+        std::atomic<uint64_t> requests_{0};
+        std::atomic<uint64_t> exceptions_{0};
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<uint64_t> protocol_errors_{0};
+        std::atomic<uint64_t> cache_hits_{0};
+        std::atomic<uint64_t> cache_misses_{0};
+        std::atomic<uint64_t> throttled_{0};
+        std::atomic<uint64_t> in_flight_limited_{0};
+        std::atomic<uint64_t> held_clients_{0};
+        std::atomic<uint64_t> write_queue_full_{0};
+    };
+
+    void ModbusServer::WritePool::run(std::stop_token stop)
+    {
+        std::vector<uint16_t> values;
+        values.reserve(MODBUS_MAX_WRITE_BITS);
+        Job job;
+        while (true)
+        {
+            available.acquire();
+            // A release means a job was queued, but its producer may still
+            // be writing an earlier cell of the queue.
+            while (!jobs.try_pop(job))
+            {
+                if (stop.stop_requested())
+                {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            execute(job, values);
+        }
+    }
+
+    void ModbusServer::WritePool::execute(Job &job, std::vector<uint16_t> &values)
+    {
+        Device &device = *job.device;
+        uint8_t *pdu = job.frame.data() + mbap_length;
+        const uint8_t code = run_handlers(device, pdu, job.loop != nullptr, values);
+        if (!job.loop)
+        {
+            return;
+        }
+
+        // The response to a write echoes the first five bytes of its PDU.
+        size_t pdu_length = 5;
+        if (code == 0)
+        {
+            std::lock_guard lock(device.mutex);
+            device.apply_write(pdu);
+        }
+        else
+        {
+            pdu_length = exception_pdu(pdu[0], code, pdu);
+        }
+        write_be16(job.frame.data() + 4, static_cast<uint16_t>(1 + pdu_length));
+        job.length = static_cast<uint16_t>(mbap_length + pdu_length);
+        job.loop->complete(job);
+    }
+
+    uint8_t ModbusServer::WritePool::run_handlers(Device &device, const uint8_t *pdu, bool synchronous,
+                                                  std::vector<uint16_t> &values)
+    {
+        const uint8_t function = pdu[0];
+        const uint16_t address = read_be16(pdu + 1);
+        const bool bits = function == 0x05 || function == 0x0F;
+        values.clear();
+        if (function == 0x05 || function == 0x06)
+        {
+            values.push_back(bits ? bit_value(read_be16(pdu + 3)) : read_be16(pdu + 3));
+        }
+        else
+        {
+            const uint16_t count = read_be16(pdu + 3);
+            for (size_t i = 0; i < count; ++i)
+            {
+                values.push_back(bits ? static_cast<uint16_t>((pdu[6 + i / 8] >> (i % 8)) & 1)
+                                      : read_be16(pdu + 6 + 2 * i));
+            }
+        }
+
+        WriteRequest request;
+        request.device = device.index;
+        request.table = bits ? RegisterTable::coils : RegisterTable::holding_registers;
+        request.address = address;
+        request.values = values;
+        uint8_t code = 0;
+        for (const Device::WriteHook &hook : device.write_hooks)
+        {
+            if (!device.hooked(request.table, address, values.size(), hook))
+            {
+                continue;
+            }
+            runs.fetch_add(1, std::memory_order_relaxed);
+            try
+            {
+                code = hook.function(request);
+            }
+            catch (...)
+            {
+                code = server_device_failure;
+            }
+            if (code != 0)
+            {
+                rejections.fetch_add(1, std::memory_order_relaxed);
+                if (synchronous)
+                {
+                    break;
+                }
+                code = 0;
+            }
+        }
+        return code;
+    }
+
+    /**
+     * @brief RTU slave on one serial line
+     *
+     * A dedicated thread runs the receive state machine of the Modbus serial
+     * line specification: characters closer than t1.5 form a frame; the frame
+     * is checked and answered while the line has to stay silent until t3.5,
+     * and a character in between invalidates it. Gaps are timed with ppoll()
+     * at nanosecond resolution instead of libmodbus's modbus_receive() loop,
+     * so the response leaves right after t3.5.
+     */
+    class ModbusServer::SerialBus
+    {
+    public:
+        SerialBus(ModbusServer &server, const SerialConfig &config)
+            : server_(server), config_(config), timing_(rtu_timing(config))
+        {
+        }
+
+        ~SerialBus()
+        {
+            close_port();
+        }
+
+        bool open(std::string &error)
+        {
+            fd_ = open_serial_port(config_, error);
+            if (fd_ == -1)
+            {
+                return false;
+            }
+            wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (wake_ == -1)
+            {
+                error = "Failed to create event for " + config_.device + ": " + modbus_strerror(errno);
+                close_port();
+                return false;
+            }
+            return true;
+        }
+
+        void start()
+        {
+            thread_ = std::jthread([this](std::stop_token stop)
+                                   { run(stop); });
+        }
+
+        void close_port()
+        {
+            if (thread_.joinable())
+            {
+                thread_.request_stop();
+                const uint64_t one = 1;
+                [[maybe_unused]] const ssize_t written = write(wake_, &one, sizeof(one));
+                thread_.join();
+            }
+            for (int *fd : {&fd_, &wake_})
+            {
+                if (*fd != -1)
+                {
+                    close(*fd);
+                    *fd = -1;
+                }
+            }
+        }
+
+        void add_stats(ServerStats &stats) const
+        {
+            stats.requests += requests_.load(std::memory_order_relaxed);
+            stats.exceptions += exceptions_.load(std::memory_order_relaxed);
+            stats.dropped += dropped_.load(std::memory_order_relaxed);
+            stats.write_queue_full += write_queue_full_.load(std::memory_order_relaxed);
+            stats.serial_frames += frames_.load(std::memory_order_relaxed);
+            stats.serial_crc_errors += crc_errors_.load(std::memory_order_relaxed);
+            stats.serial_framing_errors += framing_errors_.load(std::memory_order_relaxed);
+        }
+
+        std::array<Device *, 256> units{}; ///< Device of every unit id (nullptr if none)
+
+    private:
+        using Frame = std::array<uint8_t, max_rtu_length>;
+
+        enum class Wait
+        {
+            character,
+            silence,
+            stopped
+        };
+
+        // Waits for a character until the deadline (none: indefinitely).
+        Wait wait(std::optional<std::chrono::steady_clock::time_point> deadline)
+        {
+            while (true)
+            {
+                pollfd descriptors[2] = {{fd_, POLLIN, 0}, {wake_, POLLIN, 0}};
+                timespec timeout{};
+                if (deadline)
+                {
+                    const auto remaining = std::max(std::chrono::nanoseconds::zero(),
+                                                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                        *deadline - std::chrono::steady_clock::now()));
+                    timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+                    timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+                }
+                const int ready = ppoll(descriptors, 2, deadline ? &timeout : nullptr, nullptr);
+                if (ready == -1 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (ready > 0 && descriptors[1].revents != 0)
+                {
+                    return Wait::stopped;
+                }
+                if (ready > 0 && (descriptors[0].revents & POLLIN) != 0)
+                {
+                    return Wait::character;
+                }
+                if (ready > 0)
+                {
+                    // Hangup (e.g. no master has the pty open): nothing to read for a while.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+                return Wait::silence;
+            }
+        }
+
+        // Appends the characters that arrived; returns the time the last one was read.
+        std::chrono::steady_clock::time_point receive(Frame &frame, size_t &length, bool &valid)
+        {
+            std::array<uint8_t, 64> chunk;
+            ssize_t count = 0;
+            while ((count = read(fd_, chunk.data(), chunk.size())) > 0)
+            {
+                const auto received = static_cast<size_t>(count);
+                if (length + received > frame.size())
+                {
+                    // Longer than any RTU frame.
+                    valid = false;
+                    continue;
+                }
+                std::memcpy(frame.data() + length, chunk.data(), received);
+                length += received;
+            }
+            return std::chrono::steady_clock::now();
+        }
+
+        void run(std::stop_token stop)
+        {
+            Frame frame;
+            Frame response;
+            size_t length = 0;
+            bool valid = true;
+
+            // Initial state: a frame may only start after t3.5 of silence.
+            auto last = std::chrono::steady_clock::now();
+            Wait event = Wait::character;
+            while ((event = wait(last + timing_.t35)) == Wait::character)
+            {
+                length = 0;
+                last = receive(frame, length, valid);
+            }
+
+            while (event != Wait::stopped && !stop.stop_requested())
+            {
+                // Idle: wait for the first character of a frame.
+                if ((event = wait(std::nullopt)) != Wait::character)
+                {
+                    continue;
+                }
+                length = 0;
+                valid = true;
+                last = receive(frame, length, valid);
+
+                // Reception: characters closer than t1.5 belong to the frame.
+                while ((event = wait(last + timing_.t15)) == Wait::character)
+                {
+                    last = receive(frame, length, valid);
+                }
+                if (event == Wait::stopped)
+                {
+                    break;
+                }
+
+                // Control and waiting: the frame is only checked while the line
+                // has to stay silent until t3.5 after its last character; it is
+                // served once that silence confirms it.
+                bool addressed = false;
+                if (valid)
+                {
+                    addressed = check_frame(frame.data(), length);
+                }
+                else
+                {
+                    framing_errors_.fetch_add(1, std::memory_order_relaxed);
+                }
+                while ((event = wait(last + timing_.t35)) == Wait::character)
+                {
+                    if (valid)
+                    {
+                        valid = false;
+                        addressed = false;
+                        framing_errors_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    size_t discarded = 0;
+                    last = receive(response, discarded, valid);
+                }
+                if (event != Wait::silence || !addressed)
+                {
+                    continue;
+                }
+                std::chrono::nanoseconds delay{0};
+                if (const size_t response_length = handle_frame(frame.data(), length, response.data(), delay);
+                    response_length != 0)
+                {
+                    if (delay > std::chrono::nanoseconds::zero())
+                    {
+                        std::this_thread::sleep_for(delay);
+                    }
+                    send(response.data(), response_length);
+                }
+            }
+        }
+
+        // Returns true if the frame has a valid CRC and is a broadcast or
+        // for a device on this bus.
+        bool check_frame(const uint8_t *frame, size_t length)
+        {
+            if (!rtu_check_crc(std::span<const uint8_t>(frame, length)))
+            {
+                crc_errors_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            frames_.fetch_add(1, std::memory_order_relaxed);
+            // Otherwise for another slave on the bus.
+            return frame[0] == 0 || units[frame[0]] != nullptr;
+        }
+
+        // Serves a frame accepted by check_frame(); returns the length of
+        // the response frame (0: no response).
+        size_t handle_frame(const uint8_t *frame, size_t length, uint8_t *response, std::chrono::nanoseconds &delay)
+        {
+            const uint8_t unit = frame[0];
+            const uint8_t *request = frame + 1;
+            const size_t request_length = length - 3;
+            if (unit == 0)
+            {
+                // Broadcast: writes are applied by every device and never answered.
+                for (Device *device : units)
+                {
+                    if (device && is_write(request[0]))
+                    {
+                        requests_.fetch_add(1, std::memory_order_relaxed);
+                        respond(*device, request, request_length, response + 1);
+                    }
+                }
+                return 0;
+            }
+            Device *device = units[unit];
+            requests_.fetch_add(1, std::memory_order_relaxed);
+
+            const LatencyProfile &latency = device->config.latency;
+            if (latency.drop > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < latency.drop)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return 0;
+            }
+            delay = latency.base;
+            if (latency.jitter > std::chrono::microseconds::zero())
+            {
+                delay += std::chrono::microseconds(
+                    std::uniform_int_distribution<int64_t>(0, latency.jitter.count())(random_));
+            }
+
+            response[0] = unit;
+            const size_t pdu_length = respond(*device, request, request_length, response + 1);
+            if ((response[1] & 0x80) != 0)
+            {
+                exceptions_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return rtu_append_crc(response, 1 + pdu_length);
+        }
+
+        size_t respond(Device &device, const uint8_t *request, size_t length, uint8_t *response)
+        {
+            const std::optional<WriteMode> mode = device.write_mode(request, length);
+            if (mode == WriteMode::synchronous)
+            {
+                // Run in place: the bus is half duplex, nothing else is served meanwhile.
+                if (const uint8_t code = server_.write_pool_->run_handlers(device, request, true, values_); code != 0)
+                {
+                    return exception_pdu(request[0], code, response);
+                }
+            }
+            size_t pdu_length = 0;
+            {
+                std::lock_guard lock(device.mutex);
+                pdu_length =
+                    device.process(request, length, response, std::chrono::steady_clock::now() - server_.started_);
+            }
+            if (mode == WriteMode::fire_and_forget)
+            {
+                // Queued once stored, so the handlers read the values they are told about.
+                WritePool::Job job;
+                job.device = &device;
+                job.length = static_cast<uint16_t>(mbap_length + length);
+                std::memset(job.frame.data(), 0, mbap_length);
+                std::memcpy(job.frame.data() + mbap_length, request, length);
+                if (!server_.write_pool_->submit(job))
+                {
+                    write_queue_full_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            return pdu_length;
+        }
+
+        void send(const uint8_t *data, size_t length)
+        {
+            while (length != 0)
+            {
+                const ssize_t written = write(fd_, data, length);
+                if (written > 0)
+                {
+                    data += written;
+                    length -= static_cast<size_t>(written);
+                }
+                else if (written == -1 && errno == EAGAIN)
+                {
+                    pollfd descriptor{fd_, POLLOUT, 0};
+                    poll(&descriptor, 1, 100);
+                }
+                else if (written == -1 && errno != EINTR)
+                {
+                    return;
+                }
+            }
+        }
+
+        ModbusServer &server_;
+        const SerialConfig config_;
+        const RtuTiming timing_;
+        int fd_ = -1;
+        int wake_ = -1;
+        std::jthread thread_;
+        std::minstd_rand random_;
+        std::vector<uint16_t> values_; ///< Decoded values for synchronous write handlers
+        std::atomic<uint64_t> requests_{0};
+        std::atomic<uint64_t> exceptions_{0};
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<uint64_t> write_queue_full_{0};
+        std::atomic<uint64_t> frames_{0};
+        std::atomic<uint64_t> crc_errors_{0};
+        std::atomic<uint64_t> framing_errors_{0};
+    };
+#else
+    struct ModbusServer::WritePool
+    {
+        void stop() {}
+        void add_stats(ServerStats &) const {}
+    };
+
+    class ModbusServer::EventLoop
+    {
+    public:
+        void stop() {}
+        void add_stats(ServerStats &) const {}
+        void add_client_stats(std::vector<ClientStats> &) const {}
+    };
+
+    class ModbusServer::SerialBus
+    {
+    public:
+        SerialBus(ModbusServer &, const SerialConfig &config)
+        {
+            rtu_timing(config);
+        }
+
+        void close_port() {}
+        void add_stats(ServerStats &) const {}
+
+        std::array<Device *, 256> units{};
+    };
+#endif
+
+    ModbusServer::ModbusServer(const ServerConfig &config)
+        : config_(config)
+    {
+        if (config_.threads == 0 || config_.backlog <= 0 || config_.dispatch_quantum == 0 ||
+            config_.write_workers == 0 || config_.write_queue_capacity == 0)
+        {
+            throw std::invalid_argument(
+                "Server threads, backlog, dispatch quantum, write workers and write queue capacity must be positive");
+        }
+        if (config_.client_request_rate < 0.0 || (config_.client_request_rate > 0.0 && config_.client_burst == 0))
+        {
+            throw std::invalid_argument("Client request rate must not be negative and needs a positive burst");
+        }
+    }
+
+    ModbusServer::~ModbusServer()
+    {
+        stop();
+    }
+
+    ModbusServer::Listener *ModbusServer::find_listener(uint16_t configured_port)
+    {
+        for (const std::unique_ptr<Listener> &listener : listeners_)
+        {
+            if (listener->configured_port == configured_port)
+            {
+                return listener.get();
+            }
+        }
+        return nullptr;
+    }
+
+    int ModbusServer::add_serial_bus(const SerialConfig &config)
+    {
+        if (running())
+        {
+            throw std::invalid_argument("Serial buses cannot be added while the server is running");
+        }
+        serial_buses_.push_back(std::make_unique<SerialBus>(*this, config));
+        return static_cast<int>(serial_buses_.size() - 1);
+    }
+
+    size_t ModbusServer::add_device(const DeviceConfig &config)
+    {
+        if (running())
+        {
+            throw std::invalid_argument("Devices cannot be added while the server is running");
+        }
+        if (config.serial_bus >= 0)
+        {
+            return add_serial_device(config);
+        }
+
+        Listener *listener = find_listener(config.port);
+        if (listener && listener->units[config.unit_id])
+        {
+            throw std::invalid_argument("Port and unit id are already used by another device");
+        }
+        if (!listener)
+        {
+            listeners_.push_back(std::make_unique<Listener>());
+            listener = listeners_.back().get();
+            listener->configured_port = config.port;
+            listener->port = config.port;
+        }
+
+        std::unique_ptr<Device> device = make_device(config);
+        device->listener = listener;
+        listener->units[config.unit_id] = device.get();
+        devices_.push_back(std::move(device));
+        return devices_.size() - 1;
+    }
+
+    size_t ModbusServer::add_serial_device(const DeviceConfig &config)
+    {
+        if (static_cast<size_t>(config.serial_bus) >= serial_buses_.size())
+        {
+            throw std::invalid_argument("Serial bus " + std::to_string(config.serial_bus) + " does not exist");
+        }
+        SerialBus &bus = *serial_buses_[static_cast<size_t>(config.serial_bus)];
+        if (config.unit_id == 0)
+        {
+            throw std::invalid_argument("Unit id 0 is the broadcast address on a serial bus");
+        }
+        if (bus.units[config.unit_id])
+        {
+            throw std::invalid_argument("Serial bus and unit id are already used by another device");
+        }
+        devices_.push_back(make_device(config));
+        bus.units[config.unit_id] = devices_.back().get();
+        return devices_.size() - 1;
+    }
+
+    std::unique_ptr<ModbusServer::Device> ModbusServer::make_device(const DeviceConfig &config) const
+    {
+        auto device = std::make_unique<Device>();
+        device->config = config;
+        device->coils.resize(config.coils);
+        device->discrete_inputs.resize(config.discrete_inputs);
+        device->holding_registers.resize(config.holding_registers);
+        device->input_registers.resize(config.input_registers);
+        device->index = devices_.size();
+        return device;
+    }
+
+    bool ModbusServer::add_generator(size_t device, RegisterTable table, uint16_t address, uint16_t count,
+                                     ValueGenerator generator, std::chrono::nanoseconds period)
+    {
+        if (running() || device >= devices_.size() || !generator || count == 0 ||
+            (table != RegisterTable::holding_registers && table != RegisterTable::input_registers) ||
+            size_t{address} + count > devices_[device]->size(table))
+        {
+            return false;
+        }
+        Device &target = *devices_[device];
+        target.generators.push_back({table, address, count, std::move(generator),
+                                     std::max(period, std::chrono::nanoseconds::zero())});
+        target.scratch.reserve(std::max<size_t>(target.scratch.capacity(), count));
+        return true;
+    }
+
+    bool ModbusServer::add_write_handler(size_t device, RegisterTable table, uint16_t address, uint16_t count,
+                                         WriteHandler handler, WriteMode mode)
+    {
+        if (running() || device >= devices_.size() || !handler || count == 0 ||
+            (table != RegisterTable::coils && table != RegisterTable::holding_registers) ||
+            size_t{address} + count > devices_[device]->size(table))
+        {
+            return false;
+        }
+        devices_[device]->write_hooks.push_back({table, address, count, std::move(handler), mode});
+        return true;
+    }
+
+    bool ModbusServer::set_value(size_t device, RegisterTable table, uint16_t address, uint16_t value)
+    {
+        return set_values(device, table, address, std::span<const uint16_t>(&value, 1));
+    }
+
+    bool ModbusServer::get_value(size_t device, RegisterTable table, uint16_t address, uint16_t &value) const
+    {
+        return get_values(device, table, address, std::span<uint16_t>(&value, 1));
+    }
+
+    bool ModbusServer::set_values(size_t device, RegisterTable table, uint16_t address,
+                                  std::span<const uint16_t> values)
+    {
+        if (device >= devices_.size())
+        {
+            return false;
+        }
+        Device &target = *devices_[device];
+        std::lock_guard lock(target.mutex);
+        if (values.empty() || size_t{address} + values.size() > target.size(table))
+        {
+            return false;
+        }
+        switch (table)
+        {
+        case RegisterTable::coils:
+            std::transform(values.begin(), values.end(), target.coils.begin() + address, bit_value);
+            break;
+        case RegisterTable::discrete_inputs:
+            std::transform(values.begin(), values.end(), target.discrete_inputs.begin() + address, bit_value);
+            break;
+        case RegisterTable::holding_registers:
+            std::transform(values.begin(), values.end(), target.holding_registers.begin() + address, wire_order);
+            break;
+        case RegisterTable::input_registers:
+            std::transform(values.begin(), values.end(), target.input_registers.begin() + address, wire_order);
+            break;
+        }
+        target.version.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    bool ModbusServer::get_values(size_t device, RegisterTable table, uint16_t address,
+                                  std::span<uint16_t> values) const
+    {
+        if (device >= devices_.size())
+        {
+            return false;
+        }
+        const Device &source = *devices_[device];
+        std::lock_guard lock(source.mutex);
+        if (values.empty() || size_t{address} + values.size() > source.size(table))
+        {
+            return false;
+        }
+        const auto first = static_cast<std::ptrdiff_t>(address);
+        const auto last = first + static_cast<std::ptrdiff_t>(values.size());
+        switch (table)
+        {
+        case RegisterTable::coils:
+            std::copy(source.coils.begin() + first, source.coils.begin() + last, values.begin());
+            break;
+        case RegisterTable::discrete_inputs:
+            std::copy(source.discrete_inputs.begin() + first, source.discrete_inputs.begin() + last, values.begin());
+            break;
+        case RegisterTable::holding_registers:
+            std::transform(source.holding_registers.begin() + first, source.holding_registers.begin() + last,
+                           values.begin(), wire_order);
+            break;
+        case RegisterTable::input_registers:
+            std::transform(source.input_registers.begin() + first, source.input_registers.begin() + last,
+                           values.begin(), wire_order);
+            break;
+        }
+        return true;
+    }
+
+    bool ModbusServer::start()
+    {
+        if (running())
+        {
+            last_error_ = "Server already started";
+            return false;
+        }
+        if (devices_.empty())
+        {
+            last_error_ = "No devices configured";
+            return false;
+        }
+
+#ifdef __linux__
+        in_addr bind_address{};
+        if (inet_pton(AF_INET, config_.bind_address.c_str(), &bind_address) != 1)
+        {
+            last_error_ = "Invalid bind address " + config_.bind_address;
+            return false;
+        }
+        bind_address_ = bind_address.s_addr;
+
+        // With reuse_port, these are the sockets of the first loop; the
+        // other loops join the port (resolved here for port 0).
+        for (const std::unique_ptr<Listener> &listener : listeners_)
+        {
+            sockaddr_in address = make_address(bind_address_, listener->configured_port);
+            socklen_t length = sizeof(address);
+            listener->socket = open_listening_socket(address, config_.backlog, config_.reuse_port);
+            if (listener->socket == -1 ||
+                getsockname(listener->socket, reinterpret_cast<sockaddr *>(&address), &length) == -1)
+            {
+                last_error_ = "Failed to listen on port " + std::to_string(listener->configured_port) + ": " +
+                              modbus_strerror(errno);
+                stop();
+                return false;
+            }
+            listener->port = ntohs(address.sin_port);
+        }
+
+        started_ = std::chrono::steady_clock::now();
+        if (std::any_of(devices_.begin(), devices_.end(), [](const std::unique_ptr<Device> &device)
+                        { return !device->write_hooks.empty(); }))
+        {
+            write_pool_ = std::make_unique<WritePool>(config_.write_workers, config_.write_queue_capacity);
+        }
+        for (size_t i = 0; i < config_.threads; ++i)
+        {
+            auto loop = std::make_unique<EventLoop>(*this, i);
+            if (!loop->open(last_error_))
+            {
+                stop();
+                return false;
+            }
+            loops_.push_back(std::move(loop));
+        }
+        for (const std::unique_ptr<SerialBus> &bus : serial_buses_)
+        {
+            if (!bus->open(last_error_))
+            {
+                stop();
+                return false;
+            }
+        }
+        for (const std::unique_ptr<EventLoop> &loop : loops_)
+        {
+            loop->start();
+        }
+        for (const std::unique_ptr<SerialBus> &bus : serial_buses_)
+        {
+            bus->start();
+        }
+        return true;
+#else
+        last_error_ = "ModbusServer is only supported on Linux";
+        return false;
+#endif
+    }
+
+    void ModbusServer::stop()
+    {
+        // Loops stop submitting writes before the workers finish the queued
+        // ones, which may still hand responses to their (stopped) loops.
+        for (const std::unique_ptr<EventLoop> &loop : loops_)
+        {
+            loop->stop();
+            loop->add_stats(retired_stats_);
+        }
+        // Buses stay configured (and keep their counters) for the next start().
+        for (const std::unique_ptr<SerialBus> &bus : serial_buses_)
+        {
+            bus->close_port();
+        }
+        if (write_pool_)
+        {
+            write_pool_->stop();
+            write_pool_->add_stats(retired_stats_);
+            write_pool_.reset();
+        }
+        // A gauge, not a counter: no connection is held back once stopped.
+        retired_stats_.held_clients = 0;
+        // Destroying the loops closes their connections.
+        loops_.clear();
+#ifdef __linux__
+        for (const std::unique_ptr<Listener> &listener : listeners_)
+        {
+            if (listener->socket != -1)
+            {
+                close(listener->socket);
+                listener->socket = -1;
+            }
+        }
+#endif
+    }
+
+    uint16_t ModbusServer::port(size_t device) const
+    {
+        const Listener *listener = devices_[device]->listener;
+        return listener ? listener->port : 0;
+    }
+
+    ServerStats ModbusServer::stats() const
+    {
+        ServerStats stats = retired_stats_;
+        for (const std::unique_ptr<EventLoop> &loop : loops_)
+        {
+            loop->add_stats(stats);
+        }
+        if (write_pool_)
+        {
+            write_pool_->add_stats(stats);
+        }
+        for (const std::unique_ptr<SerialBus> &bus : serial_buses_)
+        {
+            bus->add_stats(stats);
+        }
+        return stats;
+    }
+
+    std::vector<ClientStats> ModbusServer::client_stats() const
+    {
+        std::vector<ClientStats> clients;
+        for (const std::unique_ptr<EventLoop> &loop : loops_)
+        {
+            loop->add_client_stats(clients);
+        }
+        return clients;
+    }
+
+    std::string ModbusServer::get_last_error() const
+    {
+        return last_error_;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,135 @@
+#include "libmodbus_cpp/register_transform.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        uint32_t combine_words(uint16_t high, uint16_t low)
+        {
+            return (static_cast<uint32_t>(high) << 16) | low;
+        }
+
+        template <typename T, typename Decode>
+        void decode_group(const std::vector<uint32_t> &tags,
+                          const std::vector<uint16_t> &high,
+                          const std::vector<uint16_t> &low,
+                          const uint16_t *block, T *out, Decode decode)
+        {
+            const size_t count = tags.size();
+            for (size_t k = 0; k < count; ++k)
+            {
+                out[tags[k]] = static_cast<T>(decode(block[high[k]], block[low[k]]));
+            }
+        }
+    }
+
+    bool RegisterTransform::add_tag(const TagTransform &tag)
+    {
+        const bool wide = tag.type != RawType::uint16 && tag.type != RawType::int16;
+        // A 32-bit tag needs a second register after the offset.
+        if (!(tag.min <= tag.max) || (wide && tag.register_offset == 0xFFFF))
+        {
+            return false;
+        }
+
+        const uint16_t second = wide ? static_cast<uint16_t>(tag.register_offset + 1) : tag.register_offset;
+        const bool high_first = !wide || tag.word_order == WordOrder::high_word_first;
+
+        DecodeGroup &group = groups_[static_cast<size_t>(tag.type)];
+        group.tags.push_back(static_cast<uint32_t>(tag_count()));
+        group.high.push_back(high_first ? tag.register_offset : second);
+        group.low.push_back(high_first ? second : tag.register_offset);
+
+        double_.scale.push_back(tag.scale);
+        double_.offset.push_back(tag.offset);
+        double_.min.push_back(tag.min);
+        double_.max.push_back(tag.max);
+
+        float_.scale.push_back(static_cast<float>(tag.scale));
+        float_.offset.push_back(static_cast<float>(tag.offset));
+        float_.min.push_back(static_cast<float>(tag.min));
+        float_.max.push_back(static_cast<float>(tag.max));
+
+        required_registers_ = std::max<size_t>(required_registers_, static_cast<size_t>(std::max(tag.register_offset, second)) + 1);
+        return true;
+    }
+
+    void RegisterTransform::clear()
+    {
+        groups_ = {};
+        double_ = {};
+        float_ = {};
+        required_registers_ = 0;
+    }
+
+    bool RegisterTransform::apply(std::span<const uint16_t> block, std::span<double> out) const
+    {
+        return apply_impl(block, out, double_);
+    }
+
+    bool RegisterTransform::apply(std::span<const uint16_t> block, std::span<float> out) const
+    {
+        return apply_impl(block, out, float_);
+    }
+
+    template <typename T>
+    bool RegisterTransform::apply_impl(std::span<const uint16_t> block, std::span<T> out,
+                                       const Coefficients<T> &coefficients) const
+    {
+        const size_t count = tag_count();
+        if (block.size() < required_registers_ || out.size() < count)
+        {
+            return false;
+        }
+
+        const uint16_t *raw = block.data();
+        T *values = out.data();
+
+        // Decode pass: one tight loop per raw type, no per-tag dispatch.
+        const auto &u16 = groups_[static_cast<size_t>(RawType::uint16)];
+        decode_group(u16.tags, u16.high, u16.low, raw, values,
+                     [](uint16_t high, uint16_t)
+                     { return high; });
+
+        const auto &i16 = groups_[static_cast<size_t>(RawType::int16)];
+        decode_group(i16.tags, i16.high, i16.low, raw, values,
+                     [](uint16_t high, uint16_t)
+                     { return static_cast<int16_t>(high); });
+
+        const auto &u32 = groups_[static_cast<size_t>(RawType::uint32)];
+        decode_group(u32.tags, u32.high, u32.low, raw, values,
+                     [](uint16_t high, uint16_t low)
+                     { return combine_words(high, low); });
+
+        const auto &i32 = groups_[static_cast<size_t>(RawType::int32)];
+        decode_group(i32.tags, i32.high, i32.low, raw, values,
+                     [](uint16_t high, uint16_t low)
+                     { return static_cast<int32_t>(combine_words(high, low)); });
+
+        const auto &f32 = groups_[static_cast<size_t>(RawType::float32)];
+        decode_group(f32.tags, f32.high, f32.low, raw, values,
+                     [](uint16_t high, uint16_t low)
+                     { return std::bit_cast<float>(combine_words(high, low)); });
+
+        // Scale pass: contiguous, branch-free and therefore vectorizable.
+        // The ternaries map directly onto SIMD min/max instructions.
+        const T *scale = coefficients.scale.data();
+        const T *offset = coefficients.offset.data();
+        const T *min = coefficients.min.data();
+        const T *max = coefficients.max.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const T value = values[i] * scale[i] + offset[i];
+            const T lower = value < min[i] ? min[i] : value;
+            values[i] = lower > max[i] ? max[i] : lower;
+        }
+
+        return true;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
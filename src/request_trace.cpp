@@ -0,0 +1,648 @@
+#include "libmodbus_cpp/request_trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    struct RequestTracer::ThreadBuffer
+    {
+        ThreadBuffer(size_t capacity, uint32_t thread_id)
+            : records(capacity), id(thread_id)
+        {
+        }
+
+        std::vector<TraceRecord> records;
+        uint32_t id;
+        /// Number of records ever written; only the owning thread stores it
+        std::atomic<uint64_t> head{0};
+        /// Records below this index were discarded by clear()
+        std::atomic<uint64_t> floor{0};
+        /// Open scan of the owning thread
+        uint64_t scan = 0;
+    };
+
+    namespace
+    {
+        constexpr size_t no_span = std::numeric_limits<size_t>::max();
+
+        enum class SpanKind
+        {
+            queue,
+            scan,
+            transaction,
+            round_trip,
+            receive
+        };
+
+        struct SpanEvent
+        {
+            TraceEvent event;
+            std::chrono::system_clock::time_point time;
+            int32_t error;
+        };
+
+        struct TraceSpan
+        {
+            SpanKind kind;
+            uint32_t thread = 0;
+            uint64_t scan = 0;
+            uint64_t transaction = 0;
+            std::chrono::system_clock::time_point start;
+            std::chrono::system_clock::time_point end;
+            bool closed = false;
+            uint8_t function = 0;
+            uint16_t address = 0;
+            uint16_t count = 0;
+            int32_t error = 0;
+            std::vector<SpanEvent> events;
+        };
+
+        int64_t to_nanoseconds(std::chrono::system_clock::time_point time)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+
+        const char *function_name(uint8_t function)
+        {
+            switch (function)
+            {
+            case 0x01:
+                return "read coils";
+            case 0x02:
+                return "read discrete inputs";
+            case 0x03:
+                return "read holding registers";
+            case 0x04:
+                return "read input registers";
+            case 0x05:
+                return "write coil";
+            case 0x06:
+                return "write register";
+            case 0x0F:
+                return "write coils";
+            case 0x10:
+                return "write registers";
+            default:
+                return "modbus request";
+            }
+        }
+
+        const char *span_name(const TraceSpan &span)
+        {
+            switch (span.kind)
+            {
+            case SpanKind::queue:
+                return "queue";
+            case SpanKind::scan:
+                return "scan";
+            case SpanKind::transaction:
+                return function_name(span.function);
+            case SpanKind::round_trip:
+                return "round trip";
+            case SpanKind::receive:
+                return "receive";
+            }
+            return "";
+        }
+
+        const char *event_name(TraceEvent event)
+        {
+            switch (event)
+            {
+            case TraceEvent::enqueue:
+                return "enqueue";
+            case TraceEvent::dequeue:
+                return "dequeue";
+            case TraceEvent::send:
+                return "send";
+            case TraceEvent::first_byte:
+                return "first_byte";
+            case TraceEvent::complete:
+                return "complete";
+            case TraceEvent::retry:
+                return "retry";
+            case TraceEvent::drain:
+                return "drain";
+            case TraceEvent::scan_end:
+                return "scan_end";
+            }
+            return "";
+        }
+
+        // Pairs the events of every thread into spans. Spans whose end was
+        // not recorded (still running or overwritten) are dropped.
+        std::vector<TraceSpan> build_spans(std::span<const TraceRecord> records)
+        {
+            struct ThreadState
+            {
+                std::chrono::system_clock::time_point enqueued;
+                bool has_enqueue = false;
+                size_t scan = no_span;
+                size_t transaction = no_span;
+                std::chrono::system_clock::time_point sent;
+                std::chrono::system_clock::time_point first_byte;
+                bool has_first_byte = false;
+            };
+
+            std::vector<TraceSpan> spans;
+            std::unordered_map<uint32_t, ThreadState> threads;
+            const auto open = [&spans](SpanKind kind, const TraceRecord &record,
+                                       std::chrono::system_clock::time_point start)
+            {
+                TraceSpan span;
+                span.kind = kind;
+                span.thread = record.thread;
+                span.scan = record.scan;
+                span.transaction = record.transaction;
+                span.start = start;
+                span.end = start;
+                span.function = record.function;
+                span.address = record.address;
+                span.count = record.count;
+                spans.push_back(std::move(span));
+                return spans.size() - 1;
+            };
+            const auto interval = [&open, &spans](SpanKind kind, const TraceRecord &record,
+                                                  std::chrono::system_clock::time_point start)
+            {
+                TraceSpan &span = spans[open(kind, record, start)];
+                span.end = record.time;
+                span.closed = true;
+            };
+
+            for (const TraceRecord &record : records)
+            {
+                ThreadState &state = threads[record.thread];
+                switch (record.event)
+                {
+                case TraceEvent::enqueue:
+                    state.enqueued = record.time;
+                    state.has_enqueue = true;
+                    break;
+                case TraceEvent::dequeue:
+                    if (state.has_enqueue)
+                    {
+                        interval(SpanKind::queue, record, state.enqueued);
+                        state.has_enqueue = false;
+                    }
+                    state.scan = open(SpanKind::scan, record, record.time);
+                    state.transaction = no_span;
+                    break;
+                case TraceEvent::send:
+                    if (state.transaction == no_span || spans[state.transaction].transaction != record.transaction)
+                    {
+                        state.transaction = open(SpanKind::transaction, record, record.time);
+                    }
+                    state.sent = record.time;
+                    state.has_first_byte = false;
+                    break;
+                case TraceEvent::first_byte:
+                    if (state.transaction != no_span)
+                    {
+                        interval(SpanKind::round_trip, record, state.sent);
+                        state.first_byte = record.time;
+                        state.has_first_byte = true;
+                        spans[state.transaction].events.push_back({record.event, record.time, record.error});
+                    }
+                    break;
+                case TraceEvent::complete:
+                    if (state.transaction != no_span)
+                    {
+                        interval(state.has_first_byte ? SpanKind::receive : SpanKind::round_trip, record,
+                                 state.has_first_byte ? state.first_byte : state.sent);
+                        TraceSpan &transaction = spans[state.transaction];
+                        transaction.end = record.time;
+                        transaction.closed = true;
+                        transaction.error = record.error;
+                    }
+                    break;
+                case TraceEvent::retry:
+                case TraceEvent::drain:
+                    if (state.transaction != no_span)
+                    {
+                        spans[state.transaction].events.push_back({record.event, record.time, record.error});
+                    }
+                    break;
+                case TraceEvent::scan_end:
+                    if (state.scan != no_span)
+                    {
+                        spans[state.scan].end = record.time;
+                        spans[state.scan].closed = true;
+                    }
+                    state.scan = no_span;
+                    state.transaction = no_span;
+                    break;
+                }
+            }
+
+            std::erase_if(spans, [](const TraceSpan &span)
+                          { return !span.closed; });
+            return spans;
+        }
+
+        void write_hex_id(std::ofstream &out, uint64_t high, uint64_t low, bool wide)
+        {
+            char buffer[40];
+            if (wide)
+            {
+                std::snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+                              static_cast<unsigned long long>(high), static_cast<unsigned long long>(low));
+            }
+            else
+            {
+                std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(low));
+            }
+            out << '"' << buffer << '"';
+        }
+    }
+
+    RequestTracer &RequestTracer::instance()
+    {
+        static RequestTracer tracer;
+        return tracer;
+    }
+
+    void RequestTracer::enable(size_t capacity_per_thread)
+    {
+        capacity_.store(std::max<size_t>(capacity_per_thread, 1), std::memory_order_relaxed);
+        enabled_.store(true, std::memory_order_relaxed);
+    }
+
+    void RequestTracer::disable() noexcept
+    {
+        enabled_.store(false, std::memory_order_relaxed);
+    }
+
+    RequestTracer::ThreadBuffer &RequestTracer::thread_buffer()
+    {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            // Buffers are never released, so records of finished threads
+            // stay available and the pointer stays valid.
+            std::lock_guard lock(mutex_);
+            buffers_.push_back(std::make_unique<ThreadBuffer>(capacity_.load(std::memory_order_relaxed),
+                                                              static_cast<uint32_t>(buffers_.size() + 1)));
+            buffer = buffers_.back().get();
+        }
+        return *buffer;
+    }
+
+    void RequestTracer::record(TraceRecord record)
+    {
+        ThreadBuffer &buffer = thread_buffer();
+        if (record.scan == 0)
+        {
+            record.scan = buffer.scan;
+        }
+        record.thread = buffer.id;
+
+        const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.records[head % buffer.records.size()] = record;
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t RequestTracer::next_transaction() noexcept
+    {
+        return next_transaction_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    uint64_t RequestTracer::begin_scan(std::chrono::system_clock::time_point enqueued)
+    {
+        ThreadBuffer &buffer = thread_buffer();
+        buffer.scan = next_scan_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        TraceRecord record;
+        record.time = enqueued;
+        record.event = TraceEvent::enqueue;
+        this->record(record);
+        record.time = std::chrono::system_clock::now();
+        record.event = TraceEvent::dequeue;
+        this->record(record);
+        return buffer.scan;
+    }
+
+    void RequestTracer::end_scan()
+    {
+        ThreadBuffer &buffer = thread_buffer();
+        if (buffer.scan == 0)
+        {
+            return;
+        }
+
+        TraceRecord record;
+        record.time = std::chrono::system_clock::now();
+        record.event = TraceEvent::scan_end;
+        this->record(record);
+        buffer.scan = 0;
+    }
+
+    std::vector<TraceRecord> RequestTracer::collect() const
+    {
+        std::vector<TraceRecord> records;
+        std::lock_guard lock(mutex_);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : buffers_)
+        {
+            const uint64_t capacity = buffer->records.size();
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t floor = buffer->floor.load(std::memory_order_relaxed);
+            uint64_t begin = std::max(floor, head > capacity ? head - capacity : 0);
+
+            const size_t first = records.size();
+            for (uint64_t index = begin; index < head; ++index)
+            {
+                records.push_back(buffer->records[index % capacity]);
+            }
+
+            // The owner may have overwritten the oldest slots meanwhile; the
+            // record at the new head may be half written.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t after = buffer->head.load(std::memory_order_relaxed);
+            if (after + 1 > capacity && after + 1 - capacity > begin)
+            {
+                const uint64_t dropped = std::min(after + 1 - capacity, head) - begin;
+                records.erase(records.begin() + static_cast<std::ptrdiff_t>(first),
+                              records.begin() + static_cast<std::ptrdiff_t>(first + dropped));
+            }
+        }
+
+        std::stable_sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b)
+                         { return a.time < b.time; });
+        return records;
+    }
+
+    void RequestTracer::clear()
+    {
+        std::lock_guard lock(mutex_);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : buffers_)
+        {
+            buffer->floor.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    StageBreakdown RequestTracer::breakdown(std::span<const TraceRecord> records)
+    {
+        struct ThreadState
+        {
+            std::chrono::system_clock::time_point enqueued;
+            std::chrono::system_clock::time_point mark;
+            std::chrono::system_clock::time_point sent;
+            std::chrono::system_clock::time_point first_byte;
+            bool in_scan = false;
+            bool has_first_byte = false;
+            uint64_t transaction = 0;
+        };
+
+        StageBreakdown result;
+        std::unordered_map<uint32_t, ThreadState> threads;
+        for (const TraceRecord &record : records)
+        {
+            ThreadState &state = threads[record.thread];
+            switch (record.event)
+            {
+            case TraceEvent::enqueue:
+                state.enqueued = record.time;
+                break;
+            case TraceEvent::dequeue:
+                ++result.scans;
+                result.queueing += record.time - state.enqueued;
+                state.mark = record.time;
+                state.in_scan = true;
+                break;
+            case TraceEvent::send:
+                if (state.in_scan)
+                {
+                    result.preparation += record.time - state.mark;
+                }
+                if (record.transaction != state.transaction)
+                {
+                    ++result.transactions;
+                    state.transaction = record.transaction;
+                }
+                state.sent = record.time;
+                state.has_first_byte = false;
+                break;
+            case TraceEvent::first_byte:
+                result.round_trip += record.time - state.sent;
+                state.first_byte = record.time;
+                state.has_first_byte = true;
+                break;
+            case TraceEvent::complete:
+                if (state.has_first_byte)
+                {
+                    result.receive += record.time - state.first_byte;
+                }
+                else
+                {
+                    result.round_trip += record.time - state.sent;
+                }
+                state.mark = record.time;
+                break;
+            case TraceEvent::retry:
+                ++result.retries;
+                break;
+            case TraceEvent::drain:
+                ++result.drains;
+                break;
+            case TraceEvent::scan_end:
+                if (state.in_scan)
+                {
+                    result.processing += record.time - state.mark;
+                }
+                state.in_scan = false;
+                break;
+            }
+        }
+        return result;
+    }
+
+    bool RequestTracer::write_chrome_trace(const std::string &path) const
+    {
+        const std::vector<TraceRecord> records = collect();
+        const std::vector<TraceSpan> spans = build_spans(records);
+
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::lock_guard lock(mutex_);
+            last_error_ = "Failed to open trace file: " + path;
+            return false;
+        }
+
+        // Timestamps relative to the first record keep sub-microsecond
+        // precision in the double-valued "ts" field.
+        const int64_t base = records.empty() ? 0 : to_nanoseconds(records.front().time);
+        const auto micros = [base](std::chrono::system_clock::time_point time)
+        {
+            return static_cast<double>(to_nanoseconds(time) - base) / 1000.0;
+        };
+
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        const auto separator = [&out, &first]()
+        {
+            out << (first ? "" : ",\n");
+            first = false;
+        };
+
+        std::vector<uint32_t> threads;
+        for (const TraceRecord &record : records)
+        {
+            if (std::find(threads.begin(), threads.end(), record.thread) == threads.end())
+            {
+                threads.push_back(record.thread);
+            }
+        }
+        for (const uint32_t thread : threads)
+        {
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"name\":\"modbus thread " << thread << "\"}}";
+        }
+
+        for (const TraceSpan &span : spans)
+        {
+            separator();
+            out << "{\"ph\":\"X\",\"name\":\"" << span_name(span) << "\",\"cat\":\"modbus\",\"pid\":1,\"tid\":" << span.thread
+                << ",\"ts\":" << micros(span.start) << ",\"dur\":" << micros(span.end) - micros(span.start)
+                << ",\"args\":{\"scan\":" << span.scan;
+            if (span.kind == SpanKind::transaction)
+            {
+                out << ",\"transaction\":" << span.transaction << ",\"function\":" << static_cast<int>(span.function)
+                    << ",\"address\":" << span.address << ",\"count\":" << span.count << ",\"error\":" << span.error;
+            }
+            out << "}}";
+
+            for (const SpanEvent &event : span.events)
+            {
+                if (event.event == TraceEvent::first_byte)
+                {
+                    continue;
+                }
+                separator();
+                out << "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" << event_name(event.event)
+                    << "\",\"cat\":\"modbus\",\"pid\":1,\"tid\":" << span.thread << ",\"ts\":" << micros(event.time)
+                    << ",\"args\":{\"transaction\":" << span.transaction << ",\"error\":" << event.error << "}}";
+            }
+        }
+        out << "\n]}\n";
+
+        if (!out)
+        {
+            std::lock_guard lock(mutex_);
+            last_error_ = "Failed to write trace file: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool RequestTracer::write_otlp(const std::string &path) const
+    {
+        const std::vector<TraceRecord> records = collect();
+        const std::vector<TraceSpan> spans = build_spans(records);
+
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::lock_guard lock(mutex_);
+            last_error_ = "Failed to open trace file: " + path;
+            return false;
+        }
+
+        // Trace ids combine the time of the first record (to keep ids of
+        // separate runs apart) with the scan id. Scan spans set the top bit
+        // of their span id so they cannot collide with transaction ids.
+        const auto run_id = static_cast<uint64_t>(records.empty() ? 0 : to_nanoseconds(records.front().time));
+        constexpr uint64_t scan_bit = uint64_t{1} << 63;
+        const auto trace_low = [](const TraceSpan &span)
+        {
+            return span.scan != 0 ? span.scan : (span.transaction | (uint64_t{1} << 62));
+        };
+
+        out << "{\"resourceSpans\":[{\"resource\":{\"attributes\":["
+               "{\"key\":\"service.name\",\"value\":{\"stringValue\":\"libmodbus_cpp\"}}]},"
+               "\"scopeSpans\":[{\"scope\":{\"name\":\"libmodbus_cpp\"},\"spans\":[\n";
+        bool first = true;
+        for (const TraceSpan &span : spans)
+        {
+            if (span.kind == SpanKind::round_trip || span.kind == SpanKind::receive)
+            {
+                continue;
+            }
+
+            out << (first ? "" : ",\n");
+            first = false;
+
+            uint64_t span_id = 0;
+            switch (span.kind)
+            {
+            case SpanKind::scan:
+                span_id = span.scan | scan_bit;
+                break;
+            case SpanKind::queue:
+                span_id = span.scan | scan_bit | (uint64_t{1} << 62);
+                break;
+            default:
+                span_id = span.transaction;
+                break;
+            }
+
+            out << "{\"traceId\":";
+            write_hex_id(out, run_id, trace_low(span), true);
+            out << ",\"spanId\":";
+            write_hex_id(out, 0, span_id, false);
+            if (span.kind != SpanKind::scan && span.scan != 0)
+            {
+                out << ",\"parentSpanId\":";
+                write_hex_id(out, 0, span.scan | scan_bit, false);
+            }
+            out << ",\"name\":\"" << span_name(span) << "\",\"kind\":" << (span.kind == SpanKind::transaction ? 3 : 1)
+                << ",\"startTimeUnixNano\":\"" << to_nanoseconds(span.start)
+                << "\",\"endTimeUnixNano\":\"" << to_nanoseconds(span.end) << "\",\"attributes\":[";
+            if (span.kind == SpanKind::transaction)
+            {
+                out << "{\"key\":\"modbus.function\",\"value\":{\"intValue\":\"" << static_cast<int>(span.function) << "\"}},"
+                    << "{\"key\":\"modbus.address\",\"value\":{\"intValue\":\"" << span.address << "\"}},"
+                    << "{\"key\":\"modbus.count\",\"value\":{\"intValue\":\"" << span.count << "\"}},"
+                    << "{\"key\":\"thread.id\",\"value\":{\"intValue\":\"" << span.thread << "\"}}";
+            }
+            else
+            {
+                out << "{\"key\":\"thread.id\",\"value\":{\"intValue\":\"" << span.thread << "\"}}";
+            }
+            out << "],\"events\":[";
+            for (size_t i = 0; i < span.events.size(); ++i)
+            {
+                const SpanEvent &event = span.events[i];
+                out << (i == 0 ? "" : ",") << "{\"name\":\"" << event_name(event.event)
+                    << "\",\"timeUnixNano\":\"" << to_nanoseconds(event.time) << "\",\"attributes\":["
+                    << "{\"key\":\"error.code\",\"value\":{\"intValue\":\"" << event.error << "\"}}]}";
+            }
+            out << "],\"status\":{\"code\":" << (span.error != 0 ? 2 : 1) << "}}";
+        }
+        out << "\n]}]}]}\n";
+
+        if (!out)
+        {
+            std::lock_guard lock(mutex_);
+            last_error_ = "Failed to write trace file: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    std::string RequestTracer::get_last_error() const
+    {
+        std::lock_guard lock(mutex_);
+        return last_error_;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,81 @@
+#include "libmodbus_cpp/rtu_frame.hpp"
+#include <array>
+#include <stdexcept>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        constexpr std::array<uint16_t, 256> make_crc_table()
+        {
+            std::array<uint16_t, 256> table{};
+            for (uint16_t i = 0; i < 256; ++i)
+            {
+                uint16_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1) != 0 ? static_cast<uint16_t>((crc >> 1) ^ 0xA001) : static_cast<uint16_t>(crc >> 1);
+                }
+                table[i] = crc;
+            }
+            return table;
+        }
+
+        constexpr std::array<uint16_t, 256> crc_table = make_crc_table();
+    }
+
+    RtuTiming rtu_timing(const SerialConfig &config)
+    {
+        if (config.baud <= 0)
+        {
+            throw std::invalid_argument("Baud rate must be positive");
+        }
+        // Start bit, data bits, parity bit and stop bits.
+        const int64_t bits = 1 + config.data_bits + (config.parity == 'N' ? 0 : 1) + config.stop_bits;
+        RtuTiming timing;
+        timing.character = std::chrono::nanoseconds(bits * 1'000'000'000 / config.baud);
+        if (config.baud > 19200)
+        {
+            timing.t15 = std::chrono::microseconds(750);
+            timing.t35 = std::chrono::microseconds(1750);
+        }
+        else
+        {
+            timing.t15 = timing.character * 3 / 2;
+            timing.t35 = timing.character * 7 / 2;
+        }
+        return timing;
+    }
+
+    uint16_t rtu_crc16(std::span<const uint8_t> data)
+    {
+        uint16_t crc = 0xFFFF;
+        for (uint8_t byte : data)
+        {
+            crc = static_cast<uint16_t>((crc >> 8) ^ crc_table[(crc ^ byte) & 0xFF]);
+        }
+        return crc;
+    }
+
+    bool rtu_check_crc(std::span<const uint8_t> frame)
+    {
+        if (frame.size() < 4)
+        {
+            return false;
+        }
+        const uint16_t crc = rtu_crc16(frame.first(frame.size() - 2));
+        return frame[frame.size() - 2] == (crc & 0xFF) && frame[frame.size() - 1] == (crc >> 8);
+    }
+
+    size_t rtu_append_crc(uint8_t *frame, size_t length)
+    {
+        const uint16_t crc = rtu_crc16(std::span<const uint8_t>(frame, length));
+        frame[length] = static_cast<uint8_t>(crc & 0xFF);
+        frame[length + 1] = static_cast<uint8_t>(crc >> 8);
+        return length + 2;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,753 @@
+#include "libmodbus_cpp/rtu_master.hpp"
+#include "serial_port.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+    namespace
+    {
+        constexpr size_t max_rtu_length = 256;
+        constexpr uint64_t tag_timer = ~uint64_t{0};
+        constexpr uint64_t tag_wake = ~uint64_t{0} - 1;
+        constexpr size_t broadcast_request = ~size_t{0}; ///< Request::device of a broadcast
+        constexpr uint16_t max_write_registers = 123;
+
+        bool bit_block(BlockKind kind)
+        {
+            return kind == BlockKind::coils || kind == BlockKind::discrete_inputs;
+        }
+
+        uint8_t function_code(BlockKind kind)
+        {
+            switch (kind)
+            {
+            case BlockKind::holding_registers:
+                return 0x03;
+            case BlockKind::input_registers:
+                return 0x04;
+            case BlockKind::coils:
+                return 0x01;
+            case BlockKind::discrete_inputs:
+                return 0x02;
+            }
+            return 0;
+        }
+
+        // Length of a read response implied by its first bytes (0: not known yet).
+        size_t response_length(const uint8_t *response, size_t received)
+        {
+            if (received < 2)
+            {
+                return 0;
+            }
+            if ((response[1] & 0x80) != 0)
+            {
+                return 5;
+            }
+            return received < 3 ? 0 : 3 + size_t{response[2]} + 2;
+        }
+    }
+
+    struct RtuMaster::Bus
+    {
+        struct Request
+        {
+            size_t device = 0;
+            size_t block = 0;
+        };
+
+        enum class State
+        {
+            idle,
+            sending,
+            waiting
+        };
+
+        SerialConfig config;
+        RtuTiming timing;
+        clock::duration response_timeout{};
+        clock::duration turnaround_delay{};
+        size_t index = 0;
+        int fd = -1;
+        bool writable = false; ///< Watching for EPOLLOUT
+        bool watched = false;  ///< Registered with epoll (dropped after a hangup)
+        std::deque<Request> queue;
+        std::deque<std::vector<uint8_t>> broadcasts; ///< Frames of the queued broadcasts, in queue order
+        State state = State::idle;
+        Request current;
+        std::array<uint8_t, max_rtu_length> frame{};
+        size_t frame_length = 0;
+        size_t written = 0;
+        std::array<uint8_t, max_rtu_length> response{};
+        size_t received = 0;
+        clock::time_point deadline;    ///< Response timeout of the current request
+        clock::time_point quiet_until; ///< End of the t3.5 gap before the next request
+        BusStats stats;
+    };
+
+    struct RtuMaster::Device
+    {
+        size_t bus = 0;
+        uint8_t unit_id = 0;
+        ScanPlan plan;
+        clock::duration interval{};
+        clock::time_point deadline;
+        ScanResult result;
+        std::vector<uint8_t> block_seen;
+        std::vector<Listener> listeners;
+        DeviceStats stats;
+        size_t pending = 0; ///< Blocks of the current scan not answered yet
+        bool success = true;
+    };
+
+    RtuMaster::RtuMaster() = default;
+
+    RtuMaster::~RtuMaster()
+    {
+        close();
+    }
+
+    int RtuMaster::add_bus(const SerialConfig &config, clock::duration response_timeout,
+                           clock::duration turnaround_delay)
+    {
+        if (is_open())
+        {
+            throw std::invalid_argument("Buses cannot be added while the master is open");
+        }
+        if (response_timeout <= clock::duration::zero())
+        {
+            throw std::invalid_argument("Response timeout must be positive");
+        }
+        if (turnaround_delay < clock::duration::zero())
+        {
+            throw std::invalid_argument("Turnaround delay must not be negative");
+        }
+
+        auto bus = std::make_unique<Bus>();
+        bus->config = config;
+        bus->timing = rtu_timing(config);
+        bus->response_timeout = response_timeout;
+        bus->turnaround_delay = turnaround_delay;
+        bus->index = buses_.size();
+        buses_.push_back(std::move(bus));
+        return static_cast<int>(buses_.size() - 1);
+    }
+
+    size_t RtuMaster::add_device(int bus, uint8_t unit_id, ScanPlan plan, clock::duration interval)
+    {
+        if (is_open())
+        {
+            throw std::invalid_argument("Devices cannot be added while the master is open");
+        }
+        if (bus < 0 || static_cast<size_t>(bus) >= buses_.size())
+        {
+            throw std::invalid_argument("Bus " + std::to_string(bus) + " does not exist");
+        }
+        if (unit_id == 0 || unit_id > 247)
+        {
+            throw std::invalid_argument("Unit id must be 1..247");
+        }
+        if (interval <= clock::duration::zero())
+        {
+            throw std::invalid_argument("Scan interval must be positive");
+        }
+        if (plan.blocks().empty())
+        {
+            throw std::invalid_argument("Scan plan has no blocks");
+        }
+
+        auto device = std::make_unique<Device>();
+        device->bus = static_cast<size_t>(bus);
+        device->unit_id = unit_id;
+        device->plan = std::move(plan);
+        device->interval = interval;
+        const size_t blocks = device->plan.blocks().size();
+        ScanResult &result = device->result;
+        result.image.assign(device->plan.image_size(), 0);
+        result.changed.reserve(device->plan.image_size());
+        result.block_valid.assign(blocks, 0);
+        result.block_polled.assign(blocks, 0);
+        result.block_changed.assign(blocks, 0);
+        result.block_sent.resize(blocks);
+        result.block_received.resize(blocks);
+        device->block_seen.assign(blocks, 0);
+        devices_.push_back(std::move(device));
+        return devices_.size() - 1;
+    }
+
+    bool RtuMaster::add_listener(size_t device, Listener listener)
+    {
+        if (device >= devices_.size() || !listener)
+        {
+            return false;
+        }
+        devices_[device]->listeners.push_back(std::move(listener));
+        return true;
+    }
+
+    bool RtuMaster::broadcast_write_register(int bus, uint16_t address, uint16_t value)
+    {
+        return submit_broadcast(bus, {0, 0x06,
+                                      static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address & 0xFF),
+                                      static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value & 0xFF)});
+    }
+
+    bool RtuMaster::broadcast_write_registers(int bus, uint16_t address, uint16_t count, const uint16_t *values)
+    {
+        if (count == 0 || count > max_write_registers)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> frame(7 + size_t{count} * 2);
+        frame[0] = 0;
+        frame[1] = 0x10;
+        frame[2] = static_cast<uint8_t>(address >> 8);
+        frame[3] = static_cast<uint8_t>(address & 0xFF);
+        frame[4] = static_cast<uint8_t>(count >> 8);
+        frame[5] = static_cast<uint8_t>(count & 0xFF);
+        frame[6] = static_cast<uint8_t>(count * 2);
+        for (size_t i = 0; i < count; ++i)
+        {
+            frame[7 + 2 * i] = static_cast<uint8_t>(values[i] >> 8);
+            frame[8 + 2 * i] = static_cast<uint8_t>(values[i] & 0xFF);
+        }
+        return submit_broadcast(bus, std::move(frame));
+    }
+
+    const ScanResult &RtuMaster::result(size_t device) const
+    {
+        return devices_[device]->result;
+    }
+
+    const RtuMaster::DeviceStats &RtuMaster::stats(size_t device) const
+    {
+        return devices_[device]->stats;
+    }
+
+    const RtuMaster::BusStats &RtuMaster::bus_stats(int bus) const
+    {
+        return buses_[static_cast<size_t>(bus)]->stats;
+    }
+
+    std::string RtuMaster::get_last_error() const
+    {
+        return last_error_;
+    }
+
+#ifdef __linux__
+    bool RtuMaster::open()
+    {
+        if (is_open())
+        {
+            return true;
+        }
+
+        epoll_ = epoll_create1(EPOLL_CLOEXEC);
+        timer_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_ == -1 || timer_ == -1 || wake_ == -1)
+        {
+            last_error_ = std::string("Failed to create event loop: ") + std::strerror(errno);
+            close();
+            return false;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = tag_timer;
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, timer_, &event);
+        event.data.u64 = tag_wake;
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+
+        for (const std::unique_ptr<Bus> &bus : buses_)
+        {
+            bus->fd = open_serial_port(bus->config, last_error_);
+            if (bus->fd == -1)
+            {
+                close();
+                return false;
+            }
+            watch(*bus, false);
+        }
+        return true;
+    }
+
+    bool RtuMaster::submit_broadcast(int bus, std::vector<uint8_t> frame)
+    {
+        if (bus < 0 || static_cast<size_t>(bus) >= buses_.size())
+        {
+            return false;
+        }
+        const size_t length = frame.size();
+        frame.resize(length + 2);
+        rtu_append_crc(frame.data(), length);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        submitted_.emplace_back(static_cast<size_t>(bus), std::move(frame));
+        if (wake_ != -1)
+        {
+            const uint64_t one = 1;
+            [[maybe_unused]] const ssize_t written = write(wake_, &one, sizeof(one));
+        }
+        return true;
+    }
+
+    void RtuMaster::collect_broadcasts()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &[index, frame] : submitted_)
+        {
+            Bus &bus = *buses_[index];
+            bus.broadcasts.push_back(std::move(frame));
+            bus.queue.push_back({broadcast_request, 0});
+        }
+        submitted_.clear();
+    }
+
+    void RtuMaster::close()
+    {
+        for (const std::unique_ptr<Bus> &bus : buses_)
+        {
+            if (bus->fd != -1)
+            {
+                ::close(bus->fd);
+                bus->fd = -1;
+            }
+            bus->watched = false;
+            bus->writable = false;
+            bus->queue.clear();
+            bus->broadcasts.clear();
+            bus->state = Bus::State::idle;
+        }
+        for (const std::unique_ptr<Device> &device : devices_)
+        {
+            device->pending = 0;
+        }
+        for (int *fd : {&epoll_, &timer_})
+        {
+            if (*fd != -1)
+            {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        submitted_.clear();
+        if (wake_ != -1)
+        {
+            ::close(wake_);
+            wake_ = -1;
+        }
+    }
+
+    void RtuMaster::run(std::stop_token stop)
+    {
+        if (!is_open())
+        {
+            return;
+        }
+
+        std::stop_callback wake(stop, [this]
+                                {
+                                    const uint64_t one = 1;
+                                    [[maybe_unused]] const ssize_t written = write(wake_, &one, sizeof(one));
+                                });
+        const clock::time_point start = clock::now();
+        for (const std::unique_ptr<Device> &device : devices_)
+        {
+            device->deadline = start;
+        }
+
+        std::array<epoll_event, 16> events;
+        while (!stop.stop_requested())
+        {
+            clock::time_point now = clock::now();
+            expire(now);
+            collect_broadcasts();
+            begin_scans(now);
+            for (const std::unique_ptr<Bus> &bus : buses_)
+            {
+                if (bus->state == Bus::State::idle && !bus->queue.empty() && now >= bus->quiet_until)
+                {
+                    start_request(*bus, now);
+                }
+            }
+            arm_timer();
+
+            const int count = epoll_wait(epoll_, events.data(), static_cast<int>(events.size()), -1);
+            if (count == -1 && errno != EINTR)
+            {
+                last_error_ = std::string("epoll_wait failed: ") + std::strerror(errno);
+                return;
+            }
+            now = clock::now();
+            for (int i = 0; i < count; ++i)
+            {
+                const epoll_event &event = events[static_cast<size_t>(i)];
+                if (event.data.u64 == tag_timer || event.data.u64 == tag_wake)
+                {
+                    uint64_t value = 0;
+                    [[maybe_unused]] const ssize_t length =
+                        read(event.data.u64 == tag_timer ? timer_ : wake_, &value, sizeof(value));
+                    continue;
+                }
+                Bus &bus = *buses_[event.data.u64];
+                if ((event.events & EPOLLOUT) != 0 && bus.state == Bus::State::sending)
+                {
+                    send(bus, now);
+                }
+                if ((event.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0)
+                {
+                    receive(bus, now);
+                }
+            }
+        }
+    }
+
+    void RtuMaster::begin_scans(clock::time_point now)
+    {
+        for (size_t index = 0; index < devices_.size(); ++index)
+        {
+            Device &device = *devices_[index];
+            if (now < device.deadline)
+            {
+                continue;
+            }
+            // Fixed-rate deadlines: a scan still in progress skips (and counts) the slots it runs past.
+            if (device.pending != 0)
+            {
+                const auto missed = (now - device.deadline) / device.interval + 1;
+                device.deadline += missed * device.interval;
+                device.stats.overruns += static_cast<uint64_t>(missed);
+                continue;
+            }
+
+            ScanResult &result = device.result;
+            result.changed.clear();
+            std::fill(result.block_polled.begin(), result.block_polled.end(), uint8_t{0});
+            std::fill(result.block_changed.begin(), result.block_changed.end(), uint8_t{0});
+            result.timestamp = std::chrono::system_clock::now();
+            ++result.cycle;
+            device.success = true;
+            device.pending = device.plan.blocks().size();
+            Bus &bus = *buses_[device.bus];
+            for (size_t block = 0; block < device.pending; ++block)
+            {
+                bus.queue.push_back({index, block});
+            }
+
+            device.deadline += device.interval;
+            if (device.deadline <= now)
+            {
+                const auto missed = (now - device.deadline) / device.interval + 1;
+                device.deadline += missed * device.interval;
+                device.stats.overruns += static_cast<uint64_t>(missed);
+            }
+        }
+    }
+
+    void RtuMaster::start_request(Bus &bus, clock::time_point now)
+    {
+        bus.current = bus.queue.front();
+        bus.queue.pop_front();
+        if (bus.current.device == broadcast_request)
+        {
+            const std::vector<uint8_t> &frame = bus.broadcasts.front();
+            std::copy(frame.begin(), frame.end(), bus.frame.begin());
+            bus.frame_length = frame.size();
+            bus.broadcasts.pop_front();
+        }
+        else
+        {
+            Device &device = *devices_[bus.current.device];
+            const ScanBlock &block = device.plan.blocks()[bus.current.block];
+
+            bus.frame[0] = device.unit_id;
+            bus.frame[1] = function_code(block.kind);
+            bus.frame[2] = static_cast<uint8_t>(block.address >> 8);
+            bus.frame[3] = static_cast<uint8_t>(block.address & 0xFF);
+            bus.frame[4] = static_cast<uint8_t>(block.count >> 8);
+            bus.frame[5] = static_cast<uint8_t>(block.count & 0xFF);
+            bus.frame_length = rtu_append_crc(bus.frame.data(), 6);
+
+            device.result.block_polled[bus.current.block] = 1;
+            device.result.block_sent[bus.current.block] = std::chrono::system_clock::now();
+            ++device.stats.block_reads;
+            ++bus.stats.requests;
+        }
+        bus.written = 0;
+        bus.received = 0;
+        bus.state = Bus::State::sending;
+        if (!bus.watched)
+        {
+            watch(bus, false);
+        }
+        send(bus, now);
+    }
+
+    void RtuMaster::send(Bus &bus, clock::time_point now)
+    {
+        while (bus.written < bus.frame_length)
+        {
+            const ssize_t written = write(bus.fd, bus.frame.data() + bus.written, bus.frame_length - bus.written);
+            if (written > 0)
+            {
+                bus.written += static_cast<size_t>(written);
+            }
+            else if (written == -1 && errno == EAGAIN)
+            {
+                if (!bus.writable)
+                {
+                    watch(bus, true);
+                }
+                bus.deadline = now + bus.response_timeout;
+                return;
+            }
+            else if (written == -1 && errno != EINTR)
+            {
+                ++bus.stats.timeouts;
+                finish_request(bus, false, now);
+                return;
+            }
+        }
+        if (bus.writable)
+        {
+            watch(bus, false);
+        }
+
+        const auto on_wire = static_cast<int64_t>(bus.frame_length) * bus.timing.character;
+        if (bus.current.device == broadcast_request)
+        {
+            // Nobody answers; the slaves get the turnaround delay (at least t3.5) after the frame.
+            ++bus.stats.broadcasts;
+            bus.state = Bus::State::idle;
+            bus.quiet_until = now + on_wire + std::max<clock::duration>(bus.turnaround_delay, bus.timing.t35);
+            return;
+        }
+
+        // The kernel buffers the frame; the timeout starts when its last character is on the wire.
+        bus.state = Bus::State::waiting;
+        bus.deadline = now + on_wire + bus.response_timeout;
+    }
+
+    void RtuMaster::receive(Bus &bus, clock::time_point now)
+    {
+        std::array<uint8_t, 256> chunk;
+        ssize_t count = 0;
+        while ((count = read(bus.fd, chunk.data(), chunk.size())) > 0)
+        {
+            const auto length = static_cast<size_t>(count);
+            if (bus.state != Bus::State::waiting)
+            {
+                // Late responses or other masters' traffic: the line is busy for another t3.5.
+                bus.stats.stray_bytes += length;
+                bus.quiet_until = std::max(bus.quiet_until, now + bus.timing.t35);
+                continue;
+            }
+            const size_t copied = std::min(length, bus.response.size() - bus.received);
+            std::memcpy(bus.response.data() + bus.received, chunk.data(), copied);
+            bus.received += copied;
+            bus.stats.stray_bytes += length - copied;
+        }
+        if (count == -1 && errno != EAGAIN && errno != EINTR && bus.watched)
+        {
+            // Hangup (e.g. a pty without its other end): stop watching until the next request.
+            epoll_ctl(epoll_, EPOLL_CTL_DEL, bus.fd, nullptr);
+            bus.watched = false;
+            bus.writable = false;
+        }
+
+        if (bus.state != Bus::State::waiting)
+        {
+            return;
+        }
+        const size_t expected = response_length(bus.response.data(), bus.received);
+        if (expected > bus.response.size())
+        {
+            ++bus.stats.invalid;
+            finish_request(bus, false, now);
+        }
+        else if (expected != 0 && bus.received >= expected)
+        {
+            bus.stats.stray_bytes += bus.received - expected;
+            finish_request(bus, store_response(bus), now);
+        }
+    }
+
+    bool RtuMaster::store_response(Bus &bus)
+    {
+        Device &device = *devices_[bus.current.device];
+        const size_t index = bus.current.block;
+        const ScanBlock &block = device.plan.blocks()[index];
+        const uint8_t *response = bus.response.data();
+        const size_t length = response_length(response, bus.received);
+        device.result.block_received[index] = std::chrono::system_clock::now();
+
+        if (!rtu_check_crc(std::span<const uint8_t>(response, length)))
+        {
+            ++bus.stats.crc_errors;
+            return false;
+        }
+        if (response[0] != device.unit_id || (response[1] & 0x7F) != function_code(block.kind))
+        {
+            ++bus.stats.invalid;
+            return false;
+        }
+        if ((response[1] & 0x80) != 0)
+        {
+            ++bus.stats.responses;
+            ++bus.stats.exceptions;
+            return false;
+        }
+        const bool bits = bit_block(block.kind);
+        const size_t expected_bytes = bits ? (size_t{block.count} + 7) / 8 : size_t{block.count} * 2;
+        if (response[2] != expected_bytes)
+        {
+            ++bus.stats.invalid;
+            return false;
+        }
+        ++bus.stats.responses;
+
+        ScanResult &result = device.result;
+        const uint8_t *data = response + 3;
+        const bool first = device.block_seen[index] == 0;
+        const size_t offset = device.plan.block_offset(index);
+        const size_t changed_before = result.changed.size();
+        uint16_t *image = result.image.data() + offset;
+        for (size_t i = 0; i < block.count; ++i)
+        {
+            const uint16_t value = bits ? static_cast<uint16_t>((data[i / 8] >> (i % 8)) & 1)
+                                        : static_cast<uint16_t>((data[2 * i] << 8) | data[2 * i + 1]);
+            if (first || image[i] != value)
+            {
+                image[i] = value;
+                result.changed.push_back(static_cast<uint32_t>(offset + i));
+            }
+        }
+        device.block_seen[index] = 1;
+        result.block_changed[index] = result.changed.size() != changed_before ? 1 : 0;
+        return true;
+    }
+
+    void RtuMaster::finish_request(Bus &bus, bool success, clock::time_point now)
+    {
+        if (bus.writable)
+        {
+            watch(bus, false);
+        }
+        bus.state = Bus::State::idle;
+        bus.quiet_until = now + bus.timing.t35;
+        if (bus.current.device == broadcast_request)
+        {
+            return;
+        }
+
+        const size_t index = bus.current.device;
+        Device &device = *devices_[index];
+        device.result.block_valid[bus.current.block] = success ? 1 : 0;
+        device.success = device.success && success;
+        if (--device.pending != 0)
+        {
+            return;
+        }
+        ++device.stats.scans;
+        if (!device.success)
+        {
+            ++device.stats.failures;
+        }
+        for (const Listener &listener : device.listeners)
+        {
+            listener(index, device.result, device.success);
+        }
+    }
+
+    void RtuMaster::expire(clock::time_point now)
+    {
+        for (const std::unique_ptr<Bus> &bus : buses_)
+        {
+            if (bus->state != Bus::State::idle && now >= bus->deadline)
+            {
+                ++bus->stats.timeouts;
+                finish_request(*bus, false, now);
+            }
+        }
+    }
+
+    void RtuMaster::watch(Bus &bus, bool writable)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN | (writable ? EPOLLOUT : 0u);
+        event.data.u64 = bus.index;
+        epoll_ctl(epoll_, bus.watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, bus.fd, &event);
+        bus.watched = true;
+        bus.writable = writable;
+    }
+
+    void RtuMaster::arm_timer()
+    {
+        auto next = clock::time_point::max();
+        for (const std::unique_ptr<Device> &device : devices_)
+        {
+            next = std::min(next, device->deadline);
+        }
+        for (const std::unique_ptr<Bus> &bus : buses_)
+        {
+            if (bus->state != Bus::State::idle)
+            {
+                next = std::min(next, bus->deadline);
+            }
+            else if (!bus->queue.empty())
+            {
+                next = std::min(next, bus->quiet_until);
+            }
+        }
+
+        itimerspec spec{};
+        if (next != clock::time_point::max())
+        {
+            const auto due = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch());
+            // A zero it_value would disarm the timer.
+            const int64_t nanoseconds = std::max<int64_t>(due.count(), 1);
+            spec.it_value.tv_sec = static_cast<time_t>(nanoseconds / 1000000000);
+            spec.it_value.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+        }
+        timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+#else
+    bool RtuMaster::open()
+    {
+        last_error_ = "RtuMaster is only supported on Linux";
+        return false;
+    }
+
+    bool RtuMaster::submit_broadcast(int, std::vector<uint8_t>)
+    {
+        return false;
+    }
+
+    void RtuMaster::close()
+    {
+    }
+
+    void RtuMaster::run(std::stop_token)
+    {
+    }
+#endif
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,41 @@
+#include "libmodbus_cpp/scan_plan.hpp"
+#include <algorithm>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    bool ScanPlan::add_block(BlockKind kind, uint16_t address, uint16_t count)
+    {
+        const bool bits = kind == BlockKind::coils || kind == BlockKind::discrete_inputs;
+        const uint16_t limit = bits ? max_bits_per_block : max_registers_per_block;
+        if (count == 0 || count > limit)
+        {
+            return false;
+        }
+
+        if (static_cast<uint32_t>(address) + count > 0x10000u)
+        {
+            return false;
+        }
+
+        blocks_.push_back({kind, address, count});
+        offsets_.push_back(image_size_);
+        image_size_ += count;
+        return true;
+    }
+
+    size_t ScanPlan::find_block(size_t image_index) const
+    {
+        if (image_index >= image_size_)
+        {
+            return blocks_.size();
+        }
+
+        const auto it = std::upper_bound(offsets_.begin(), offsets_.end(), image_index);
+        return static_cast<size_t>(it - offsets_.begin()) - 1;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
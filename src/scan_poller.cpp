@@ -0,0 +1,133 @@
+#include "libmodbus_cpp/scan_poller.hpp"
+#include "libmodbus_cpp/modbus_connection.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    ScanPoller::ScanPoller(ModbusConnection &connection, ScanPlan plan)
+        : connection_(connection), plan_(std::move(plan))
+    {
+        result_.image.assign(plan_.image_size(), 0);
+        result_.changed.reserve(plan_.image_size());
+        result_.block_valid.assign(plan_.blocks().size(), 0);
+        result_.block_polled.assign(plan_.blocks().size(), 0);
+        result_.block_changed.assign(plan_.blocks().size(), 0);
+        result_.block_sent.resize(plan_.blocks().size());
+        result_.block_received.resize(plan_.blocks().size());
+        block_seen_.assign(plan_.blocks().size(), 0);
+        register_buffer_.resize(ScanPlan::max_registers_per_block);
+        bit_buffer_.resize(ScanPlan::max_bits_per_block);
+    }
+
+    bool ScanPoller::poll()
+    {
+        begin_scan();
+
+        bool all_valid = true;
+        for (size_t index = 0; index < plan_.blocks().size(); ++index)
+        {
+            if (!read_block(index))
+            {
+                all_valid = false;
+            }
+        }
+
+        return all_valid;
+    }
+
+    bool ScanPoller::poll(std::span<const size_t> blocks)
+    {
+        begin_scan();
+
+        bool all_valid = true;
+        for (const size_t index : blocks)
+        {
+            if (index >= plan_.blocks().size())
+            {
+                last_error_ = "Invalid block index";
+                all_valid = false;
+                continue;
+            }
+            if (!read_block(index))
+            {
+                all_valid = false;
+            }
+        }
+
+        return all_valid;
+    }
+
+    void ScanPoller::begin_scan()
+    {
+        result_.changed.clear();
+        std::fill(result_.block_polled.begin(), result_.block_polled.end(), uint8_t{0});
+        std::fill(result_.block_changed.begin(), result_.block_changed.end(), uint8_t{0});
+        result_.timestamp = std::chrono::system_clock::now();
+        ++result_.cycle;
+    }
+
+    bool ScanPoller::read_block(size_t index)
+    {
+        result_.block_polled[index] = 1;
+
+        const ScanBlock &block = plan_.blocks()[index];
+
+        bool success = false;
+        switch (block.kind)
+        {
+        case BlockKind::holding_registers:
+            success = connection_.read_registers(block.address, block.count, register_buffer_.data());
+            break;
+        case BlockKind::input_registers:
+            success = connection_.read_input_registers(block.address, block.count, register_buffer_.data());
+            break;
+        case BlockKind::coils:
+            success = connection_.read_coils(block.address, block.count, bit_buffer_.data());
+            break;
+        case BlockKind::discrete_inputs:
+            success = connection_.read_discrete_inputs(block.address, block.count, bit_buffer_.data());
+            break;
+        }
+        // Kernel receive timestamps are used when the connection has them.
+        result_.block_sent[index] = connection_.last_timing().request_sent;
+        result_.block_received[index] = connection_.last_timing().response_received;
+
+        if (!success)
+        {
+            result_.block_valid[index] = 0;
+            last_error_ = connection_.get_last_error();
+            return false;
+        }
+
+        const bool bits = block.kind == BlockKind::coils || block.kind == BlockKind::discrete_inputs;
+        const bool first = block_seen_[index] == 0;
+        const size_t offset = plan_.block_offset(index);
+        const size_t changed_before = result_.changed.size();
+        uint16_t *image = result_.image.data() + offset;
+        for (size_t i = 0; i < block.count; ++i)
+        {
+            const uint16_t value = bits ? static_cast<uint16_t>(bit_buffer_[i] != 0) : register_buffer_[i];
+            if (first || image[i] != value)
+            {
+                image[i] = value;
+                result_.changed.push_back(static_cast<uint32_t>(offset + i));
+            }
+        }
+
+        block_seen_[index] = 1;
+        result_.block_valid[index] = 1;
+        result_.block_changed[index] = result_.changed.size() != changed_before ? 1 : 0;
+        return true;
+    }
+
+    std::string ScanPoller::get_last_error() const
+    {
+        return last_error_;
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,238 @@
+#include "libmodbus_cpp/scan_scheduler.hpp"
+#include "libmodbus_cpp/scan_poller.hpp"
+#include "libmodbus_cpp/request_trace.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    size_t ScanScheduler::add_device(ScanPoller &poller, clock::duration interval)
+    {
+        if (interval <= clock::duration::zero())
+        {
+            throw std::invalid_argument("Scan interval must be positive");
+        }
+
+        Device device;
+        device.poller = &poller;
+        device.interval = interval;
+        device.deadline = clock::now();
+        device.last_scan = device.deadline;
+        devices_.push_back(std::move(device));
+        return devices_.size() - 1;
+    }
+
+    bool ScanScheduler::set_interval(size_t device, clock::duration interval)
+    {
+        if (device >= devices_.size() || interval <= clock::duration::zero())
+        {
+            return false;
+        }
+
+        Device &entry = devices_[device];
+        entry.interval = interval;
+        if (entry.stats.scans != 0)
+        {
+            entry.deadline = std::min(entry.deadline, entry.last_scan + interval);
+        }
+
+        // A new device interval (e.g. a burst) resets every adapted block.
+        for (BlockSchedule &block : entry.blocks)
+        {
+            block.interval = interval;
+            block.stable = 0;
+            block.deadline = std::min(block.deadline, entry.deadline);
+        }
+        return true;
+    }
+
+    bool ScanScheduler::set_adaptive(size_t device, const AdaptiveRate &rate)
+    {
+        if (device >= devices_.size() || !(rate.backoff_factor > 1.0) ||
+            rate.max_interval < devices_[device].interval)
+        {
+            return false;
+        }
+
+        Device &entry = devices_[device];
+        const size_t block_count = entry.poller->plan().blocks().size();
+        entry.adaptive = true;
+        entry.rate = rate;
+        entry.blocks.assign(block_count, BlockSchedule{entry.interval, entry.deadline, 0});
+        entry.due.reserve(block_count);
+        return true;
+    }
+
+    ScanScheduler::clock::duration ScanScheduler::block_interval(size_t device, size_t block) const
+    {
+        const Device &entry = devices_[device];
+        if (!entry.adaptive || block >= entry.blocks.size())
+        {
+            return entry.interval;
+        }
+        return entry.blocks[block].interval;
+    }
+
+    bool ScanScheduler::add_listener(size_t device, Listener listener)
+    {
+        if (device >= devices_.size() || !listener)
+        {
+            return false;
+        }
+
+        devices_[device].listeners.push_back(std::move(listener));
+        return true;
+    }
+
+    size_t ScanScheduler::run_pending(clock::time_point now)
+    {
+        size_t scans = 0;
+        for (size_t index = 0; index < devices_.size(); ++index)
+        {
+            if (devices_[index].deadline <= now)
+            {
+                scan(index, now);
+                ++scans;
+            }
+        }
+        return scans;
+    }
+
+    ScanScheduler::clock::time_point ScanScheduler::next_deadline() const noexcept
+    {
+        auto deadline = clock::time_point::max();
+        for (const Device &device : devices_)
+        {
+            deadline = std::min(deadline, device.deadline);
+        }
+        return deadline;
+    }
+
+    void ScanScheduler::run(std::stop_token stop)
+    {
+        std::mutex mutex;
+        std::condition_variable_any wakeup;
+        while (!stop.stop_requested())
+        {
+            run_pending(clock::now());
+
+            std::unique_lock lock(mutex);
+            wakeup.wait_until(lock, stop, next_deadline(), []
+                              { return false; });
+        }
+    }
+
+    void ScanScheduler::scan(size_t index, clock::time_point now)
+    {
+        Device &device = devices_[index];
+        device.last_scan = now;
+
+        RequestTracer &tracer = RequestTracer::instance();
+        const bool tracing = tracer.enabled();
+        if (tracing)
+        {
+            // Measured now, not from the pass snapshot: the queueing delay
+            // includes the scans of the devices ahead in the same pass.
+            tracer.begin_scan(std::chrono::system_clock::now() -
+                              std::chrono::duration_cast<std::chrono::system_clock::duration>(clock::now() - device.deadline));
+        }
+
+        bool success = false;
+        if (device.adaptive)
+        {
+            success = scan_adaptive(device, now);
+        }
+        else
+        {
+            success = device.poller->poll();
+            device.stats.block_reads += device.poller->plan().blocks().size();
+            device.deadline += device.interval;
+            device.stats.overruns += advance(device.deadline, device.interval);
+        }
+
+        ++device.stats.scans;
+        if (!success)
+        {
+            ++device.stats.failures;
+        }
+
+        for (const Listener &listener : device.listeners)
+        {
+            listener(index, device.poller->result(), success);
+        }
+
+        if (tracing)
+        {
+            tracer.end_scan();
+        }
+    }
+
+    bool ScanScheduler::scan_adaptive(Device &device, clock::time_point now)
+    {
+        device.due.clear();
+        for (size_t block = 0; block < device.blocks.size(); ++block)
+        {
+            if (device.blocks[block].deadline <= now)
+            {
+                device.due.push_back(block);
+            }
+        }
+
+        const bool success = device.poller->poll(device.due);
+        device.stats.block_reads += device.due.size();
+
+        // A late scan counts once per skipped device slot, however many blocks were due.
+        uint64_t missed = 0;
+        const ScanResult &result = device.poller->result();
+        for (const size_t block : device.due)
+        {
+            BlockSchedule &schedule = device.blocks[block];
+            if (result.block_changed[block] || !result.block_valid[block])
+            {
+                schedule.interval = device.interval;
+                schedule.stable = 0;
+            }
+            else if (++schedule.stable >= device.rate.stable_scans)
+            {
+                const auto backed_off = std::chrono::duration_cast<clock::duration>(
+                    schedule.interval * device.rate.backoff_factor);
+                schedule.interval = std::min(backed_off, device.rate.max_interval);
+                schedule.stable = 0;
+            }
+
+            schedule.deadline += schedule.interval;
+            const uint64_t block_missed = advance(schedule.deadline, schedule.interval);
+            device.stats.block_overruns += block_missed;
+            missed = std::max(missed, block_missed);
+        }
+        device.stats.overruns += missed;
+
+        device.deadline = clock::time_point::max();
+        for (const BlockSchedule &schedule : device.blocks)
+        {
+            device.deadline = std::min(device.deadline, schedule.deadline);
+        }
+        return success;
+    }
+
+    uint64_t ScanScheduler::advance(clock::time_point &deadline, clock::duration interval)
+    {
+        // Fixed-rate deadlines: skip (and count) slots the scan ran past.
+        const auto finished = clock::now();
+        if (deadline > finished)
+        {
+            return 0;
+        }
+        const auto missed = (finished - deadline) / interval + 1;
+        deadline += missed * interval;
+        return static_cast<uint64_t>(missed);
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
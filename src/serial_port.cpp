@@ -0,0 +1,116 @@
+#include "serial_port.hpp"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+#ifdef __linux__
+    namespace
+    {
+        struct BaudRate
+        {
+            int baud;
+            speed_t speed;
+        };
+
+        constexpr BaudRate baud_rates[] = {
+            {1200, B1200},     {2400, B2400},     {4800, B4800},       {9600, B9600},       {19200, B19200},
+            {38400, B38400},   {57600, B57600},   {115200, B115200},   {230400, B230400},   {460800, B460800},
+            {921600, B921600}, {1000000, B1000000}, {2000000, B2000000}, {4000000, B4000000}};
+
+        bool baud_constant(int baud, speed_t &speed)
+        {
+            for (const BaudRate &rate : baud_rates)
+            {
+                if (rate.baud == baud)
+                {
+                    speed = rate.speed;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    int open_serial_port(const SerialConfig &config, std::string &error)
+    {
+        speed_t speed = B0;
+        if (!baud_constant(config.baud, speed))
+        {
+            error = "Unsupported baud rate " + std::to_string(config.baud);
+            return -1;
+        }
+        if ((config.parity != 'N' && config.parity != 'E' && config.parity != 'O') || config.data_bits < 5 ||
+            config.data_bits > 8 || (config.stop_bits != 1 && config.stop_bits != 2))
+        {
+            error = "Invalid serial settings for " + config.device;
+            return -1;
+        }
+
+        const int fd = open(config.device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1)
+        {
+            error = "Failed to open " + config.device + ": " + std::strerror(errno);
+            return -1;
+        }
+
+        termios settings{};
+        if (tcgetattr(fd, &settings) == -1)
+        {
+            error = "Failed to read settings of " + config.device + ": " + std::strerror(errno);
+            close(fd);
+            return -1;
+        }
+        cfmakeraw(&settings);
+        cfsetispeed(&settings, speed);
+        cfsetospeed(&settings, speed);
+        settings.c_cflag &= ~static_cast<tcflag_t>(CSIZE | PARENB | PARODD | CSTOPB);
+        settings.c_cflag |= CLOCAL | CREAD;
+        settings.c_cflag |= config.data_bits == 5 ? CS5 : config.data_bits == 6 ? CS6 : config.data_bits == 7 ? CS7 : CS8;
+        if (config.parity != 'N')
+        {
+            settings.c_cflag |= config.parity == 'O' ? PARENB | PARODD : PARENB;
+        }
+        if (config.stop_bits == 2)
+        {
+            settings.c_cflag |= CSTOPB;
+        }
+        settings.c_cc[VMIN] = 0;
+        settings.c_cc[VTIME] = 0;
+        if (tcsetattr(fd, TCSANOW, &settings) == -1)
+        {
+            error = "Failed to configure " + config.device + ": " + std::strerror(errno);
+            close(fd);
+            return -1;
+        }
+        tcflush(fd, TCIOFLUSH);
+
+        // Not supported by ptys and some USB adapters; the timing is less precise then.
+        serial_struct serial{};
+        if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+        {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            ioctl(fd, TIOCSSERIAL, &serial);
+        }
+        return fd;
+    }
+#else
+    int open_serial_port(const SerialConfig &, std::string &error)
+    {
+        error = "Raw serial ports are only supported on Linux";
+        return -1;
+    }
+#endif
+
+    } // namespace v1
+} // namespace libmodbus_cpp
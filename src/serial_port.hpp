@@ -0,0 +1,28 @@
+#pragma once
+
+// Raw, non-blocking serial port for the RTU code paths that bypass
+// libmodbus (the RTU slaves of ModbusServer and RtuMaster).
+
+#include "libmodbus_cpp/rtu_frame.hpp"
+#include <string>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    /**
+     * @brief Open a serial port (or pty) in raw, non-blocking mode
+     *
+     * Reads return whatever has arrived (VMIN = VTIME = 0), and the driver
+     * is asked to pass received characters on without delay where it
+     * supports ASYNC_LOW_LATENCY. Only supported on Linux.
+     *
+     * @param config Line settings
+     * @param error Error message if the port cannot be opened
+     * @return int File descriptor, or -1 on failure
+     */
+    int open_serial_port(const SerialConfig &config, std::string &error);
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,268 @@
+#include "libmodbus_cpp/topology_scheduler.hpp"
+#include "libmodbus_cpp/modbus_connection.hpp"
+#include "libmodbus_cpp/scan_poller.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    TopologyScheduler::~TopologyScheduler()
+    {
+        stop();
+    }
+
+    size_t TopologyScheduler::add_gateway(std::string name, size_t max_concurrency)
+    {
+        if (running())
+        {
+            throw std::invalid_argument("Gateways cannot be added while the scheduler is running");
+        }
+
+        Gateway gateway;
+        gateway.name = std::move(name);
+        gateway.resource.limit = max_concurrency;
+        gateways_.push_back(std::move(gateway));
+        return gateways_.size() - 1;
+    }
+
+    size_t TopologyScheduler::add_bus(size_t gateway, double max_occupancy)
+    {
+        if (running())
+        {
+            throw std::invalid_argument("Buses cannot be added while the scheduler is running");
+        }
+        if (gateway >= gateways_.size())
+        {
+            throw std::invalid_argument("Gateway " + std::to_string(gateway) + " does not exist");
+        }
+        if (!(max_occupancy > 0.0 && max_occupancy <= 1.0))
+        {
+            throw std::invalid_argument("Maximum occupancy must be in (0, 1]");
+        }
+
+        Bus bus;
+        bus.gateway = gateway;
+        bus.max_occupancy = max_occupancy;
+        bus.resource.limit = 1;
+        buses_.push_back(bus);
+        return buses_.size() - 1;
+    }
+
+    size_t TopologyScheduler::add_device(size_t bus, ScanPoller &poller, clock::duration interval, int unit_id)
+    {
+        if (running())
+        {
+            throw std::invalid_argument("Devices cannot be added while the scheduler is running");
+        }
+        if (bus >= buses_.size())
+        {
+            throw std::invalid_argument("Bus " + std::to_string(bus) + " does not exist");
+        }
+        if (interval <= clock::duration::zero())
+        {
+            throw std::invalid_argument("Scan interval must be positive");
+        }
+
+        Device device;
+        device.bus = bus;
+        device.poller = &poller;
+        device.connection = &poller.connection();
+        device.unit_id = unit_id;
+        device.interval = interval;
+        devices_.push_back(std::move(device));
+        return devices_.size() - 1;
+    }
+
+    bool TopologyScheduler::add_listener(size_t device, Listener listener)
+    {
+        if (running() || device >= devices_.size() || !listener)
+        {
+            return false;
+        }
+        devices_[device].listeners.push_back(std::move(listener));
+        return true;
+    }
+
+    bool TopologyScheduler::start()
+    {
+        if (running() || devices_.empty())
+        {
+            return false;
+        }
+
+        const clock::time_point now = clock::now();
+        for (Device &device : devices_)
+        {
+            device.deadline = now;
+            device.last_start = {};
+        }
+        for (Bus &bus : buses_)
+        {
+            bus.available = now;
+        }
+
+        // More workers than buses could never run at the same time.
+        threads_.reserve(buses_.size());
+        for (size_t i = 0; i < buses_.size(); ++i)
+        {
+            threads_.emplace_back([this](std::stop_token stop)
+                                  { run_worker(stop); });
+        }
+        return true;
+    }
+
+    void TopologyScheduler::stop()
+    {
+        for (std::jthread &thread : threads_)
+        {
+            thread.request_stop();
+        }
+        threads_.clear();
+    }
+
+    TopologyScheduler::DeviceStats TopologyScheduler::stats(size_t device) const
+    {
+        std::lock_guard lock(mutex_);
+        return devices_[device].stats;
+    }
+
+    TopologyScheduler::ResourceStats TopologyScheduler::bus_stats(size_t bus) const
+    {
+        std::lock_guard lock(mutex_);
+        return buses_[bus].resource.stats;
+    }
+
+    TopologyScheduler::ResourceStats TopologyScheduler::gateway_stats(size_t gateway) const
+    {
+        std::lock_guard lock(mutex_);
+        return gateways_[gateway].resource.stats;
+    }
+
+    void TopologyScheduler::run_worker(std::stop_token stop)
+    {
+        std::unique_lock lock(mutex_);
+        while (!stop.stop_requested())
+        {
+            // Earliest deadline first among the devices whose resources are free.
+            const clock::time_point now = clock::now();
+            size_t chosen = devices_.size();
+            clock::time_point wake = clock::time_point::max();
+            for (size_t index = 0; index < devices_.size(); ++index)
+            {
+                const Device &device = devices_[index];
+                if (device.scanning)
+                {
+                    continue;
+                }
+                const Bus &bus = buses_[device.bus];
+                const clock::time_point ready = std::max(device.deadline, bus.available);
+                if (ready > now)
+                {
+                    wake = std::min(wake, ready);
+                    continue;
+                }
+                // Busy resources are released with a notification.
+                const Resource &gateway = gateways_[bus.gateway].resource;
+                if (bus.resource.in_flight >= bus.resource.limit ||
+                    (gateway.limit != 0 && gateway.in_flight >= gateway.limit) || connection_busy(device.connection))
+                {
+                    continue;
+                }
+                if (chosen == devices_.size() || device.deadline < devices_[chosen].deadline ||
+                    (device.deadline == devices_[chosen].deadline && device.last_start < devices_[chosen].last_start))
+                {
+                    chosen = index;
+                }
+            }
+            if (chosen == devices_.size())
+            {
+                changed_.wait_until(lock, stop, wake, []
+                                    { return false; });
+                continue;
+            }
+
+            Device &device = devices_[chosen];
+            Bus &bus = buses_[device.bus];
+            Gateway &gateway = gateways_[bus.gateway];
+            device.scanning = true;
+            device.last_start = now;
+            device.stats.max_lateness = std::max(device.stats.max_lateness, now - device.deadline);
+            acquire(bus.resource, now);
+            acquire(gateway.resource, now);
+            lock.unlock();
+
+            // Without the unit id selected the scan would read another device.
+            const bool selected = device.unit_id < 0 || device.connection->set_slave_id(device.unit_id);
+            const bool success = selected && device.poller->poll();
+
+            lock.lock();
+            const clock::time_point finished = clock::now();
+            release(bus.resource, finished);
+            release(gateway.resource, finished);
+            if (bus.max_occupancy < 1.0)
+            {
+                const auto scan_time = std::chrono::duration<double>(finished - now);
+                bus.available = finished + std::chrono::duration_cast<clock::duration>(
+                                               scan_time * ((1.0 - bus.max_occupancy) / bus.max_occupancy));
+            }
+
+            ++device.stats.scans;
+            if (!success)
+            {
+                ++device.stats.failures;
+            }
+            if (selected)
+            {
+                device.stats.block_reads += device.poller->plan().blocks().size();
+            }
+            // Fixed-rate deadlines: skip (and count) slots the scan ran past.
+            device.deadline += device.interval;
+            if (device.deadline <= finished)
+            {
+                const auto missed = (finished - device.deadline) / device.interval + 1;
+                device.deadline += missed * device.interval;
+                device.stats.overruns += static_cast<uint64_t>(missed);
+            }
+            changed_.notify_all();
+
+            // The device stays marked as scanning, so its result is stable for the listeners.
+            lock.unlock();
+            for (const Listener &listener : device.listeners)
+            {
+                listener(chosen, device.poller->result(), success);
+            }
+            lock.lock();
+            device.scanning = false;
+        }
+    }
+
+    bool TopologyScheduler::connection_busy(const ModbusConnection *connection) const
+    {
+        return std::any_of(devices_.begin(), devices_.end(), [connection](const Device &device)
+                           { return device.scanning && device.connection == connection; });
+    }
+
+    void TopologyScheduler::acquire(Resource &resource, clock::time_point now)
+    {
+        if (resource.in_flight++ == 0)
+        {
+            resource.busy_since = now;
+        }
+        ++resource.stats.scans;
+        resource.stats.peak_in_flight = std::max(resource.stats.peak_in_flight, resource.in_flight);
+    }
+
+    void TopologyScheduler::release(Resource &resource, clock::time_point now)
+    {
+        if (--resource.in_flight == 0)
+        {
+            resource.stats.busy += now - resource.busy_since;
+        }
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
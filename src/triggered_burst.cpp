@@ -0,0 +1,169 @@
+#include "libmodbus_cpp/triggered_burst.hpp"
+#include "libmodbus_cpp/scan_poller.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace libmodbus_cpp
+{
+    inline namespace v1
+    {
+
+    TriggeredBurst::TriggeredBurst(ScanScheduler &scheduler, size_t device, size_t image_size,
+                                   const BurstConfig &config)
+        : scheduler_(scheduler), device_(device), image_size_(image_size), config_(config)
+    {
+        using duration = ScanScheduler::clock::duration;
+        if (config_.normal_interval <= duration::zero() || config_.burst_interval <= duration::zero() ||
+            config_.burst_duration < duration::zero())
+        {
+            throw std::invalid_argument("Burst intervals must be positive");
+        }
+
+        // The ring holds the pre-trigger scans plus the triggering scan; the
+        // capture additionally holds every scan of the burst (one spare slot
+        // for a scan landing exactly on the burst end).
+        const size_t ring_capacity = config_.pre_trigger_scans + 1;
+        const auto burst_scans = static_cast<size_t>(
+            (config_.burst_duration + config_.burst_interval - duration(1)) / config_.burst_interval);
+        capture_capacity_ = ring_capacity + burst_scans + 1;
+
+        previous_.assign(image_size_, 0);
+        ring_images_.assign(ring_capacity * image_size_, 0);
+        ring_scans_.resize(ring_capacity);
+        capture_images_.assign(capture_capacity_ * image_size_, 0);
+        capture_scans_.resize(capture_capacity_);
+
+        if (!scheduler_.set_interval(device_, config_.normal_interval))
+        {
+            throw std::invalid_argument("Unknown scheduler device");
+        }
+        scheduler_.add_listener(device_, [this](size_t, const ScanResult &result, bool success)
+                                { on_scan(result, success); });
+    }
+
+    bool TriggeredBurst::add_trigger(const BurstTrigger &trigger)
+    {
+        if (trigger.image_index >= image_size_)
+        {
+            return false;
+        }
+
+        triggers_.push_back(trigger);
+        return true;
+    }
+
+    void TriggeredBurst::set_capture_callback(CaptureCallback callback)
+    {
+        callback_ = std::move(callback);
+    }
+
+    void TriggeredBurst::on_scan(const ScanResult &result, bool success)
+    {
+        if (active_)
+        {
+            if (capture_size_ < capture_capacity_)
+            {
+                store(capture_images_, capture_scans_, capture_size_++, result);
+            }
+            if (ScanScheduler::clock::now() >= burst_end_)
+            {
+                finish();
+            }
+            return;
+        }
+
+        const size_t ring_capacity = ring_scans_.size();
+        store(ring_images_, ring_scans_, ring_next_, result);
+        ring_next_ = (ring_next_ + 1) % ring_capacity;
+        ring_size_ = std::min(ring_size_ + 1, ring_capacity);
+
+        const size_t available = std::min(result.image.size(), image_size_);
+        bool triggered = false;
+        if (success && primed_)
+        {
+            for (size_t i = 0; i < triggers_.size() && !triggered; ++i)
+            {
+                const uint32_t index = triggers_[i].image_index;
+                if (index < available && fired(i, previous_[index], result.image[index]))
+                {
+                    triggered = true;
+                    capture_trigger_ = i;
+                }
+            }
+        }
+
+        if (success)
+        {
+            std::copy_n(result.image.begin(), available, previous_.begin());
+            primed_ = true;
+        }
+
+        if (!triggered)
+        {
+            return;
+        }
+
+        // Move the ring contents (oldest first, ending with the triggering
+        // scan) to the start of the capture.
+        capture_size_ = 0;
+        for (size_t k = 0; k < ring_size_; ++k)
+        {
+            const size_t slot = (ring_next_ + ring_capacity - ring_size_ + k) % ring_capacity;
+            const CapturedScan &scan = ring_scans_[slot];
+            uint16_t *target = capture_images_.data() + capture_size_ * image_size_;
+            std::copy(scan.image.begin(), scan.image.end(), target);
+            capture_scans_[capture_size_] = {scan.timestamp, scan.cycle, {target, scan.image.size()}};
+            ++capture_size_;
+        }
+        capture_pre_trigger_ = ring_size_ - 1;
+        ring_size_ = 0;
+
+        active_ = true;
+        burst_end_ = ScanScheduler::clock::now() + config_.burst_duration;
+        scheduler_.set_interval(device_, config_.burst_interval);
+    }
+
+    bool TriggeredBurst::fired(size_t index, uint16_t previous, uint16_t current) const
+    {
+        const BurstTrigger &trigger = triggers_[index];
+        switch (trigger.kind)
+        {
+        case BurstTrigger::Kind::rising_above:
+            return previous <= trigger.threshold && current > trigger.threshold;
+        case BurstTrigger::Kind::falling_below:
+            return previous >= trigger.threshold && current < trigger.threshold;
+        case BurstTrigger::Kind::rising_edge:
+            return previous == 0 && current != 0;
+        case BurstTrigger::Kind::falling_edge:
+            return previous != 0 && current == 0;
+        case BurstTrigger::Kind::any_edge:
+            return (previous != 0) != (current != 0);
+        }
+        return false;
+    }
+
+    void TriggeredBurst::store(std::vector<uint16_t> &images, std::vector<CapturedScan> &scans,
+                               size_t slot, const ScanResult &result)
+    {
+        const size_t count = std::min(result.image.size(), image_size_);
+        uint16_t *target = images.data() + slot * image_size_;
+        std::copy_n(result.image.begin(), count, target);
+        scans[slot] = {result.timestamp, result.cycle, {target, count}};
+    }
+
+    void TriggeredBurst::finish()
+    {
+        active_ = false;
+        ++bursts_;
+        scheduler_.set_interval(device_, config_.normal_interval);
+
+        if (callback_)
+        {
+            callback_(BurstCapture{capture_trigger_, capture_pre_trigger_,
+                                   std::span<const CapturedScan>(capture_scans_.data(), capture_size_)});
+        }
+    }
+
+    } // namespace v1
+} // namespace libmodbus_cpp
@@ -0,0 +1,260 @@
+// Benchmarks every ModbusConnection operation and accounts the heap
+// allocations and system calls each one costs. With a budget file the
+// run fails when an operation exceeds its budget, which guards the
+// allocation-free and batched I/O paths against regressions.
+//
+// Usage: modbus_bench [--host HOST --port PORT] [--slave ID]
+//                     [--iterations N] [--warmup N] [--budget-file FILE]
+//
+// Without --host an in-process loopback server is used.
+//
+// Budget file: one "operation max_allocations_per_op max_syscalls_per_op"
+// line per operation; "*" sets the budget of operations not listed, '#'
+// starts a comment.
+
+#include "accounting.hpp"
+#include "loopback_server.hpp"
+#include "libmodbus_cpp/modbus_connection.hpp"
+
+#include <modbus/modbus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using libmodbus_cpp::ModbusConnection;
+using namespace libmodbus_cpp::tools;
+
+namespace
+{
+    struct Options
+    {
+        std::string host;
+        int port = 502;
+        int slave = 1;
+        size_t iterations = 10000;
+        size_t warmup = 100;
+        std::string budget_file;
+    };
+
+    struct Budget
+    {
+        double allocations = 0.0;
+        double syscalls = 0.0;
+    };
+
+    struct Operation
+    {
+        const char *name;
+        std::function<bool(ModbusConnection &)> run;
+    };
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--host")
+            {
+                options.host = value;
+            }
+            else if (argument == "--port")
+            {
+                options.port = std::atoi(value);
+            }
+            else if (argument == "--slave")
+            {
+                options.slave = std::atoi(value);
+            }
+            else if (argument == "--iterations")
+            {
+                options.iterations = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--warmup")
+            {
+                options.warmup = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--budget-file")
+            {
+                options.budget_file = value;
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+        return options.iterations != 0;
+    }
+
+    bool load_budgets(const std::string &path, std::map<std::string, Budget> &budgets)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::fprintf(stderr, "Cannot open budget file %s\n", path.c_str());
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string name;
+            Budget budget;
+            if (!(fields >> name))
+            {
+                continue;
+            }
+            if (!(fields >> budget.allocations >> budget.syscalls))
+            {
+                std::fprintf(stderr, "Invalid budget line: %s\n", line.c_str());
+                return false;
+            }
+            budgets[name] = budget;
+        }
+        return true;
+    }
+
+    std::vector<Operation> make_operations()
+    {
+        static uint16_t registers[MODBUS_MAX_READ_REGISTERS];
+        static uint8_t bits[MODBUS_MAX_READ_BITS];
+        static uint16_t single_register;
+        static bool single_bit;
+
+        return {
+            {"read_register", [](ModbusConnection &c)
+             { return c.read_register(0, single_register); }},
+            {"read_registers", [](ModbusConnection &c)
+             { return c.read_registers(0, MODBUS_MAX_READ_REGISTERS, registers); }},
+            {"read_input_registers", [](ModbusConnection &c)
+             { return c.read_input_registers(0, MODBUS_MAX_READ_REGISTERS, registers); }},
+            {"write_register", [](ModbusConnection &c)
+             { return c.write_register(0, 42); }},
+            {"write_registers", [](ModbusConnection &c)
+             { return c.write_registers(0, MODBUS_MAX_WRITE_REGISTERS, registers); }},
+            {"read_coil", [](ModbusConnection &c)
+             { return c.read_coil(0, single_bit); }},
+            {"read_coils", [](ModbusConnection &c)
+             { return c.read_coils(0, MODBUS_MAX_READ_BITS, bits); }},
+            {"read_discrete_input", [](ModbusConnection &c)
+             { return c.read_discrete_input(0, single_bit); }},
+            {"read_discrete_inputs", [](ModbusConnection &c)
+             { return c.read_discrete_inputs(0, MODBUS_MAX_READ_BITS, bits); }},
+            {"write_coil", [](ModbusConnection &c)
+             { return c.write_coil(0, true); }},
+            {"write_coils", [](ModbusConnection &c)
+             { return c.write_coils(0, MODBUS_MAX_WRITE_BITS, bits); }},
+        };
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--host HOST --port PORT] [--slave ID] [--iterations N] [--warmup N] "
+                     "[--budget-file FILE]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, Budget> budgets;
+    if (!options.budget_file.empty() && !load_budgets(options.budget_file, budgets))
+    {
+        return 2;
+    }
+
+    LoopbackServer server;
+    if (options.host.empty())
+    {
+        if (!server.start())
+        {
+            std::fprintf(stderr, "%s\n", server.get_last_error().c_str());
+            return 2;
+        }
+        options.host = "127.0.0.1";
+        options.port = server.port();
+    }
+
+    ModbusConnection connection(options.host, options.port);
+    if (!connection.connect() || !connection.set_slave_id(options.slave))
+    {
+        std::fprintf(stderr, "%s\n", connection.get_last_error().c_str());
+        return 2;
+    }
+
+    std::printf("%-22s %12s %12s %12s %12s  %s\n", "operation", "ns/op", "allocs/op", "bytes/op", "syscalls/op",
+                "budget");
+
+    bool within_budget = true;
+    for (const Operation &operation : make_operations())
+    {
+        for (size_t i = 0; i < options.warmup; ++i)
+        {
+            operation.run(connection);
+        }
+
+        begin_accounting();
+        const auto start = std::chrono::steady_clock::now();
+        size_t failures = 0;
+        for (size_t i = 0; i < options.iterations; ++i)
+        {
+            if (!operation.run(connection))
+            {
+                ++failures;
+            }
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const AccountingCounters counters = end_accounting();
+
+        const double iterations = static_cast<double>(options.iterations);
+        const double nanoseconds = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        const double allocations = static_cast<double>(counters.allocations) / iterations;
+        const double bytes = static_cast<double>(counters.allocated_bytes) / iterations;
+        const double syscalls = static_cast<double>(counters.syscalls) / iterations;
+
+        std::string verdict = "-";
+        auto budget = budgets.find(operation.name);
+        if (budget == budgets.end())
+        {
+            budget = budgets.find("*");
+        }
+        if (budget != budgets.end())
+        {
+            const bool ok = allocations <= budget->second.allocations && syscalls <= budget->second.syscalls;
+            verdict = ok ? "ok" : "EXCEEDED";
+            within_budget = within_budget && ok;
+        }
+        if (failures != 0)
+        {
+            verdict += " (" + std::to_string(failures) + " failed: " + connection.get_last_error() + ")";
+            within_budget = false;
+        }
+
+        std::printf("%-22s %12.0f %12.2f %12.1f %12.2f  %s\n", operation.name, nanoseconds / iterations, allocations,
+                    bytes, syscalls, verdict.c_str());
+    }
+
+    connection.disconnect();
+    return within_budget ? 0 : 1;
+}
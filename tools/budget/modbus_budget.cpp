@@ -0,0 +1,326 @@
+// Bus time budget of scan plans on a serial line.
+//
+// Computes how much of the bus the configured scans (and periodic
+// broadcasts) occupy at the given baud rate and frame format, flags plans
+// that cannot be met and suggests block merges that save bus time.
+//
+// Usage: modbus_budget [--baud N] [--format 8E1] [--framing rtu|ascii]
+//                      [--master-latency-us N] [--max-occupancy X]
+//                      [--plan FILE] [--device "SPEC"]...
+//
+// Every line of the plan file (and every --device) is either a device
+//
+//     UNIT INTERVAL_MS RESPONSE_MS TABLE:ADDRESS:COUNT...
+//
+// with TABLE one of hr, ir, co, di, or a broadcast write
+//
+//     broadcast REGISTERS INTERVAL_MS [TURNAROUND_MS]
+//
+// '#' starts a comment. The exit status is 1 if the plan is infeasible.
+
+#include "libmodbus_cpp/bus_budget.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace libmodbus_cpp;
+
+namespace
+{
+    struct Options
+    {
+        BusBudgetConfig config;
+        std::vector<BudgetDevice> devices;
+        std::vector<BudgetBroadcast> broadcasts;
+    };
+
+    std::chrono::nanoseconds milliseconds(double value)
+    {
+        return std::chrono::nanoseconds(static_cast<int64_t>(value * 1e6));
+    }
+
+    bool parse_block(const std::string &text, ScanPlan &plan)
+    {
+        const size_t first = text.find(':');
+        const size_t second = text.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos)
+        {
+            return false;
+        }
+        const std::string table = text.substr(0, first);
+        BlockKind kind;
+        if (table == "hr")
+        {
+            kind = BlockKind::holding_registers;
+        }
+        else if (table == "ir")
+        {
+            kind = BlockKind::input_registers;
+        }
+        else if (table == "co")
+        {
+            kind = BlockKind::coils;
+        }
+        else if (table == "di")
+        {
+            kind = BlockKind::discrete_inputs;
+        }
+        else
+        {
+            return false;
+        }
+        const unsigned long address = std::strtoul(text.c_str() + first + 1, nullptr, 0);
+        const unsigned long count = std::strtoul(text.c_str() + second + 1, nullptr, 0);
+        return address <= 0xFFFF && count <= 0xFFFF &&
+               plan.add_block(kind, static_cast<uint16_t>(address), static_cast<uint16_t>(count));
+    }
+
+    bool parse_line(const std::string &line, Options &options)
+    {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string first;
+        if (!(fields >> first))
+        {
+            return true;
+        }
+
+        if (first == "broadcast")
+        {
+            BudgetBroadcast broadcast;
+            double interval = 0.0;
+            double turnaround = 100.0;
+            if (!(fields >> broadcast.registers >> interval))
+            {
+                return false;
+            }
+            fields >> turnaround;
+            broadcast.interval = milliseconds(interval);
+            broadcast.turnaround_delay = milliseconds(turnaround);
+            options.broadcasts.push_back(broadcast);
+            return true;
+        }
+
+        BudgetDevice device;
+        const unsigned long unit = std::strtoul(first.c_str(), nullptr, 10);
+        double interval = 0.0;
+        double response = 0.0;
+        if (unit == 0 || unit > 247 || !(fields >> interval >> response))
+        {
+            return false;
+        }
+        device.unit_id = static_cast<uint8_t>(unit);
+        device.interval = milliseconds(interval);
+        device.response_time = milliseconds(response);
+        std::string block;
+        while (fields >> block)
+        {
+            if (!parse_block(block, device.plan))
+            {
+                return false;
+            }
+        }
+        if (device.plan.blocks().empty())
+        {
+            return false;
+        }
+        options.devices.push_back(std::move(device));
+        return true;
+    }
+
+    bool load_plan(const std::string &path, Options &options)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::fprintf(stderr, "Cannot open plan file %s\n", path.c_str());
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!parse_line(line, options))
+            {
+                std::fprintf(stderr, "Invalid plan line: %s\n", line.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Character format such as 8E1 or 7N2.
+    bool parse_format(const std::string &format, SerialConfig &serial)
+    {
+        if (format.size() != 3 || (format[0] != '7' && format[0] != '8') ||
+            (format[1] != 'N' && format[1] != 'E' && format[1] != 'O') || (format[2] != '1' && format[2] != '2'))
+        {
+            return false;
+        }
+        serial.data_bits = format[0] - '0';
+        serial.parity = format[1];
+        serial.stop_bits = format[2] - '0';
+        return true;
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--baud")
+            {
+                options.config.serial.baud = std::atoi(value);
+            }
+            else if (argument == "--format")
+            {
+                if (!parse_format(value, options.config.serial))
+                {
+                    return false;
+                }
+            }
+            else if (argument == "--framing")
+            {
+                const std::string framing = value;
+                if (framing != "rtu" && framing != "ascii")
+                {
+                    return false;
+                }
+                options.config.framing = framing == "rtu" ? SerialFraming::rtu : SerialFraming::ascii;
+            }
+            else if (argument == "--master-latency-us")
+            {
+                options.config.master_latency = std::chrono::microseconds(std::strtoll(value, nullptr, 10));
+            }
+            else if (argument == "--max-occupancy")
+            {
+                options.config.max_occupancy = std::atof(value);
+            }
+            else if (argument == "--plan")
+            {
+                if (!load_plan(value, options))
+                {
+                    return false;
+                }
+            }
+            else if (argument == "--device")
+            {
+                if (!parse_line(value, options))
+                {
+                    std::fprintf(stderr, "Invalid device: %s\n", value);
+                    return false;
+                }
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+        return options.config.serial.baud > 0 && !options.devices.empty();
+    }
+
+    const char *table_name(BlockKind kind)
+    {
+        switch (kind)
+        {
+        case BlockKind::holding_registers:
+            return "hr";
+        case BlockKind::input_registers:
+            return "ir";
+        case BlockKind::coils:
+            return "co";
+        case BlockKind::discrete_inputs:
+            return "di";
+        }
+        return "?";
+    }
+
+    double to_ms(std::chrono::nanoseconds value)
+    {
+        return std::chrono::duration<double, std::milli>(value).count();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--baud N] [--format 8E1] [--framing rtu|ascii] [--master-latency-us N] "
+                     "[--max-occupancy X] [--plan FILE] [--device \"UNIT INTERVAL_MS RESPONSE_MS TABLE:ADDRESS:COUNT...\"]...\n",
+                     argv[0]);
+        return 2;
+    }
+
+    BusBudget budget;
+    try
+    {
+        budget = analyze_bus_budget(options.config, options.devices, options.broadcasts);
+    }
+    catch (const std::invalid_argument &error)
+    {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 2;
+    }
+
+    const SerialConfig &serial = options.config.serial;
+    const RtuTiming timing = rtu_timing(serial);
+    std::printf("%d baud %d%c%d %s: character %.0f us, t3.5 %.0f us, master latency %.0f us\n\n", serial.baud,
+                serial.data_bits, serial.parity, serial.stop_bits,
+                options.config.framing == SerialFraming::rtu ? "RTU" : "ASCII",
+                to_ms(timing.character) * 1000.0, to_ms(timing.t35) * 1000.0,
+                to_ms(options.config.master_latency) * 1000.0);
+
+    std::printf("%6s %4s %11s %6s %9s %9s %4s\n", "device", "unit", "interval_ms", "blocks", "scan_ms", "occupancy",
+                "fits");
+    for (size_t i = 0; i < options.devices.size(); ++i)
+    {
+        const BudgetDevice &device = options.devices[i];
+        const DeviceBudget &device_budget = budget.devices[i];
+        std::printf("%6zu %4u %11.1f %6zu %9.2f %8.1f%% %4s\n", i, device.unit_id, to_ms(device.interval),
+                    device.plan.blocks().size(), to_ms(device_budget.scan_time), device_budget.occupancy * 100.0,
+                    device_budget.fits ? "yes" : "no");
+    }
+    if (!options.broadcasts.empty())
+    {
+        std::printf("broadcasts: %.1f%%\n", budget.broadcast_occupancy * 100.0);
+    }
+
+    std::printf("\nbus occupancy %.1f%% (limit %.1f%%), all devices at once %.2f ms: %s\n", budget.occupancy * 100.0,
+                options.config.max_occupancy * 100.0, to_ms(budget.burst_time),
+                budget.feasible ? "feasible" : "INFEASIBLE");
+    if (budget.interval_scale > 1.0)
+    {
+        std::printf("intervals must grow by a factor of %.2f to stay within the limit\n", budget.interval_scale);
+    }
+
+    if (!budget.merges.empty())
+    {
+        std::printf("\nsuggested merges (only if the device answers the addresses in between):\n");
+        for (const BlockMerge &merge : budget.merges)
+        {
+            std::string blocks;
+            for (size_t block : merge.blocks)
+            {
+                blocks += (blocks.empty() ? "" : ",") + std::to_string(block);
+            }
+            std::printf("  device %zu blocks %s -> %s:%u:%u saves %.2f ms per scan\n", merge.device, blocks.c_str(),
+                        table_name(merge.merged.kind), merge.merged.address, merge.merged.count, to_ms(merge.saving));
+        }
+        std::printf("bus occupancy with all merges %.1f%%\n", budget.merged_occupancy * 100.0);
+    }
+    return budget.feasible ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+// The interposed functions below must be real definitions, not the
+// inline wrappers that _FORTIFY_SOURCE puts into the libc headers.
+#undef _FORTIFY_SOURCE
+
+#include "accounting.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <new>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace libmodbus_cpp
+{
+    namespace tools
+    {
+    namespace
+    {
+        // Plain thread-locals of the executable need no initialisation
+        // code, so they are safe to touch from inside malloc.
+        thread_local bool counting = false;
+        thread_local AccountingCounters counters;
+
+        template <typename Function>
+        Function next_symbol(const char *name)
+        {
+            return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+        }
+
+        void count_allocation(size_t size) noexcept
+        {
+            if (counting)
+            {
+                ++counters.allocations;
+                counters.allocated_bytes += size;
+            }
+        }
+
+        void count_syscall() noexcept
+        {
+            if (counting)
+            {
+                ++counters.syscalls;
+            }
+        }
+    }
+
+    void begin_accounting() noexcept
+    {
+        counters = AccountingCounters{};
+        counting = true;
+    }
+
+    AccountingCounters end_accounting() noexcept
+    {
+        counting = false;
+        return counters;
+    }
+
+    } // namespace tools
+} // namespace libmodbus_cpp
+
+using libmodbus_cpp::tools::count_allocation;
+using libmodbus_cpp::tools::count_syscall;
+using libmodbus_cpp::tools::next_symbol;
+
+#ifdef __GLIBC__
+// glibc exports its allocator under __libc_* names, so the malloc family
+// can be wrapped without dlsym (which itself allocates).
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+
+    void *malloc(size_t size)
+    {
+        count_allocation(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        count_allocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size)
+    {
+        count_allocation(size);
+        return __libc_realloc(pointer, size);
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        count_allocation(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **pointer, size_t alignment, size_t size)
+    {
+        count_allocation(size);
+        *pointer = __libc_memalign(alignment, size);
+        return *pointer != nullptr ? 0 : ENOMEM;
+    }
+}
+#else
+// Without glibc only C++ allocations are counted.
+void *operator new(size_t size)
+{
+    count_allocation(size);
+    if (void *pointer = std::malloc(size != 0 ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+extern "C"
+{
+    ssize_t read(int fd, void *buffer, size_t count)
+    {
+        static const auto real = next_symbol<ssize_t (*)(int, void *, size_t)>("read");
+        count_syscall();
+        return real(fd, buffer, count);
+    }
+
+    ssize_t write(int fd, const void *buffer, size_t count)
+    {
+        static const auto real = next_symbol<ssize_t (*)(int, const void *, size_t)>("write");
+        count_syscall();
+        return real(fd, buffer, count);
+    }
+
+    ssize_t send(int fd, const void *buffer, size_t length, int flags)
+    {
+        static const auto real = next_symbol<ssize_t (*)(int, const void *, size_t, int)>("send");
+        count_syscall();
+        return real(fd, buffer, length, flags);
+    }
+
+    ssize_t recv(int fd, void *buffer, size_t length, int flags)
+    {
+        static const auto real = next_symbol<ssize_t (*)(int, void *, size_t, int)>("recv");
+        count_syscall();
+        return real(fd, buffer, length, flags);
+    }
+
+    ssize_t sendto(int fd, const void *buffer, size_t length, int flags, const sockaddr *address,
+                   socklen_t address_length)
+    {
+        static const auto real =
+            next_symbol<ssize_t (*)(int, const void *, size_t, int, const sockaddr *, socklen_t)>("sendto");
+        count_syscall();
+        return real(fd, buffer, length, flags, address, address_length);
+    }
+
+    ssize_t recvfrom(int fd, void *buffer, size_t length, int flags, sockaddr *address, socklen_t *address_length)
+    {
+        static const auto real =
+            next_symbol<ssize_t (*)(int, void *, size_t, int, sockaddr *, socklen_t *)>("recvfrom");
+        count_syscall();
+        return real(fd, buffer, length, flags, address, address_length);
+    }
+
+    ssize_t sendmsg(int fd, const msghdr *message, int flags)
+    {
+        static const auto real = next_symbol<ssize_t (*)(int, const msghdr *, int)>("sendmsg");
+        count_syscall();
+        return real(fd, message, flags);
+    }
+
+    ssize_t recvmsg(int fd, msghdr *message, int flags)
+    {
+        static const auto real = next_symbol<ssize_t (*)(int, msghdr *, int)>("recvmsg");
+        count_syscall();
+        return real(fd, message, flags);
+    }
+
+    int select(int count, fd_set *read_set, fd_set *write_set, fd_set *error_set, timeval *timeout)
+    {
+        static const auto real = next_symbol<int (*)(int, fd_set *, fd_set *, fd_set *, timeval *)>("select");
+        count_syscall();
+        return real(count, read_set, write_set, error_set, timeout);
+    }
+
+    int poll(pollfd *descriptors, nfds_t count, int timeout)
+    {
+        static const auto real = next_symbol<int (*)(pollfd *, nfds_t, int)>("poll");
+        count_syscall();
+        return real(descriptors, count, timeout);
+    }
+
+    int epoll_wait(int fd, epoll_event *events, int max_events, int timeout)
+    {
+        static const auto real = next_symbol<int (*)(int, epoll_event *, int, int)>("epoll_wait");
+        count_syscall();
+        return real(fd, events, max_events, timeout);
+    }
+
+    int connect(int fd, const sockaddr *address, socklen_t address_length)
+    {
+        static const auto real = next_symbol<int (*)(int, const sockaddr *, socklen_t)>("connect");
+        count_syscall();
+        return real(fd, address, address_length);
+    }
+
+    int accept(int fd, sockaddr *address, socklen_t *address_length)
+    {
+        static const auto real = next_symbol<int (*)(int, sockaddr *, socklen_t *)>("accept");
+        count_syscall();
+        return real(fd, address, address_length);
+    }
+
+    int close(int fd)
+    {
+        static const auto real = next_symbol<int (*)(int)>("close");
+        count_syscall();
+        return real(fd);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace libmodbus_cpp
+{
+    namespace tools
+    {
+
+    /**
+     * @brief Allocations and system calls counted on one thread
+     */
+    struct AccountingCounters
+    {
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+        uint64_t syscalls = 0;
+    };
+
+    /**
+     * @brief Start counting allocations and system calls of the calling thread
+     *
+     * The counters are reset. Allocations are counted by interposing the
+     * malloc family, system calls by interposing the libc wrappers of the
+     * I/O calls libmodbus and the library use (read/write, send/recv
+     * variants, select/poll/epoll_wait, connect/accept/close). Other
+     * threads are not affected.
+     */
+    void begin_accounting() noexcept;
+
+    /**
+     * @brief Stop counting and return the counters of the calling thread
+     */
+    AccountingCounters end_accounting() noexcept;
+
+    } // namespace tools
+} // namespace libmodbus_cpp
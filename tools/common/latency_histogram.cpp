@@ -0,0 +1,116 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace libmodbus_cpp
+{
+    namespace tools
+    {
+    namespace
+    {
+        constexpr size_t full_count = size_t{1} << 8;
+        constexpr size_t half_count = full_count / 2;
+        // Values below full_count are exact; above, every power of two is
+        // split into half_count buckets.
+        constexpr size_t bucket_count = full_count + (64 - 8) * half_count;
+    }
+
+    LatencyHistogram::LatencyHistogram()
+        : counts_(bucket_count, 0)
+    {
+        static_assert(full_count == (size_t{1} << sub_bucket_bits));
+    }
+
+    size_t LatencyHistogram::index_of(uint64_t value) noexcept
+    {
+        if (value < full_count)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        const unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - sub_bucket_bits;
+        const uint64_t mantissa = value >> exponent;
+        return full_count + (exponent - 1) * half_count + static_cast<size_t>(mantissa - half_count);
+    }
+
+    uint64_t LatencyHistogram::highest_value_of(size_t index) noexcept
+    {
+        if (index < full_count)
+        {
+            return index;
+        }
+
+        const size_t offset = index - full_count;
+        const unsigned exponent = static_cast<unsigned>(offset / half_count) + 1;
+        const uint64_t mantissa = offset % half_count + half_count;
+        // Wraps to UINT64_MAX for the topmost bucket, which is intended.
+        return ((mantissa + 1) << exponent) - 1;
+    }
+
+    void LatencyHistogram::record(std::chrono::nanoseconds latency) noexcept
+    {
+        const uint64_t value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+        ++counts_[index_of(value)];
+        ++count_;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sum_ += static_cast<long double>(value);
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram &other) noexcept
+    {
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    void LatencyHistogram::reset() noexcept
+    {
+        std::fill(counts_.begin(), counts_.end(), uint64_t{0});
+        count_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+        sum_ = 0.0L;
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::min() const noexcept
+    {
+        return std::chrono::nanoseconds(count_ != 0 ? static_cast<int64_t>(min_) : 0);
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::mean() const noexcept
+    {
+        return std::chrono::nanoseconds(
+            count_ != 0 ? static_cast<int64_t>(sum_ / static_cast<long double>(count_)) : 0);
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::percentile(double percentile) const noexcept
+    {
+        if (count_ == 0)
+        {
+            return std::chrono::nanoseconds::zero();
+        }
+
+        const double share = std::clamp(percentile, 0.0, 100.0) / 100.0;
+        const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(share * static_cast<double>(count_))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            seen += counts_[i];
+            if (seen >= target)
+            {
+                return std::chrono::nanoseconds(static_cast<int64_t>(std::min(highest_value_of(i), max_)));
+            }
+        }
+        return std::chrono::nanoseconds(static_cast<int64_t>(max_));
+    }
+
+    } // namespace tools
+} // namespace libmodbus_cpp
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libmodbus_cpp
+{
+    namespace tools
+    {
+
+    /**
+     * @brief Log-linear latency histogram in the style of HdrHistogram
+     *
+     * Values are kept with a relative error below 1% over the full 64-bit
+     * nanosecond range in a fixed array of counters, so recording never
+     * allocates and histograms of several threads can be merged exactly.
+     */
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram();
+
+        /**
+         * @brief Record one latency
+         */
+        void record(std::chrono::nanoseconds latency) noexcept;
+
+        /**
+         * @brief Add all values of another histogram
+         */
+        void merge(const LatencyHistogram &other) noexcept;
+
+        /**
+         * @brief Remove all values
+         */
+        void reset() noexcept;
+
+        uint64_t count() const noexcept { return count_; }
+        std::chrono::nanoseconds min() const noexcept;
+        std::chrono::nanoseconds max() const noexcept { return std::chrono::nanoseconds(max_); }
+        std::chrono::nanoseconds mean() const noexcept;
+
+        /**
+         * @brief Value below or at which the given share of values lies
+         *
+         * @param percentile Percentile in 0..100
+         * @return std::chrono::nanoseconds Highest value equivalent to the
+         *         bucket holding the percentile (0 when empty)
+         */
+        std::chrono::nanoseconds percentile(double percentile) const noexcept;
+
+    private:
+        static constexpr unsigned sub_bucket_bits = 8;
+
+        static size_t index_of(uint64_t value) noexcept;
+        static uint64_t highest_value_of(size_t index) noexcept;
+
+        std::vector<uint64_t> counts_;
+        uint64_t count_ = 0;
+        uint64_t min_ = UINT64_MAX;
+        uint64_t max_ = 0;
+        long double sum_ = 0.0L;
+    };
+
+    } // namespace tools
+} // namespace libmodbus_cpp
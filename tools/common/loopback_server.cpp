@@ -0,0 +1,219 @@
+#include "loopback_server.hpp"
+
+#include <modbus/modbus.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <random>
+
+namespace libmodbus_cpp
+{
+    namespace tools
+    {
+
+    LoopbackServer::~LoopbackServer()
+    {
+        stop();
+    }
+
+    bool LoopbackServer::start()
+    {
+        if (ctx_)
+        {
+            last_error_ = "Server already started";
+            return false;
+        }
+
+        ctx_ = modbus_new_tcp("127.0.0.1", 0);
+        mapping_ = modbus_mapping_new(65536, 65536, 65536, 65536);
+        if (!ctx_ || !mapping_)
+        {
+            last_error_ = "Failed to create server context";
+            stop();
+            return false;
+        }
+
+        listen_socket_ = modbus_tcp_listen(ctx_, 64);
+        if (listen_socket_ == -1)
+        {
+            last_error_ = std::string("Listen failed: ") + modbus_strerror(errno);
+            stop();
+            return false;
+        }
+
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        if (getsockname(listen_socket_, reinterpret_cast<sockaddr *>(&address), &length) == -1)
+        {
+            last_error_ = std::string("Failed to query listen port: ") + modbus_strerror(errno);
+            stop();
+            return false;
+        }
+        port_ = ntohs(address.sin_port);
+
+        thread_ = std::jthread([this](std::stop_token stop)
+                               { accept_clients(stop); });
+        return true;
+    }
+
+    void LoopbackServer::stop()
+    {
+        if (thread_.joinable())
+        {
+            thread_.request_stop();
+            // Shutting the listen socket down wakes the blocking accept.
+            shutdown(listen_socket_, SHUT_RDWR);
+            thread_.join();
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            for (Client &client : clients_)
+            {
+                client.thread.request_stop();
+                if (client.socket != -1)
+                {
+                    shutdown(client.socket, SHUT_RDWR);
+                }
+            }
+        }
+        // Joins the client threads.
+        clients_.clear();
+
+        if (listen_socket_ != -1)
+        {
+            close(listen_socket_);
+            listen_socket_ = -1;
+        }
+        if (mapping_)
+        {
+            modbus_mapping_free(mapping_);
+            mapping_ = nullptr;
+        }
+        if (ctx_)
+        {
+            modbus_free(ctx_);
+            ctx_ = nullptr;
+        }
+    }
+
+    void LoopbackServer::set_faults(const FaultInjection &faults)
+    {
+        std::lock_guard lock(mutex_);
+        faults_ = faults;
+    }
+
+    std::string LoopbackServer::get_last_error() const
+    {
+        return last_error_;
+    }
+
+    void LoopbackServer::accept_clients(std::stop_token stop)
+    {
+        while (!stop.stop_requested())
+        {
+            const int socket = accept(listen_socket_, nullptr, nullptr);
+            if (socket == -1)
+            {
+                const int error = errno;
+                if (stop.stop_requested())
+                {
+                    return;
+                }
+                if (error == EINTR || error == ECONNABORTED || error == EPROTO)
+                {
+                    continue;
+                }
+                // Out of descriptors or memory: back off instead of spinning
+                // (which would skew the measurements of the process).
+                if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM)
+                {
+                    std::mutex mutex;
+                    std::condition_variable_any wakeup;
+                    std::unique_lock lock(mutex);
+                    wakeup.wait_for(lock, stop, std::chrono::milliseconds(100), []
+                                    { return false; });
+                    continue;
+                }
+                // The listening socket is unusable.
+                return;
+            }
+            // Pipelined responses must not wait for the client's ACK.
+            const int enable = 1;
+            setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            std::lock_guard lock(mutex_);
+            std::erase_if(clients_, [](const Client &client)
+                          { return client.done; });
+            Client &client = clients_.emplace_back();
+            client.socket = socket;
+            client.thread = std::jthread([this, &client](std::stop_token client_stop)
+                                         { serve_client(client_stop, client); });
+        }
+    }
+
+    void LoopbackServer::serve_client(std::stop_token stop, Client &client)
+    {
+        modbus_t *ctx = modbus_new_tcp("127.0.0.1", 0);
+        if (ctx)
+        {
+            modbus_set_socket(ctx, client.socket);
+
+            std::minstd_rand random(std::random_device{}());
+            std::uniform_real_distribution<double> roll(0.0, 1.0);
+            uint8_t request[MODBUS_TCP_MAX_ADU_LENGTH];
+            while (!stop.stop_requested())
+            {
+                const int length = modbus_receive(ctx, request);
+                if (length == -1)
+                {
+                    break;
+                }
+                if (length == 0)
+                {
+                    continue;
+                }
+
+                FaultInjection faults;
+                {
+                    std::lock_guard lock(mutex_);
+                    faults = faults_;
+                }
+                if (roll(random) < faults.drop)
+                {
+                    break;
+                }
+                if (roll(random) < faults.delay)
+                {
+                    std::this_thread::sleep_for(faults.delay_time);
+                }
+                if (roll(random) < faults.corrupt)
+                {
+                    // Exception frame with a foreign transaction id.
+                    const uint8_t response[] = {
+                        static_cast<uint8_t>(~request[0]), static_cast<uint8_t>(~request[1]), 0x00, 0x00,
+                        0x00, 0x03, request[6], static_cast<uint8_t>(request[7] | 0x80), 0x04};
+                    send(client.socket, response, sizeof(response), MSG_NOSIGNAL);
+                    continue;
+                }
+
+                std::lock_guard lock(mapping_mutex_);
+                modbus_reply(ctx, request, length, mapping_);
+            }
+            modbus_set_socket(ctx, -1);
+            modbus_free(ctx);
+        }
+
+        std::lock_guard lock(mutex_);
+        close(client.socket);
+        client.socket = -1;
+        client.done = true;
+    }
+
+    } // namespace tools
+} // namespace libmodbus_cpp
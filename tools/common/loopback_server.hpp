@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+struct _modbus;
+typedef struct _modbus modbus_t;
+struct _modbus_mapping_t;
+typedef struct _modbus_mapping_t modbus_mapping_t;
+
+namespace libmodbus_cpp
+{
+    namespace tools
+    {
+
+    /**
+     * @brief Faults the loopback server injects into its responses
+     *
+     * Probabilities are per request (0..1).
+     */
+    struct FaultInjection
+    {
+        /// Close the connection instead of replying
+        double drop = 0.0;
+        /// Reply only after delay_time (a client timeout if longer than the response timeout)
+        double delay = 0.0;
+        std::chrono::milliseconds delay_time{0};
+        /// Reply with a frame carrying the wrong transaction id (a data error for the client)
+        double corrupt = 0.0;
+    };
+
+    /**
+     * @brief In-process libmodbus TCP server on the loopback interface
+     *
+     * Every client is served by its own thread from a shared mapping in
+     * which every table (coils, discrete inputs, holding and input
+     * registers) covers the full 16-bit address space. Used by the tools
+     * when no external device is given.
+     */
+    class LoopbackServer
+    {
+    public:
+        LoopbackServer() = default;
+
+        /**
+         * @brief Stop the server
+         */
+        ~LoopbackServer();
+
+        LoopbackServer(const LoopbackServer &) = delete;
+        LoopbackServer &operator=(const LoopbackServer &) = delete;
+
+        /**
+         * @brief Listen on an ephemeral loopback port and start serving
+         *
+         * @return true if the server is listening
+         * @return false if the server could not be started
+         */
+        bool start();
+
+        /**
+         * @brief Stop serving and close all sockets
+         */
+        void stop();
+
+        /**
+         * @brief Set the faults injected into subsequent requests (thread-safe)
+         */
+        void set_faults(const FaultInjection &faults);
+
+        /**
+         * @brief Port the server listens on (valid after start())
+         */
+        int port() const noexcept { return port_; }
+
+        /**
+         * @brief Get the last error message
+         *
+         * @return std::string Error message
+         */
+        std::string get_last_error() const;
+
+    private:
+        struct Client
+        {
+            int socket = -1;
+            bool done = false;
+            std::jthread thread;
+        };
+
+        void accept_clients(std::stop_token stop);
+        void serve_client(std::stop_token stop, Client &client);
+
+        modbus_t *ctx_ = nullptr;
+        modbus_mapping_t *mapping_ = nullptr;
+        int listen_socket_ = -1;
+        int port_ = 0;
+        std::jthread thread_;
+        std::mutex mutex_;
+        std::mutex mapping_mutex_;
+        std::list<Client> clients_;
+        FaultInjection faults_;
+        std::string last_error_;
+    };
+
+    } // namespace tools
+} // namespace libmodbus_cpp
@@ -0,0 +1,144 @@
+// Serial framing cost of Modbus RTU versus Modbus ASCII.
+//
+// For several PDU sizes the CPU time to build and check one frame is
+// measured for both encodings: RTU appends and checks the CRC-16, ASCII
+// hex-encodes the frame with its LRC and decodes and checks it again. The
+// table also shows the bytes on the wire and the transmission time at
+// --baud, RTU as 8E1 plus the t3.5 gap between frames and ASCII as 7E1.
+//
+// Usage: modbus_framing [--iterations N] [--baud N]
+
+#include "libmodbus_cpp/ascii_frame.hpp"
+#include "libmodbus_cpp/rtu_frame.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace libmodbus_cpp;
+
+namespace
+{
+    struct Options
+    {
+        size_t iterations = 1000000;
+        int baud = 19200;
+    };
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--iterations")
+            {
+                options.iterations = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--baud")
+            {
+                options.baud = std::atoi(value);
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+        return options.iterations != 0 && options.baud > 0;
+    }
+
+    // Times one round of build and check per iteration and returns ns per
+    // frame. The first data byte changes every iteration so nothing can be
+    // hoisted out of the loop; the checks are summed into sink.
+    template <typename Round>
+    double time_rounds(size_t iterations, uint8_t *adu, Round round, uint64_t &sink)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            adu[1] = static_cast<uint8_t>(i);
+            sink += round();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: %s [--iterations N] [--baud N]\n", argv[0]);
+        return 2;
+    }
+
+    SerialConfig rtu_config;
+    rtu_config.baud = options.baud;
+    SerialConfig ascii_config = rtu_config;
+    ascii_config.data_bits = 7;
+    const RtuTiming rtu = rtu_timing(rtu_config);
+    const RtuTiming ascii = rtu_timing(ascii_config);
+
+    // Read request, small and full read responses and the largest PDU.
+    constexpr std::array<size_t, 5> pdu_sizes = {5, 21, 81, 201, 253};
+
+    std::printf("%9s %8s %10s %10s %11s %11s %13s %12s\n", "pdu_bytes", "rtu_ns", "ascii_ns", "rtu_bytes",
+                "ascii_bytes", "rtu_wire_us", "ascii_wire_us", "ascii_cpu_%");
+    uint64_t sink = 0;
+    for (size_t pdu_size : pdu_sizes)
+    {
+        const size_t adu_size = 1 + pdu_size;
+        std::array<uint8_t, 256> adu{};
+        for (size_t i = 0; i < adu_size; ++i)
+        {
+            adu[i] = static_cast<uint8_t>(i * 37 + 11);
+        }
+
+        std::array<uint8_t, 256> rtu_frame{};
+        const double rtu_ns = time_rounds(options.iterations, adu.data(), [&]()
+                                          {
+                                              std::memcpy(rtu_frame.data(), adu.data(), adu_size);
+                                              const size_t length = rtu_append_crc(rtu_frame.data(), adu_size);
+                                              return static_cast<uint64_t>(rtu_check_crc(std::span<const uint8_t>(rtu_frame.data(), length)));
+                                          },
+                                          sink);
+
+        std::array<char, max_ascii_length> text{};
+        std::array<uint8_t, 256> decoded{};
+        size_t ascii_length = 0;
+        const double ascii_ns = time_rounds(options.iterations, adu.data(), [&]()
+                                            {
+                                                ascii_length = ascii_frame(std::span<const uint8_t>(adu.data(), adu_size), text.data());
+                                                const size_t length = ascii_decode(std::span<const char>(text.data() + 1, ascii_length - 3), decoded.data());
+                                                return static_cast<uint64_t>(ascii_check_lrc(std::span<const uint8_t>(decoded.data(), length)));
+                                            },
+                                            sink);
+
+        const size_t rtu_length = adu_size + 2;
+        const double rtu_wire_us =
+            std::chrono::duration<double, std::micro>(rtu.character * static_cast<int64_t>(rtu_length) + rtu.t35).count();
+        const double ascii_wire_us =
+            std::chrono::duration<double, std::micro>(ascii.character * static_cast<int64_t>(ascii_length)).count();
+        std::printf("%9zu %8.1f %10.1f %10zu %11zu %11.0f %13.0f %12.3f\n", pdu_size, rtu_ns, ascii_ns, rtu_length,
+                    ascii_length, rtu_wire_us, ascii_wire_us, ascii_ns / 1000.0 / ascii_wire_us * 100.0);
+    }
+
+    // Every round must have produced a valid frame.
+    if (sink != 2 * options.iterations * pdu_sizes.size())
+    {
+        std::fprintf(stderr, "Frame check failed\n");
+        return 1;
+    }
+    return 0;
+}
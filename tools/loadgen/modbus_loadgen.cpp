@@ -0,0 +1,754 @@
+// Load generator simulating many concurrent Modbus TCP masters.
+//
+// Every connection runs on its own thread and issues a weighted mix of
+// requests, either one at a time through ModbusConnection or pipelined
+// (several requests in flight, matched by MBAP transaction id) on the
+// connection's socket. With a target rate, latencies are measured from the
+// intended send time, so a stalling server is not hidden by the
+// generator slowing down (coordinated omission).
+//
+// Usage: modbus_loadgen [--host HOST --port PORT] [--slave ID]
+//                       [--connections N] [--duration S] [--warmup S]
+//                       [--rate REQUESTS_PER_S] [--pipeline DEPTH]
+//                       [--mix FC:COUNT:WEIGHT,...] [--address A] [--span N]
+//                       [--timeout MS] [--json FILE|-]
+//
+// Without --host an in-process loopback server is used.
+
+#include "latency_histogram.hpp"
+#include "loopback_server.hpp"
+#include "libmodbus_cpp/modbus_connection.hpp"
+
+#include <modbus/modbus.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using libmodbus_cpp::ModbusConnection;
+using namespace libmodbus_cpp::tools;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+    struct MixEntry
+    {
+        int function = 0x03;
+        int count = 10;
+        unsigned weight = 1;
+    };
+
+    struct Options
+    {
+        std::string host;
+        int port = 502;
+        int slave = 1;
+        size_t connections = 1;
+        double duration = 10.0;
+        double warmup = 1.0;
+        double rate = 0.0;
+        size_t pipeline = 1;
+        std::vector<MixEntry> mix;
+        int address = 0;
+        int span = 0;
+        int timeout_ms = 1000;
+        std::string json;
+    };
+
+    struct EntryResult
+    {
+        LatencyHistogram latency;
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+    };
+
+    struct WorkerResult
+    {
+        std::vector<EntryResult> entries;
+        uint64_t timeouts = 0;
+        uint64_t reconnects = 0;
+        uint64_t mismatched = 0; ///< Pipelined responses matching no request in flight
+        std::string first_error;
+        bool connected = false;
+    };
+
+    bool parse_mix(const std::string &text, std::vector<MixEntry> &mix)
+    {
+        std::istringstream items(text);
+        std::string item;
+        while (std::getline(items, item, ','))
+        {
+            MixEntry entry;
+            char separator1 = 0;
+            char separator2 = 0;
+            std::istringstream fields(item);
+            if (!(fields >> entry.function >> separator1 >> entry.count >> separator2 >> entry.weight) ||
+                separator1 != ':' || separator2 != ':')
+            {
+                return false;
+            }
+
+            int max_count = 0;
+            switch (entry.function)
+            {
+            case 0x01:
+            case 0x02:
+                max_count = MODBUS_MAX_READ_BITS;
+                break;
+            case 0x03:
+            case 0x04:
+                max_count = MODBUS_MAX_READ_REGISTERS;
+                break;
+            case 0x05:
+            case 0x06:
+                max_count = 1;
+                break;
+            case 0x0F:
+                max_count = MODBUS_MAX_WRITE_BITS;
+                break;
+            case 0x10:
+                max_count = MODBUS_MAX_WRITE_REGISTERS;
+                break;
+            default:
+                return false;
+            }
+            if (entry.count < 1 || entry.count > max_count || entry.weight == 0)
+            {
+                return false;
+            }
+            mix.push_back(entry);
+        }
+        return !mix.empty();
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        std::string mix = "3:10:1";
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--host")
+            {
+                options.host = value;
+            }
+            else if (argument == "--port")
+            {
+                options.port = std::atoi(value);
+            }
+            else if (argument == "--slave")
+            {
+                options.slave = std::atoi(value);
+            }
+            else if (argument == "--connections")
+            {
+                options.connections = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--duration")
+            {
+                options.duration = std::atof(value);
+            }
+            else if (argument == "--warmup")
+            {
+                options.warmup = std::atof(value);
+            }
+            else if (argument == "--rate")
+            {
+                options.rate = std::atof(value);
+            }
+            else if (argument == "--pipeline")
+            {
+                options.pipeline = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--mix")
+            {
+                mix = value;
+            }
+            else if (argument == "--address")
+            {
+                options.address = std::atoi(value);
+            }
+            else if (argument == "--span")
+            {
+                options.span = std::atoi(value);
+            }
+            else if (argument == "--timeout")
+            {
+                options.timeout_ms = std::atoi(value);
+            }
+            else if (argument == "--json")
+            {
+                options.json = value;
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+
+        if (!parse_mix(mix, options.mix))
+        {
+            std::fprintf(stderr, "Invalid mix %s (expected FC:COUNT:WEIGHT,... with FC 1-6, 15 or 16)\n", mix.c_str());
+            return false;
+        }
+        return options.connections != 0 && options.pipeline != 0 && options.duration > 0.0 &&
+               options.warmup >= 0.0 && options.rate >= 0.0 && options.address >= 0 && options.address <= 0xFFFF &&
+               options.span >= 0 && options.timeout_ms > 0;
+    }
+
+    class Worker
+    {
+    public:
+        Worker(const Options &options, size_t index, WorkerResult &result)
+            : options_(options), result_(result), random_(static_cast<unsigned>(index) + 1),
+              connection_(options.host, options.port)
+        {
+            result_.entries.resize(options_.mix.size());
+            for (const MixEntry &entry : options_.mix)
+            {
+                total_weight_ += entry.weight;
+            }
+            if (options_.rate > 0.0)
+            {
+                interval_ = std::chrono::duration_cast<clock_type::duration>(
+                    std::chrono::duration<double>(static_cast<double>(options_.connections) / options_.rate));
+                // Stagger the connections evenly over one interval.
+                phase_ = interval_ * static_cast<int64_t>(index) / static_cast<int64_t>(options_.connections);
+            }
+        }
+
+        bool connect()
+        {
+            const auto timeout = std::chrono::milliseconds(options_.timeout_ms);
+            connection_.set_response_timeout(static_cast<uint32_t>(timeout.count() / 1000),
+                                             static_cast<uint32_t>(timeout.count() % 1000 * 1000));
+            result_.connected = connection_.connect() && connection_.set_slave_id(options_.slave);
+            if (!result_.connected)
+            {
+                note_error(connection_.get_last_error());
+            }
+            return result_.connected;
+        }
+
+        void run(clock_type::time_point start, clock_type::time_point measure_from, clock_type::time_point end)
+        {
+            measure_from_ = measure_from;
+            next_send_ = start + phase_;
+            if (options_.pipeline > 1)
+            {
+                run_pipelined(end);
+            }
+            else
+            {
+                run_sequential(end);
+            }
+        }
+
+    private:
+        struct InFlight
+        {
+            clock_type::time_point intended;
+            clock_type::time_point sent;
+            size_t entry;
+            uint16_t transaction_id;
+        };
+
+        size_t pick_entry()
+        {
+            unsigned ticket = random_() % total_weight_;
+            for (size_t i = 0; i < options_.mix.size(); ++i)
+            {
+                if (ticket < options_.mix[i].weight)
+                {
+                    return i;
+                }
+                ticket -= options_.mix[i].weight;
+            }
+            return 0;
+        }
+
+        uint16_t pick_address(int count)
+        {
+            const int limit = 0x10000 - count;
+            int address = options_.address;
+            if (options_.span > 0)
+            {
+                address += static_cast<int>(random_() % static_cast<unsigned>(options_.span));
+            }
+            return static_cast<uint16_t>(std::min(address, limit));
+        }
+
+        // Returns the time the next request is intended to be sent; waits
+        // for it if the connection is idle.
+        clock_type::time_point next_intended(bool idle)
+        {
+            if (interval_ == clock_type::duration::zero())
+            {
+                return clock_type::now();
+            }
+            if (idle)
+            {
+                std::this_thread::sleep_until(next_send_);
+            }
+            const clock_type::time_point intended = next_send_;
+            next_send_ += interval_;
+            return intended;
+        }
+
+        void complete(size_t entry, clock_type::time_point intended, bool success)
+        {
+            if (intended < measure_from_)
+            {
+                return;
+            }
+
+            EntryResult &result = result_.entries[entry];
+            ++result.requests;
+            if (!success)
+            {
+                ++result.errors;
+                return;
+            }
+            result.latency.record(clock_type::now() - intended);
+        }
+
+        void note_error(const std::string &message)
+        {
+            if (result_.first_error.empty())
+            {
+                result_.first_error = message;
+            }
+        }
+
+        bool execute(const MixEntry &entry)
+        {
+            const uint16_t address = pick_address(entry.count);
+            const auto count = static_cast<uint16_t>(entry.count);
+            switch (entry.function)
+            {
+            case 0x01:
+                return connection_.read_coils(address, count, bits_);
+            case 0x02:
+                return connection_.read_discrete_inputs(address, count, bits_);
+            case 0x03:
+                return connection_.read_registers(address, count, registers_);
+            case 0x04:
+                return connection_.read_input_registers(address, count, registers_);
+            case 0x05:
+                return connection_.write_coil(address, (random_() & 1) != 0);
+            case 0x06:
+                return connection_.write_register(address, static_cast<uint16_t>(random_()));
+            case 0x0F:
+                return connection_.write_coils(address, count, bits_);
+            case 0x10:
+                return connection_.write_registers(address, count, registers_);
+            }
+            return false;
+        }
+
+        void run_sequential(clock_type::time_point end)
+        {
+            while (true)
+            {
+                const clock_type::time_point intended = next_intended(true);
+                if (intended >= end)
+                {
+                    break;
+                }
+
+                const size_t entry = pick_entry();
+                const bool success = execute(options_.mix[entry]);
+                complete(entry, intended, success);
+                if (!success)
+                {
+                    note_error(connection_.get_last_error());
+                    if (connection_.get_last_error().find(modbus_strerror(ETIMEDOUT)) != std::string::npos)
+                    {
+                        ++result_.timeouts;
+                    }
+                }
+            }
+        }
+
+        int build_request(const MixEntry &entry, uint8_t *request)
+        {
+            const uint16_t address = pick_address(entry.count);
+            const auto count = static_cast<uint16_t>(entry.count);
+            request[0] = static_cast<uint8_t>(options_.slave);
+            request[1] = static_cast<uint8_t>(entry.function);
+            request[2] = static_cast<uint8_t>(address >> 8);
+            request[3] = static_cast<uint8_t>(address & 0xFF);
+
+            switch (entry.function)
+            {
+            case 0x05:
+                request[4] = (random_() & 1) != 0 ? 0xFF : 0x00;
+                request[5] = 0x00;
+                return 6;
+            case 0x06:
+            {
+                const auto value = static_cast<uint16_t>(random_());
+                request[4] = static_cast<uint8_t>(value >> 8);
+                request[5] = static_cast<uint8_t>(value & 0xFF);
+                return 6;
+            }
+            case 0x0F:
+            case 0x10:
+            {
+                const int bytes = entry.function == 0x0F ? (count + 7) / 8 : count * 2;
+                request[4] = static_cast<uint8_t>(count >> 8);
+                request[5] = static_cast<uint8_t>(count & 0xFF);
+                request[6] = static_cast<uint8_t>(bytes);
+                std::memset(request + 7, 0, static_cast<size_t>(bytes));
+                return 7 + bytes;
+            }
+            default:
+                request[4] = static_cast<uint8_t>(count >> 8);
+                request[5] = static_cast<uint8_t>(count & 0xFF);
+                return 6;
+            }
+        }
+
+        void run_pipelined(clock_type::time_point end)
+        {
+            modbus_t *ctx = connection_.get_context();
+            const int header_length = modbus_get_header_length(ctx);
+            const auto timeout = std::chrono::milliseconds(options_.timeout_ms);
+            // Requests go out with our own MBAP header, as libmodbus keeps its
+            // transaction id private; responses are matched by that id.
+            std::vector<InFlight> in_flight;
+            in_flight.reserve(options_.pipeline);
+            uint16_t transaction_id = 0;
+            uint8_t request[MODBUS_MAX_ADU_LENGTH];
+            uint8_t response[MODBUS_MAX_ADU_LENGTH];
+
+            while (true)
+            {
+                // Fill the pipeline with every request that is due.
+                bool send_failed = false;
+                while (in_flight.size() < options_.pipeline)
+                {
+                    if (!in_flight.empty() && interval_ != clock_type::duration::zero() && next_send_ > clock_type::now())
+                    {
+                        break;
+                    }
+                    const clock_type::time_point intended = next_intended(in_flight.empty());
+                    if (intended >= end)
+                    {
+                        break;
+                    }
+
+                    const size_t entry = pick_entry();
+                    const int length = build_request(options_.mix[entry], request + 6);
+                    ++transaction_id;
+                    request[0] = static_cast<uint8_t>(transaction_id >> 8);
+                    request[1] = static_cast<uint8_t>(transaction_id & 0xFF);
+                    request[2] = 0x00;
+                    request[3] = 0x00;
+                    request[4] = static_cast<uint8_t>(length >> 8);
+                    request[5] = static_cast<uint8_t>(length & 0xFF);
+                    if (send(modbus_get_socket(ctx), request, static_cast<size_t>(length) + 6, MSG_NOSIGNAL) !=
+                        length + 6)
+                    {
+                        note_error(std::string("Send failed: ") + modbus_strerror(errno));
+                        complete(entry, intended, false);
+                        send_failed = true;
+                        break;
+                    }
+                    in_flight.push_back({intended, clock_type::now(), entry, transaction_id});
+                }
+
+                if (in_flight.empty())
+                {
+                    if (!send_failed || clock_type::now() >= end)
+                    {
+                        break;
+                    }
+                    reconnect();
+                    continue;
+                }
+
+                const int length = modbus_receive_confirmation(ctx, response);
+                if (length == -1)
+                {
+                    // The stream position is unknown; fail every outstanding
+                    // request and start over on a fresh connection.
+                    const int error = errno;
+                    note_error(std::string("Receive failed: ") + modbus_strerror(error));
+                    if (error == ETIMEDOUT)
+                    {
+                        ++result_.timeouts;
+                    }
+                    for (const InFlight &pending : in_flight)
+                    {
+                        complete(pending.entry, pending.intended, false);
+                    }
+                    in_flight.clear();
+                    if (clock_type::now() >= end)
+                    {
+                        break;
+                    }
+                    reconnect();
+                    continue;
+                }
+
+                const uint16_t response_id = static_cast<uint16_t>((response[0] << 8) | response[1]);
+                const auto match = std::find_if(in_flight.begin(), in_flight.end(), [response_id](const InFlight &pending)
+                                                { return pending.transaction_id == response_id; });
+                if (match == in_flight.end() || length <= header_length)
+                {
+                    // A late response to a request already given up on.
+                    ++result_.mismatched;
+                    note_error("Response with unexpected transaction id " + std::to_string(response_id));
+                }
+                else
+                {
+                    const InFlight matched = *match;
+                    in_flight.erase(match);
+                    const int function = options_.mix[matched.entry].function;
+                    const bool exception = (response[header_length] & 0x80) != 0;
+                    if ((response[header_length] & 0x7F) != function)
+                    {
+                        ++result_.mismatched;
+                        note_error("Response with function code " + std::to_string(response[header_length] & 0x7F) +
+                                   " to a request with function code " + std::to_string(function));
+                        complete(matched.entry, matched.intended, false);
+                    }
+                    else
+                    {
+                        if (exception)
+                        {
+                            note_error(std::string("Exception: ") +
+                                       modbus_strerror(MODBUS_ENOBASE + response[header_length + 1]));
+                        }
+                        complete(matched.entry, matched.intended, !exception);
+                    }
+                }
+
+                // Requests the device never answered (e.g. dropped) run into
+                // the response timeout while later ones keep completing.
+                const clock_type::time_point now = clock_type::now();
+                std::erase_if(in_flight, [&](const InFlight &pending)
+                              {
+                                  if (now - pending.sent < timeout)
+                                  {
+                                      return false;
+                                  }
+                                  ++result_.timeouts;
+                                  complete(pending.entry, pending.intended, false);
+                                  return true;
+                              });
+            }
+        }
+
+        void reconnect()
+        {
+            ++result_.reconnects;
+            connection_.disconnect();
+            if (!connection_.connect())
+            {
+                note_error(connection_.get_last_error());
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+
+        const Options &options_;
+        WorkerResult &result_;
+        std::minstd_rand random_;
+        ModbusConnection connection_;
+        unsigned total_weight_ = 0;
+        clock_type::duration interval_{0};
+        clock_type::duration phase_{0};
+        clock_type::time_point next_send_;
+        clock_type::time_point measure_from_;
+        uint16_t registers_[MODBUS_MAX_READ_REGISTERS] = {};
+        uint8_t bits_[MODBUS_MAX_READ_BITS] = {};
+    };
+
+    double micros(std::chrono::nanoseconds value)
+    {
+        return static_cast<double>(value.count()) / 1000.0;
+    }
+
+    void print_latency(FILE *out, const LatencyHistogram &latency)
+    {
+        std::fprintf(out, "{\"min\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p99.9\":%.1f,\"p99.99\":%.1f,"
+                          "\"max\":%.1f,\"mean\":%.1f}",
+                     micros(latency.min()), micros(latency.percentile(50.0)), micros(latency.percentile(90.0)),
+                     micros(latency.percentile(99.0)), micros(latency.percentile(99.9)),
+                     micros(latency.percentile(99.99)), micros(latency.max()), micros(latency.mean()));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--host HOST --port PORT] [--slave ID] [--connections N] [--duration S] "
+                     "[--warmup S] [--rate REQUESTS_PER_S] [--pipeline DEPTH] [--mix FC:COUNT:WEIGHT,...] "
+                     "[--address A] [--span N] [--timeout MS] [--json FILE|-]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    LoopbackServer server;
+    if (options.host.empty())
+    {
+        if (!server.start())
+        {
+            std::fprintf(stderr, "%s\n", server.get_last_error().c_str());
+            return 2;
+        }
+        options.host = "127.0.0.1";
+        options.port = server.port();
+    }
+
+    std::vector<WorkerResult> results(options.connections);
+    std::vector<std::unique_ptr<Worker>> workers;
+    workers.reserve(options.connections);
+    size_t connected = 0;
+    for (size_t i = 0; i < options.connections; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(options, i, results[i]));
+        if (workers.back()->connect())
+        {
+            ++connected;
+        }
+    }
+    if (connected == 0)
+    {
+        std::fprintf(stderr, "No connection could be established: %s\n", results.front().first_error.c_str());
+        return 2;
+    }
+
+    const auto start = clock_type::now() + std::chrono::milliseconds(10);
+    const auto measure_from = start + std::chrono::duration_cast<clock_type::duration>(
+                                          std::chrono::duration<double>(options.warmup));
+    const auto end = measure_from + std::chrono::duration_cast<clock_type::duration>(
+                                        std::chrono::duration<double>(options.duration));
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(workers.size());
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            if (results[i].connected)
+            {
+                threads.emplace_back([&worker = *workers[i], start, measure_from, end]
+                                     { worker.run(start, measure_from, end); });
+            }
+        }
+    }
+
+    LatencyHistogram total_latency;
+    std::vector<EntryResult> entries(options.mix.size());
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t timeouts = 0;
+    uint64_t reconnects = 0;
+    uint64_t mismatched = 0;
+    uint64_t values = 0;
+    std::string first_error;
+    for (const WorkerResult &result : results)
+    {
+        for (size_t i = 0; i < result.entries.size(); ++i)
+        {
+            const EntryResult &entry = result.entries[i];
+            entries[i].latency.merge(entry.latency);
+            entries[i].requests += entry.requests;
+            entries[i].errors += entry.errors;
+            total_latency.merge(entry.latency);
+            requests += entry.requests;
+            errors += entry.errors;
+            values += (entry.requests - entry.errors) * static_cast<uint64_t>(options.mix[i].count);
+        }
+        timeouts += result.timeouts;
+        reconnects += result.reconnects;
+        mismatched += result.mismatched;
+        if (first_error.empty())
+        {
+            first_error = result.first_error;
+        }
+    }
+
+    const double seconds = options.duration;
+    std::printf("connections %zu (%zu connected), pipeline %zu, duration %.1f s\n", options.connections, connected,
+                options.pipeline, seconds);
+    std::printf("requests %llu (%.1f/s), errors %llu, timeouts %llu, mismatched %llu, reconnects %llu, values %.1f/s\n",
+                static_cast<unsigned long long>(requests), static_cast<double>(requests) / seconds,
+                static_cast<unsigned long long>(errors), static_cast<unsigned long long>(timeouts),
+                static_cast<unsigned long long>(mismatched), static_cast<unsigned long long>(reconnects),
+                static_cast<double>(values) / seconds);
+    std::printf("latency us: min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  p99.99 %.1f  max %.1f  mean %.1f\n",
+                micros(total_latency.min()), micros(total_latency.percentile(50.0)),
+                micros(total_latency.percentile(90.0)), micros(total_latency.percentile(99.0)),
+                micros(total_latency.percentile(99.9)), micros(total_latency.percentile(99.99)),
+                micros(total_latency.max()), micros(total_latency.mean()));
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        std::printf("  fc %2d x %-4d requests %llu errors %llu p50 %.1f us p99 %.1f us\n", options.mix[i].function,
+                    options.mix[i].count, static_cast<unsigned long long>(entries[i].requests),
+                    static_cast<unsigned long long>(entries[i].errors), micros(entries[i].latency.percentile(50.0)),
+                    micros(entries[i].latency.percentile(99.0)));
+    }
+    if (!first_error.empty())
+    {
+        std::printf("first error: %s\n", first_error.c_str());
+    }
+
+    if (!options.json.empty())
+    {
+        FILE *out = options.json == "-" ? stdout : std::fopen(options.json.c_str(), "w");
+        if (!out)
+        {
+            std::fprintf(stderr, "Cannot open %s\n", options.json.c_str());
+            return 2;
+        }
+        std::fprintf(out,
+                     "{\"connections\":%zu,\"connected\":%zu,\"pipeline\":%zu,\"duration_s\":%.3f,"
+                     "\"rate_target\":%.1f,\"requests\":%llu,\"errors\":%llu,\"timeouts\":%llu,\"mismatched\":%llu,"
+                     "\"reconnects\":%llu,\"throughput_rps\":%.1f,\"values_per_s\":%.1f,\"latency_us\":",
+                     options.connections, connected, options.pipeline, seconds, options.rate,
+                     static_cast<unsigned long long>(requests), static_cast<unsigned long long>(errors),
+                     static_cast<unsigned long long>(timeouts), static_cast<unsigned long long>(mismatched),
+                     static_cast<unsigned long long>(reconnects), static_cast<double>(requests) / seconds,
+                     static_cast<double>(values) / seconds);
+        print_latency(out, total_latency);
+        std::fprintf(out, ",\"mix\":[");
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            std::fprintf(out, "%s{\"function\":%d,\"count\":%d,\"weight\":%u,\"requests\":%llu,\"errors\":%llu,"
+                              "\"latency_us\":",
+                         i == 0 ? "" : ",", options.mix[i].function, options.mix[i].count, options.mix[i].weight,
+                         static_cast<unsigned long long>(entries[i].requests),
+                         static_cast<unsigned long long>(entries[i].errors));
+            print_latency(out, entries[i].latency);
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "]}\n");
+        if (out != stdout)
+        {
+            std::fclose(out);
+        }
+    }
+
+    return errors == 0 && mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,305 @@
+// Server scaling benchmark from 1 to N event-loop threads.
+//
+// For every thread count an in-process ModbusServer is started (one
+// device, SO_REUSEPORT listeners per loop unless --mode shared) with its
+// loops pinned to the first CPUs of the process, and modbus_loadgen is run
+// against it pinned to the remaining CPUs. The table shows throughput,
+// speedup and efficiency relative to one thread, latency percentiles and
+// server CPU time per request.
+//
+// Usage: modbus_scaling [--max-threads N] [--loadgen PATH] [--connections N]
+//                       [--duration S] [--warmup S] [--pipeline DEPTH]
+//                       [--mix FC:COUNT:WEIGHT,...] [--mode reuseport|shared]
+//                       [--cache-entries N]
+//
+// By default modbus_loadgen is taken from the directory of this executable
+// and --max-threads is half the available CPUs.
+
+#include "libmodbus_cpp/modbus_server.hpp"
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace libmodbus_cpp;
+
+namespace
+{
+    struct Options
+    {
+        size_t max_threads = 0;
+        std::string loadgen;
+        size_t connections = 64;
+        double duration = 5.0;
+        double warmup = 1.0;
+        size_t pipeline = 1;
+        std::string mix = "3:10:1";
+        bool reuse_port = true;
+        size_t cache_entries = ServerConfig{}.response_cache_entries;
+    };
+
+    struct Result
+    {
+        double throughput = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double cpu_per_request = 0.0;
+    };
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--max-threads")
+            {
+                options.max_threads = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--loadgen")
+            {
+                options.loadgen = value;
+            }
+            else if (argument == "--connections")
+            {
+                options.connections = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--duration")
+            {
+                options.duration = std::atof(value);
+            }
+            else if (argument == "--warmup")
+            {
+                options.warmup = std::atof(value);
+            }
+            else if (argument == "--pipeline")
+            {
+                options.pipeline = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--mix")
+            {
+                options.mix = value;
+            }
+            else if (argument == "--mode")
+            {
+                const std::string mode = value;
+                if (mode != "reuseport" && mode != "shared")
+                {
+                    return false;
+                }
+                options.reuse_port = mode == "reuseport";
+            }
+            else if (argument == "--cache-entries")
+            {
+                options.cache_entries = std::strtoull(value, nullptr, 10);
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+        return options.connections != 0 && options.duration > 0.0 && options.warmup >= 0.0 && options.pipeline != 0;
+    }
+
+    std::vector<int> allowed_cpus()
+    {
+        std::vector<int> cpus;
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &allowed))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+
+    double process_cpu_seconds()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+               static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    double json_number(const std::string &json, const char *key, size_t from = 0)
+    {
+        const size_t position = json.find(key, from);
+        return position == std::string::npos ? 0.0 : std::atof(json.c_str() + position + std::strlen(key));
+    }
+
+    // Runs the load generator on the given CPUs and returns its JSON report.
+    bool run_loadgen(const Options &options, uint16_t port, const std::vector<int> &cpus, std::string &report)
+    {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) == -1)
+        {
+            return false;
+        }
+
+        const std::vector<std::string> arguments = {
+            options.loadgen, "--host", "127.0.0.1", "--port", std::to_string(port),
+            "--connections", std::to_string(options.connections), "--duration", std::to_string(options.duration),
+            "--warmup", std::to_string(options.warmup), "--pipeline", std::to_string(options.pipeline),
+            "--mix", options.mix, "--json", "-"};
+        // Built before fork(): the server threads may hold the allocator lock.
+        std::vector<char *> argv;
+        for (const std::string &argument : arguments)
+        {
+            argv.push_back(const_cast<char *>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        const pid_t child = fork();
+        if (child == 0)
+        {
+            if (!cpus.empty())
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : cpus)
+                {
+                    CPU_SET(cpu, &set);
+                }
+                sched_setaffinity(0, sizeof(set), &set);
+            }
+            dup2(pipe_fds[1], STDOUT_FILENO);
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        close(pipe_fds[1]);
+        if (child == -1)
+        {
+            close(pipe_fds[0]);
+            return false;
+        }
+
+        std::string output;
+        char buffer[4096];
+        ssize_t length = 0;
+        while ((length = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+        {
+            output.append(buffer, static_cast<size_t>(length));
+        }
+        close(pipe_fds[0]);
+        int status = 0;
+        waitpid(child, &status, 0);
+
+        // The JSON report is the last line.
+        const size_t start = output.rfind("\n{");
+        if (!WIFEXITED(status) || WEXITSTATUS(status) > 1 || start == std::string::npos)
+        {
+            return false;
+        }
+        report = output.substr(start + 1);
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--max-threads N] [--loadgen PATH] [--connections N] [--duration S] [--warmup S] "
+                     "[--pipeline DEPTH] [--mix FC:COUNT:WEIGHT,...] [--mode reuseport|shared] [--cache-entries N]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    const std::vector<int> cpus = allowed_cpus();
+    if (options.max_threads == 0)
+    {
+        options.max_threads = std::max<size_t>(1, cpus.size() / 2);
+    }
+    if (options.loadgen.empty())
+    {
+        options.loadgen = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "modbus_loadgen").string();
+    }
+    // The load generator gets the CPUs not used by the largest server.
+    std::vector<int> client_cpus;
+    if (cpus.size() > options.max_threads)
+    {
+        client_cpus.assign(cpus.begin() + static_cast<std::ptrdiff_t>(options.max_threads), cpus.end());
+    }
+    else
+    {
+        std::fprintf(stderr, "Only %zu CPUs: server and load generator share them\n", cpus.size());
+    }
+
+    std::printf("%7s %12s %8s %10s %9s %9s %12s\n", "threads", "requests/s", "speedup", "efficiency", "p50_us",
+                "p99_us", "cpu_us/req");
+    std::vector<Result> results;
+    for (size_t threads = 1; threads <= options.max_threads; ++threads)
+    {
+        ServerConfig config;
+        config.bind_address = "127.0.0.1";
+        config.threads = threads;
+        config.reuse_port = options.reuse_port;
+        config.pin_threads = true;
+        config.response_cache_entries = options.cache_entries;
+        config.backlog = static_cast<int>(std::max<size_t>(128, options.connections));
+        ModbusServer server(config);
+        DeviceConfig device;
+        device.port = 0;
+        device.coils = 0xFFFF;
+        device.discrete_inputs = 0xFFFF;
+        device.holding_registers = 0xFFFF;
+        device.input_registers = 0xFFFF;
+        server.add_device(device);
+        if (!server.start())
+        {
+            std::fprintf(stderr, "%s\n", server.get_last_error().c_str());
+            return 2;
+        }
+
+        const double cpu_before = process_cpu_seconds();
+        const uint64_t requests_before = server.stats().requests;
+        std::string report;
+        if (!run_loadgen(options, server.port(0), client_cpus, report))
+        {
+            std::fprintf(stderr, "Running %s failed\n", options.loadgen.c_str());
+            return 2;
+        }
+        const double cpu = process_cpu_seconds() - cpu_before;
+        const uint64_t requests = server.stats().requests - requests_before;
+        server.stop();
+
+        Result result;
+        result.throughput = json_number(report, "\"throughput_rps\":");
+        const size_t latency = report.find("\"latency_us\":");
+        result.p50 = json_number(report, "\"p50\":", latency);
+        result.p99 = json_number(report, "\"p99\":", latency);
+        result.cpu_per_request = requests != 0 ? cpu / static_cast<double>(requests) * 1e6 : 0.0;
+        results.push_back(result);
+
+        const double speedup = results.front().throughput > 0.0 ? result.throughput / results.front().throughput : 0.0;
+        std::printf("%7zu %12.1f %8.2f %9.0f%% %9.1f %9.1f %12.2f\n", threads, result.throughput, speedup,
+                    speedup / static_cast<double>(threads) * 100.0, result.p50, result.p99, result.cpu_per_request);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,438 @@
+// Simulator hosting many Modbus TCP devices in one process.
+//
+// Devices are spread over consecutive ports and unit ids: device i listens
+// on base-port + i % ports with unit id 1 + i / ports. Every device has
+// the given number of coils, discrete inputs, holding and input registers;
+// input registers are driven by a value generator and every device answers
+// with the configured latency profile.
+//
+// Usage: modbus_sim [--devices N] [--ports N] [--base-port PORT] [--bind ADDRESS]
+//                   [--threads N] [--reuse-port 0|1] [--pin 0|1] [--cache-entries N]
+//                   [--registers N]
+//                   [--generator none|ramp|noise|replay:FILE] [--period-ms MS]
+//                   [--latency-us US] [--jitter-us US] [--drop P]
+//                   [--client-rate RPS] [--client-burst N] [--max-in-flight N]
+//                   [--quantum N] [--write-delay-ms MS] [--write-mode sync|async]
+//                   [--write-workers N] [--serial DEVICE] [--baud N]
+//                   [--duration S] [--stats-interval S]
+//
+// A replay file holds one register image per line (comma-separated
+// values); a new line is served every --period-ms. Without --duration the
+// simulator runs until interrupted. With --client-rate or --max-in-flight,
+// every stats line is followed by the clients held back most often.
+// --write-delay-ms attaches a write handler to all holding registers that
+// takes that long, like a slow actuator; with sync the master gets its
+// response after the handler returned, with async right away.
+// --serial turns the devices into RTU slaves with unit ids 1..N on that
+// serial line (8 data bits, even parity, 1 stop bit) instead of TCP ports;
+// one end of a pty pair (socat -d -d pty,raw,echo=0 pty,raw,echo=0) gives a
+// bench setup without hardware.
+
+#include "libmodbus_cpp/modbus_server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace libmodbus_cpp;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        size_t devices = 1;
+        size_t ports = 1;
+        int base_port = 1502;
+        std::string bind = "0.0.0.0";
+        size_t threads = 1;
+        bool reuse_port = false;
+        bool pin = false;
+        size_t cache_entries = ServerConfig{}.response_cache_entries;
+        int registers = 1000;
+        std::string generator = "ramp";
+        int period_ms = 1000;
+        int latency_us = 0;
+        int jitter_us = 0;
+        double drop = 0.0;
+        double client_rate = 0.0;
+        size_t client_burst = ServerConfig{}.client_burst;
+        size_t max_in_flight = 0;
+        size_t quantum = 1;
+        int write_delay_ms = -1;
+        bool write_sync = true;
+        size_t write_workers = 1;
+        std::string serial;
+        int baud = 19200;
+        double duration = 0.0;
+        double stats_interval = 10.0;
+    };
+
+    volatile std::sig_atomic_t interrupted = 0;
+
+    void on_signal(int)
+    {
+        interrupted = 1;
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--devices")
+            {
+                options.devices = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--ports")
+            {
+                options.ports = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--base-port")
+            {
+                options.base_port = std::atoi(value);
+            }
+            else if (argument == "--bind")
+            {
+                options.bind = value;
+            }
+            else if (argument == "--threads")
+            {
+                options.threads = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--reuse-port")
+            {
+                options.reuse_port = std::atoi(value) != 0;
+            }
+            else if (argument == "--pin")
+            {
+                options.pin = std::atoi(value) != 0;
+            }
+            else if (argument == "--cache-entries")
+            {
+                options.cache_entries = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--registers")
+            {
+                options.registers = std::atoi(value);
+            }
+            else if (argument == "--generator")
+            {
+                options.generator = value;
+            }
+            else if (argument == "--period-ms")
+            {
+                options.period_ms = std::atoi(value);
+            }
+            else if (argument == "--latency-us")
+            {
+                options.latency_us = std::atoi(value);
+            }
+            else if (argument == "--jitter-us")
+            {
+                options.jitter_us = std::atoi(value);
+            }
+            else if (argument == "--drop")
+            {
+                options.drop = std::atof(value);
+            }
+            else if (argument == "--client-rate")
+            {
+                options.client_rate = std::atof(value);
+            }
+            else if (argument == "--client-burst")
+            {
+                options.client_burst = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--max-in-flight")
+            {
+                options.max_in_flight = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--quantum")
+            {
+                options.quantum = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--write-delay-ms")
+            {
+                options.write_delay_ms = std::atoi(value);
+            }
+            else if (argument == "--write-mode")
+            {
+                const std::string mode = value;
+                if (mode != "sync" && mode != "async")
+                {
+                    return false;
+                }
+                options.write_sync = mode == "sync";
+            }
+            else if (argument == "--write-workers")
+            {
+                options.write_workers = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--serial")
+            {
+                options.serial = value;
+            }
+            else if (argument == "--baud")
+            {
+                options.baud = std::atoi(value);
+            }
+            else if (argument == "--duration")
+            {
+                options.duration = std::atof(value);
+            }
+            else if (argument == "--stats-interval")
+            {
+                options.stats_interval = std::atof(value);
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+
+        // Unit ids 1..247 on every port (or the serial line); port 0 (ephemeral) only works as one port.
+        if (!options.serial.empty())
+        {
+            options.ports = 1;
+        }
+        return options.devices != 0 && options.ports != 0 && options.devices <= options.ports * 247 &&
+               options.base_port >= 0 && options.base_port + options.ports - 1 <= 0xFFFF &&
+               (options.base_port != 0 || options.ports == 1) && options.threads != 0 && options.registers > 0 &&
+               options.registers <= 0xFFFF && options.period_ms > 0 && options.latency_us >= 0 &&
+               options.jitter_us >= 0 && options.drop >= 0.0 && options.drop <= 1.0 && options.client_rate >= 0.0 &&
+               options.client_burst != 0 && options.quantum != 0 && options.write_workers != 0 &&
+               options.baud > 0 && options.duration >= 0.0 && options.stats_interval > 0.0;
+    }
+
+    // Prints the clients held back most often.
+    void print_held_clients(const ModbusServer &server)
+    {
+        std::vector<ClientStats> clients = server.client_stats();
+        std::erase_if(clients, [](const ClientStats &client)
+                      { return client.throttled == 0 && client.in_flight_limited == 0; });
+        std::sort(clients.begin(), clients.end(), [](const ClientStats &a, const ClientStats &b)
+                  { return a.throttled + a.in_flight_limited > b.throttled + b.in_flight_limited; });
+        clients.resize(std::min<size_t>(clients.size(), 5));
+        for (const ClientStats &client : clients)
+        {
+            std::printf("  %s -> port %u: requests %llu  throttled %llu  in-flight limited %llu  in flight %zu%s\n",
+                        client.peer.c_str(), client.port, static_cast<unsigned long long>(client.requests),
+                        static_cast<unsigned long long>(client.throttled),
+                        static_cast<unsigned long long>(client.in_flight_limited), client.in_flight,
+                        client.held ? "  (held)" : "");
+        }
+    }
+
+    bool load_capture(const std::string &path, std::vector<std::vector<uint16_t>> &frames)
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::vector<uint16_t> frame;
+            std::istringstream values(line);
+            std::string value;
+            while (std::getline(values, value, ','))
+            {
+                frame.push_back(static_cast<uint16_t>(std::strtoul(value.c_str(), nullptr, 0)));
+            }
+            if (!frame.empty())
+            {
+                frames.push_back(std::move(frame));
+            }
+        }
+        return !frames.empty();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--devices N] [--ports N] [--base-port PORT] [--bind ADDRESS] [--threads N] "
+                     "[--reuse-port 0|1] [--pin 0|1] [--cache-entries N] [--registers N] [--generator none|ramp|noise|replay:FILE] [--period-ms MS] "
+                     "[--latency-us US] [--jitter-us US] [--drop P] [--client-rate RPS] [--client-burst N] "
+                     "[--max-in-flight N] [--quantum N] [--write-delay-ms MS] [--write-mode sync|async] "
+                     "[--write-workers N] [--serial DEVICE] [--baud N] [--duration S] [--stats-interval S]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::vector<std::vector<uint16_t>> capture;
+    if (options.generator.starts_with("replay:") && !load_capture(options.generator.substr(7), capture))
+    {
+        std::fprintf(stderr, "Cannot read capture %s\n", options.generator.substr(7).c_str());
+        return 2;
+    }
+    if (options.generator != "none" && options.generator != "ramp" && options.generator != "noise" &&
+        capture.empty())
+    {
+        std::fprintf(stderr, "Unknown generator %s\n", options.generator.c_str());
+        return 2;
+    }
+
+    ServerConfig config;
+    config.bind_address = options.bind;
+    config.threads = options.threads;
+    config.reuse_port = options.reuse_port;
+    config.pin_threads = options.pin;
+    config.response_cache_entries = options.cache_entries;
+    config.client_request_rate = options.client_rate;
+    config.client_burst = options.client_burst;
+    config.max_in_flight = options.max_in_flight;
+    config.dispatch_quantum = options.quantum;
+    config.write_workers = options.write_workers;
+    ModbusServer server(config);
+    int serial_bus = -1;
+    if (!options.serial.empty())
+    {
+        SerialConfig serial;
+        serial.device = options.serial;
+        serial.baud = options.baud;
+        serial_bus = server.add_serial_bus(serial);
+    }
+
+    const auto period = std::chrono::milliseconds(options.period_ms);
+    const auto registers = static_cast<uint16_t>(options.registers);
+    for (size_t i = 0; i < options.devices; ++i)
+    {
+        DeviceConfig device;
+        device.port = static_cast<uint16_t>(options.base_port + static_cast<int>(i % options.ports));
+        device.unit_id = static_cast<uint8_t>(1 + i / options.ports);
+        device.serial_bus = serial_bus;
+        device.coils = registers;
+        device.discrete_inputs = registers;
+        device.holding_registers = registers;
+        device.input_registers = registers;
+        device.latency.base = std::chrono::microseconds(options.latency_us);
+        device.latency.jitter = std::chrono::microseconds(options.jitter_us);
+        device.latency.drop = options.drop;
+        const size_t index = server.add_device(device);
+
+        ValueGenerator generator;
+        if (options.generator == "ramp")
+        {
+            generator = ramp_generator(static_cast<uint16_t>(i), 1, period);
+        }
+        else if (options.generator == "noise")
+        {
+            generator = noise_generator(0x8000, 0x1000, static_cast<uint32_t>(i) + 1);
+        }
+        else if (!capture.empty())
+        {
+            generator = replay_generator(capture, period);
+        }
+        if (generator)
+        {
+            server.add_generator(index, RegisterTable::input_registers, 0, registers, std::move(generator),
+                                 options.generator == "noise" ? std::chrono::nanoseconds::zero() : period);
+        }
+        if (options.write_delay_ms >= 0)
+        {
+            const auto write_delay = std::chrono::milliseconds(options.write_delay_ms);
+            server.add_write_handler(
+                index, RegisterTable::holding_registers, 0, registers,
+                [write_delay](const WriteRequest &)
+                {
+                    std::this_thread::sleep_for(write_delay);
+                    return uint8_t{0};
+                },
+                options.write_sync ? WriteMode::synchronous : WriteMode::fire_and_forget);
+        }
+    }
+
+    if (!server.start())
+    {
+        std::fprintf(stderr, "%s\n", server.get_last_error().c_str());
+        return 2;
+    }
+    if (serial_bus >= 0)
+    {
+        std::printf("%zu devices on %s at %d baud (unit ids 1..%zu)\n", options.devices, options.serial.c_str(),
+                    options.baud, options.devices);
+    }
+    else
+    {
+        const size_t last_port_device = std::min(options.devices, options.ports) - 1;
+        std::printf("%zu devices on %s ports %u..%u (unit ids 1..%zu), %zu threads\n", options.devices,
+                    options.bind.c_str(), server.port(0), server.port(last_port_device),
+                    (options.devices + options.ports - 1) / options.ports, options.threads);
+    }
+    std::fflush(stdout);
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    const clock_type::time_point start = clock_type::now();
+    const auto interval = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(options.stats_interval));
+    clock_type::time_point next_stats = start + interval;
+    ServerStats previous;
+    while (!interrupted)
+    {
+        const clock_type::time_point now = clock_type::now();
+        if (options.duration > 0.0 && now - start >= std::chrono::duration<double>(options.duration))
+        {
+            break;
+        }
+        if (now >= next_stats)
+        {
+            const ServerStats stats = server.stats();
+            const double seconds = std::chrono::duration<double>(interval).count();
+            std::printf("connections %llu  requests/s %.1f  exceptions %llu  dropped %llu  protocol errors %llu  "
+                        "cache hits %llu misses %llu  throttled %llu  in-flight limited %llu  held clients %llu  "
+                        "write handler runs %llu  write queue full %llu\n",
+                        static_cast<unsigned long long>(stats.connections),
+                        static_cast<double>(stats.requests - previous.requests) / seconds,
+                        static_cast<unsigned long long>(stats.exceptions),
+                        static_cast<unsigned long long>(stats.dropped),
+                        static_cast<unsigned long long>(stats.protocol_errors),
+                        static_cast<unsigned long long>(stats.cache_hits),
+                        static_cast<unsigned long long>(stats.cache_misses),
+                        static_cast<unsigned long long>(stats.throttled),
+                        static_cast<unsigned long long>(stats.in_flight_limited),
+                        static_cast<unsigned long long>(stats.held_clients),
+                        static_cast<unsigned long long>(stats.write_handler_runs),
+                        static_cast<unsigned long long>(stats.write_queue_full));
+            if (serial_bus >= 0)
+            {
+                std::printf("  serial frames %llu  crc errors %llu  framing errors %llu\n",
+                            static_cast<unsigned long long>(stats.serial_frames),
+                            static_cast<unsigned long long>(stats.serial_crc_errors),
+                            static_cast<unsigned long long>(stats.serial_framing_errors));
+            }
+            if (options.client_rate > 0.0 || options.max_in_flight != 0)
+            {
+                print_held_clients(server);
+            }
+            std::fflush(stdout);
+            previous = stats;
+            next_stats += interval;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    server.stop();
+    const ServerStats stats = server.stats();
+    std::printf("total: connections %llu  requests %llu  exceptions %llu  dropped %llu\n",
+                static_cast<unsigned long long>(stats.connections), static_cast<unsigned long long>(stats.requests),
+                static_cast<unsigned long long>(stats.exceptions), static_cast<unsigned long long>(stats.dropped));
+    return 0;
+}
@@ -0,0 +1,576 @@
+// Long-running soak test tracking memory, file descriptor and latency drift.
+//
+// Several connections issue register reads and writes for hours while
+// periodically reconnecting and recreating their ModbusConnection objects.
+// The in-process loopback server injects dropped connections, delayed
+// replies (client timeouts) and corrupted replies (data error retries).
+// Every sample interval the process RSS, open file descriptors, allocator
+// heap usage and the latency percentiles of that interval are recorded.
+// At the end the first and last third of the samples are compared and
+// growth beyond the thresholds is reported as a leak or drift.
+//
+// Usage: modbus_soak [--host HOST --port PORT] [--slave ID] [--connections N]
+//                    [--duration S] [--warmup S] [--sample-interval S]
+//                    [--reconnect-every OPS] [--recreate-every OPS]
+//                    [--fault-drop P] [--fault-delay P] [--fault-corrupt P]
+//                    [--delay-ms MS] [--timeout MS] [--csv FILE]
+//                    [--max-rss-growth-kb KB] [--max-heap-growth-kb KB]
+//                    [--max-fd-growth N] [--max-p99-drift RATIO]
+//
+// Without --host an in-process loopback server is used; faults can only be
+// injected there. The server shares the process, so its threads and sockets
+// are part of the figures as well.
+
+#include "latency_histogram.hpp"
+#include "loopback_server.hpp"
+#include "libmodbus_cpp/modbus_connection.hpp"
+
+#include <modbus/modbus.h>
+#include <dirent.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using libmodbus_cpp::ModbusConnection;
+using namespace libmodbus_cpp::tools;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        std::string host;
+        int port = 502;
+        int slave = 1;
+        size_t connections = 4;
+        double duration = 3600.0;
+        double warmup = 60.0;
+        double sample_interval = 10.0;
+        uint64_t reconnect_every = 1000;
+        uint64_t recreate_every = 10000;
+        FaultInjection faults;
+        int timeout_ms = 200;
+        std::string csv;
+        long max_rss_growth_kb = 1024;
+        long max_heap_growth_kb = 256;
+        long max_fd_growth = 0;
+        double max_p99_drift = 2.0;
+    };
+
+    struct Sample
+    {
+        double elapsed = 0.0;
+        long rss_kb = 0;
+        long heap_kb = -1;
+        long fds = 0;
+        uint64_t operations = 0;
+        uint64_t errors = 0;
+        uint64_t timeouts = 0;
+        uint64_t reconnects = 0;
+        std::chrono::nanoseconds p50{0};
+        std::chrono::nanoseconds p99{0};
+        std::chrono::nanoseconds max{0};
+    };
+
+    // Counters of one sample interval, shared between a worker and the
+    // sampling thread.
+    struct Interval
+    {
+        std::mutex mutex;
+        LatencyHistogram latency;
+        uint64_t operations = 0;
+        uint64_t errors = 0;
+        uint64_t timeouts = 0;
+        uint64_t reconnects = 0;
+    };
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        double drop = 0.0;
+        double delay = 0.0;
+        double corrupt = 0.0;
+        int delay_ms = 0;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "Missing value for %s\n", argument.c_str());
+                return false;
+            }
+
+            const char *value = argv[++i];
+            if (argument == "--host")
+            {
+                options.host = value;
+            }
+            else if (argument == "--port")
+            {
+                options.port = std::atoi(value);
+            }
+            else if (argument == "--slave")
+            {
+                options.slave = std::atoi(value);
+            }
+            else if (argument == "--connections")
+            {
+                options.connections = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--duration")
+            {
+                options.duration = std::atof(value);
+            }
+            else if (argument == "--warmup")
+            {
+                options.warmup = std::atof(value);
+            }
+            else if (argument == "--sample-interval")
+            {
+                options.sample_interval = std::atof(value);
+            }
+            else if (argument == "--reconnect-every")
+            {
+                options.reconnect_every = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--recreate-every")
+            {
+                options.recreate_every = std::strtoull(value, nullptr, 10);
+            }
+            else if (argument == "--fault-drop")
+            {
+                drop = std::atof(value);
+            }
+            else if (argument == "--fault-delay")
+            {
+                delay = std::atof(value);
+            }
+            else if (argument == "--fault-corrupt")
+            {
+                corrupt = std::atof(value);
+            }
+            else if (argument == "--delay-ms")
+            {
+                delay_ms = std::atoi(value);
+            }
+            else if (argument == "--timeout")
+            {
+                options.timeout_ms = std::atoi(value);
+            }
+            else if (argument == "--csv")
+            {
+                options.csv = value;
+            }
+            else if (argument == "--max-rss-growth-kb")
+            {
+                options.max_rss_growth_kb = std::atol(value);
+            }
+            else if (argument == "--max-heap-growth-kb")
+            {
+                options.max_heap_growth_kb = std::atol(value);
+            }
+            else if (argument == "--max-fd-growth")
+            {
+                options.max_fd_growth = std::atol(value);
+            }
+            else if (argument == "--max-p99-drift")
+            {
+                options.max_p99_drift = std::atof(value);
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown option %s\n", argument.c_str());
+                return false;
+            }
+        }
+
+        options.faults.drop = drop;
+        options.faults.delay = delay;
+        options.faults.corrupt = corrupt;
+        // By default a delayed reply always misses the response timeout.
+        options.faults.delay_time = std::chrono::milliseconds(delay_ms > 0 ? delay_ms : 2 * options.timeout_ms);
+        const auto probability = [](double value)
+        { return value >= 0.0 && value <= 1.0; };
+        return options.connections != 0 && options.duration > 0.0 && options.warmup >= 0.0 &&
+               options.sample_interval > 0.0 && options.timeout_ms > 0 && delay_ms >= 0 && probability(drop) &&
+               probability(delay) && probability(corrupt) && options.max_p99_drift > 0.0;
+    }
+
+    long read_rss_kb()
+    {
+        FILE *statm = std::fopen("/proc/self/statm", "r");
+        if (!statm)
+        {
+            return -1;
+        }
+        long size = 0;
+        long resident = 0;
+        const int fields = std::fscanf(statm, "%ld %ld", &size, &resident);
+        std::fclose(statm);
+        return fields == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : -1;
+    }
+
+    long count_open_fds()
+    {
+        DIR *directory = opendir("/proc/self/fd");
+        if (!directory)
+        {
+            return -1;
+        }
+        long count = 0;
+        while (const dirent *entry = readdir(directory))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                ++count;
+            }
+        }
+        closedir(directory);
+        // Not counting the descriptor of the directory stream itself.
+        return count - 1;
+    }
+
+    long read_heap_kb()
+    {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+        return static_cast<long>(mallinfo2().uordblks / 1024);
+#else
+        return -1;
+#endif
+    }
+
+    class Worker
+    {
+    public:
+        Worker(const Options &options, size_t index, Interval &interval)
+            : options_(options), interval_(interval), random_(static_cast<unsigned>(index) + 1)
+        {
+        }
+
+        void run(std::stop_token stop)
+        {
+            uint64_t operations = 0;
+            while (!stop.stop_requested())
+            {
+                if (!connection_ || (options_.recreate_every != 0 && operations % options_.recreate_every == 0))
+                {
+                    // Exercises the construction and destruction paths.
+                    connection_.reset();
+                    connection_ = std::make_unique<ModbusConnection>(options_.host, options_.port);
+                    if (!open())
+                    {
+                        continue;
+                    }
+                }
+                else if (options_.reconnect_every != 0 && operations % options_.reconnect_every == 0)
+                {
+                    reconnect();
+                }
+
+                const auto address = static_cast<uint16_t>(random_() % 1000);
+                const clock_type::time_point start = clock_type::now();
+                const bool success = (random_() & 3) != 0
+                                         ? connection_->read_registers(address, 10, registers_)
+                                         : connection_->write_registers(address, 10, registers_);
+                const clock_type::time_point end = clock_type::now();
+                ++operations;
+
+                bool timeout = false;
+                if (!success)
+                {
+                    timeout = connection_->get_last_error().find(modbus_strerror(ETIMEDOUT)) != std::string::npos;
+                }
+                {
+                    std::lock_guard lock(interval_.mutex);
+                    ++interval_.operations;
+                    if (success)
+                    {
+                        interval_.latency.record(end - start);
+                    }
+                    else
+                    {
+                        ++interval_.errors;
+                        interval_.timeouts += timeout ? 1 : 0;
+                    }
+                }
+                // A timed out connection is kept so the late reply has to
+                // be drained; any other failure may have lost the stream.
+                if (!success && !timeout)
+                {
+                    reconnect();
+                }
+            }
+            connection_.reset();
+        }
+
+    private:
+        bool open()
+        {
+            const auto timeout = std::chrono::milliseconds(options_.timeout_ms);
+            connection_->set_response_timeout(static_cast<uint32_t>(timeout.count() / 1000),
+                                              static_cast<uint32_t>(timeout.count() % 1000 * 1000));
+            if (connection_->connect() && connection_->set_slave_id(options_.slave))
+            {
+                return true;
+            }
+
+            {
+                std::lock_guard lock(interval_.mutex);
+                ++interval_.errors;
+            }
+            connection_.reset();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            return false;
+        }
+
+        void reconnect()
+        {
+            {
+                std::lock_guard lock(interval_.mutex);
+                ++interval_.reconnects;
+            }
+            connection_->disconnect();
+            if (!connection_->connect())
+            {
+                {
+                    std::lock_guard lock(interval_.mutex);
+                    ++interval_.errors;
+                }
+                // Like open(): a dead endpoint must not turn into a reconnect loop.
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+
+        const Options &options_;
+        Interval &interval_;
+        std::minstd_rand random_;
+        std::unique_ptr<ModbusConnection> connection_;
+        uint16_t registers_[10] = {};
+    };
+
+    double micros(std::chrono::nanoseconds value)
+    {
+        return static_cast<double>(value.count()) / 1000.0;
+    }
+
+    template <typename Projection>
+    double median_of(const std::vector<Sample> &samples, size_t first, size_t last, Projection projection)
+    {
+        std::vector<double> values;
+        for (size_t i = first; i < last; ++i)
+        {
+            values.push_back(static_cast<double>(projection(samples[i])));
+        }
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0.0 : values[values.size() / 2];
+    }
+
+    // Least-squares slope of a series in units per hour.
+    template <typename Projection>
+    double slope_per_hour(const std::vector<Sample> &samples, Projection projection)
+    {
+        double mean_x = 0.0;
+        double mean_y = 0.0;
+        for (const Sample &sample : samples)
+        {
+            mean_x += sample.elapsed;
+            mean_y += static_cast<double>(projection(sample));
+        }
+        mean_x /= static_cast<double>(samples.size());
+        mean_y /= static_cast<double>(samples.size());
+
+        double covariance = 0.0;
+        double variance = 0.0;
+        for (const Sample &sample : samples)
+        {
+            covariance += (sample.elapsed - mean_x) * (static_cast<double>(projection(sample)) - mean_y);
+            variance += (sample.elapsed - mean_x) * (sample.elapsed - mean_x);
+        }
+        return variance > 0.0 ? covariance / variance * 3600.0 : 0.0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--host HOST --port PORT] [--slave ID] [--connections N] [--duration S] "
+                     "[--warmup S] [--sample-interval S] [--reconnect-every OPS] [--recreate-every OPS] "
+                     "[--fault-drop P] [--fault-delay P] [--fault-corrupt P] [--delay-ms MS] [--timeout MS] "
+                     "[--csv FILE] [--max-rss-growth-kb KB] [--max-heap-growth-kb KB] [--max-fd-growth N] "
+                     "[--max-p99-drift RATIO]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    LoopbackServer server;
+    if (options.host.empty())
+    {
+        if (!server.start())
+        {
+            std::fprintf(stderr, "%s\n", server.get_last_error().c_str());
+            return 2;
+        }
+        server.set_faults(options.faults);
+        options.host = "127.0.0.1";
+        options.port = server.port();
+    }
+    else if (options.faults.drop > 0.0 || options.faults.delay > 0.0 || options.faults.corrupt > 0.0)
+    {
+        std::fprintf(stderr, "Faults can only be injected with the loopback server, ignoring them\n");
+    }
+
+    FILE *csv = nullptr;
+    if (!options.csv.empty())
+    {
+        csv = std::fopen(options.csv.c_str(), "w");
+        if (!csv)
+        {
+            std::fprintf(stderr, "Cannot open %s\n", options.csv.c_str());
+            return 2;
+        }
+        std::fprintf(csv, "elapsed_s,rss_kb,heap_kb,fds,operations,errors,timeouts,reconnects,p50_us,p99_us,max_us\n");
+    }
+
+    std::vector<Interval> intervals(options.connections);
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::jthread> threads;
+    for (size_t i = 0; i < options.connections; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(options, i, intervals[i]));
+        threads.emplace_back([&worker = *workers.back()](std::stop_token stop)
+                             { worker.run(stop); });
+    }
+
+    const auto interval = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(options.sample_interval));
+    const clock_type::time_point start = clock_type::now();
+    const clock_type::time_point measure_from = start + std::chrono::duration_cast<clock_type::duration>(
+                                                            std::chrono::duration<double>(options.warmup));
+    const clock_type::time_point end = measure_from + std::chrono::duration_cast<clock_type::duration>(
+                                                          std::chrono::duration<double>(options.duration));
+
+    std::printf("%9s %9s %9s %5s %9s %7s %8s %10s %9s %9s %9s\n", "elapsed_s", "rss_kb", "heap_kb", "fds", "ops",
+                "errors", "timeouts", "reconnects", "p50_us", "p99_us", "max_us");
+    std::vector<Sample> samples;
+    LatencyHistogram latency;
+    clock_type::time_point next = start + interval;
+    while (next <= end)
+    {
+        std::this_thread::sleep_until(next);
+        next += interval;
+
+        Sample sample;
+        latency.reset();
+        for (Interval &worker : intervals)
+        {
+            std::lock_guard lock(worker.mutex);
+            latency.merge(worker.latency);
+            worker.latency.reset();
+            sample.operations += std::exchange(worker.operations, 0);
+            sample.errors += std::exchange(worker.errors, 0);
+            sample.timeouts += std::exchange(worker.timeouts, 0);
+            sample.reconnects += std::exchange(worker.reconnects, 0);
+        }
+        sample.elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        sample.rss_kb = read_rss_kb();
+        sample.heap_kb = read_heap_kb();
+        sample.fds = count_open_fds();
+        sample.p50 = latency.percentile(50.0);
+        sample.p99 = latency.percentile(99.0);
+        sample.max = latency.max();
+
+        const bool warming_up = clock_type::now() < measure_from;
+        std::printf("%9.1f %9ld %9ld %5ld %9llu %7llu %8llu %10llu %9.1f %9.1f %9.1f%s\n", sample.elapsed,
+                    sample.rss_kb, sample.heap_kb, sample.fds, static_cast<unsigned long long>(sample.operations),
+                    static_cast<unsigned long long>(sample.errors), static_cast<unsigned long long>(sample.timeouts),
+                    static_cast<unsigned long long>(sample.reconnects), micros(sample.p50), micros(sample.p99),
+                    micros(sample.max), warming_up ? "  (warmup)" : "");
+        std::fflush(stdout);
+        if (csv)
+        {
+            std::fprintf(csv, "%.1f,%ld,%ld,%ld,%llu,%llu,%llu,%llu,%.1f,%.1f,%.1f\n", sample.elapsed, sample.rss_kb,
+                         sample.heap_kb, sample.fds, static_cast<unsigned long long>(sample.operations),
+                         static_cast<unsigned long long>(sample.errors),
+                         static_cast<unsigned long long>(sample.timeouts),
+                         static_cast<unsigned long long>(sample.reconnects), micros(sample.p50), micros(sample.p99),
+                         micros(sample.max));
+            std::fflush(csv);
+        }
+        if (!warming_up)
+        {
+            samples.push_back(sample);
+        }
+    }
+
+    threads.clear();
+    if (csv)
+    {
+        std::fclose(csv);
+    }
+
+    if (samples.size() < 6)
+    {
+        std::printf("verdict: not enough samples after warmup (%zu, need 6) for a drift analysis\n", samples.size());
+        return 0;
+    }
+
+    // Medians of the first and last third are robust against single
+    // outliers such as an allocator trimming its arenas.
+    const size_t third = samples.size() / 3;
+    const size_t last = samples.size();
+    bool flagged = false;
+    const auto report = [&](const char *name, double baseline, double final_value, double slope, bool exceeded)
+    {
+        std::printf("%-8s first %.1f last %.1f growth %+.1f (%+.1f/h)%s\n", name, baseline, final_value,
+                    final_value - baseline, slope, exceeded ? "  EXCEEDED" : "");
+        flagged = flagged || exceeded;
+    };
+
+    const auto rss = [](const Sample &sample)
+    { return sample.rss_kb; };
+    const double rss_first = median_of(samples, 0, third, rss);
+    const double rss_last = median_of(samples, last - third, last, rss);
+    report("rss_kb", rss_first, rss_last, slope_per_hour(samples, rss),
+           rss_last - rss_first > static_cast<double>(options.max_rss_growth_kb));
+
+    const auto heap = [](const Sample &sample)
+    { return sample.heap_kb; };
+    if (samples.front().heap_kb >= 0)
+    {
+        const double heap_first = median_of(samples, 0, third, heap);
+        const double heap_last = median_of(samples, last - third, last, heap);
+        report("heap_kb", heap_first, heap_last, slope_per_hour(samples, heap),
+               heap_last - heap_first > static_cast<double>(options.max_heap_growth_kb));
+    }
+
+    const auto fds = [](const Sample &sample)
+    { return sample.fds; };
+    const double fds_first = median_of(samples, 0, third, fds);
+    const double fds_last = median_of(samples, last - third, last, fds);
+    report("fds", fds_first, fds_last, slope_per_hour(samples, fds),
+           fds_last - fds_first > static_cast<double>(options.max_fd_growth));
+
+    const auto p99 = [](const Sample &sample)
+    { return micros(sample.p99); };
+    const double p99_first = median_of(samples, 0, third, p99);
+    const double p99_last = median_of(samples, last - third, last, p99);
+    report("p99_us", p99_first, p99_last, slope_per_hour(samples, p99),
+           p99_first > 0.0 && p99_last > p99_first * options.max_p99_drift);
+
+    std::printf("verdict: %s\n", flagged ? "growth or drift detected" : "stable");
+    return flagged ? 1 : 0;
+}